@@ -1,511 +1,1012 @@
-/*
- *ATtiny / TLC5947 LEDs
- *
- * Created: 6/4/2012 9:40:15 PM
- *  Author: gary
- */ 
-
-/*
-ATtiny 4313 Fuse settings: 
-~-~-~-~-~-~-~-~-~-~-~-~-~-~-
-EXTENDED = 0xFF 
-HIGH = 0xDF, or 0x5F for DebugWire enable
-LOW = 0xE4 
-*/
-
-#define F_CPU 8000000UL
-#include <avr/io.h>
-#include <inttypes.h>
-#include <string.h>
-#include <stdbool.h>
-#include <avr/interrupt.h>
-#include <avr/eeprom.h>
-
-
-
-#define XLAT_LOW()	PORTD &= ~_BV(PORTD0)
-#define XLAT_HIGH()	PORTD |=  _BV(PORTD0)
-#define BLANK_LOW()	PORTB &= ~_BV(PORTB4)	
-#define BLANK_HIGH()PORTB |=  _BV(PORTB4)
-
-
-#define N_LEDS	8
-#define N_GRAYSCALE 12		// NOTE: These are only the Gray scale steps 1based , additionally there is 0 for all off and 13 for all on (MAX brightness)
-#define LEDS_OFF 0
-#define LEDS_MAX N_GRAYSCALE+1
-
-#define FRAMES_P_SECOND	48	// evenly divisible by 8 and 24 
-#define FRAME_EXPOSURE_MS	20	// about 20 ms exposure per frame
-
-typedef enum Colors {BLU=0,RED,GRN,N_COLOR} t_Color;
-typedef enum Direction {CCW,CW,ALTERNATE} t_dir;
-typedef enum Up_Down { TRIANGLE=0,UP,DOWN=-1} t_up_down;
-uint8_t LedArray[N_LEDS][N_COLOR];	
-uint8_t EEMEM EE_flashSequence_index;	 
-	
-extern unsigned char SPI_Xfer( unsigned char );
-
-
-void 
-HW_init(void)
-{
-	int i;
-
-	cli();
-	// set CPU clock divider to 1
-	// CLOCK source is selected by fuses and can not be  changed in the program
-	// Set fuses to 8Mhz and NO CLKDIV
-
-	// Watchdog 
-	// Watchdog is controlled by a fuse setting and can not be disabled by a program when the fuse is set
-	// Make sure the Watchdog fuse is not set 
-
-	// Port directions
-	DDRD |= _BV(PORTD0); //PD0 as output for TLC5947 XLAT signal  
-	DDRB |= _BV(PORTB4); //PB4 as output for TLC5947 Blank signal
-	DDRB |= _BV(PORTB6); //PB6 as output for USI Pin DO, connected to TLC5947 SIN
-	DDRB |= _BV(PORTB7); //PB7 as output for USI pin USCK, connected to TLC5947 SCLK
-	
-	PORTB = 0;			// Make sure DO and USCK are low to begin with 
-
-	BLANK_HIGH();	// Turn All The LEDs off -- nor really needed 
-	
-	// set all GrayScale values to 0 in the TLC
-	for (i = 0; i < 36; i++)
-	{
-		SPI_Xfer(0);
-	}
-	
-	XLAT_HIGH();	// Latch it to the outputs
-	XLAT_LOW();		// 
-	
-	BLANK_LOW();	// Turn all The LEDs active 
-
-	// Timer1 setup in delay function 
-
-	// USI config for 3wire SPI master mode in spiXfer()
-}
-
-
-// Simple blocking delay() using Timer/Counter1 (16bit) counts with clock pre-scaler set to divide by 256 for a clock rate of 32us at ~8Mhz system clock 
-// Maxiumm delay is 0xffff counst = 0xffff * 32uS ==  2 seconds 
-void
-delay( int n_ms)
-{
-	if (n_ms>2000)		// limit to max duration the timer can do 
-		n_ms= 2000;
-		
-	long t = (n_ms*1000L)/32;	// calculate timer counts in 128us steps
-	
-	TCCR1A = 0; // Normal mode operation
-	TCCR1B = 0; // clock stopped
-	TCNT1=0;	// Clear counter
-	OCR1A=t;	// set count target value
-	TIFR |=_BV(OCF1A);		// This clears the compare register flag
-	TCCR1B = 0x04; // Enable count clock to be SysClk/256, 1 tick = 32us
-	while (! (TIFR & _BV(OCF1A)))
-	{
-		//block
-	}
-	
-}
-
-
-void
-set_TLC5947_Grayscale(void)
-{
-	unsigned char *cp;
-	signed char lum;
-	unsigned short led_a, led_b;
- 
-	// loop to fill the TLC5947 shift register with 12bit x 24Led data -- Led nomenclature as per TLC5947 pin-out
-	cp = &LedArray[N_LEDS-1][N_COLOR-1]; // start at end of array and work backwards-- Must send most sig bit of LED 23 first
-
-	for (cp = &LedArray[N_LEDS-1][N_COLOR-1]; cp >= &LedArray[0][0] ; ) // Process two LEDs per iteration so we end up with 24 bits, i.e. 3 bytes to transfer each
-	{
-		lum = (*cp--);	
-		if (lum == 0)
-			led_a = 0;
-		else if (lum > N_GRAYSCALE)	
-			led_a = 0xfff;
-		else	
-			led_a = 1 << (lum-1);	// LED23  gray scale lookup, ... LED21, ... .... LED 1
-		
-		lum = (*cp--);
-		if (lum == 0)
-			led_b = 0;
-		else if( lum > N_GRAYSCALE)
-			led_b = 0xfff;
-		else 	
-			led_b = 1 << (lum-1);	// LED22  gray scale lookup, ... LED20. ... .... LED 0
-		
-		SPI_Xfer(( led_a & 0x0ff0) >> 4 );	// store 8 most significant bits of 1st LED value into transmit register
-		SPI_Xfer(((led_a & 0x00f) << 4 ) | ( (led_b & 0xf00) >>8 ) );  // Store 4 least sig. bits of led a and 4 most sig. bits of led b
-		SPI_Xfer(  led_b & 0xff);
-	}
-	XLAT_HIGH();	// Latch it to the outputs
-	XLAT_LOW();		//
-}
-
-
-void
-rotate_one_led( t_dir dir)	// Rotate the entire LED matrix by one tri-color LED position (8 tri-color leds) 
-{
-	// Rotate the pattern CCW
-		short n;
-		unsigned char r,b,g;
-						
-		if (dir == CCW)
-		{
-			b = LedArray[0][BLU];
-			r = LedArray[0][RED];
-			g = LedArray[0][GRN];
-			for(n =0; n < N_LEDS-1; n++)
-			{
-				LedArray[n][BLU] = LedArray[n+1][BLU];
-				LedArray[n][RED] = LedArray[n+1][RED];
-				LedArray[n][GRN] = LedArray[n+1][GRN];
-				
-			}
-			LedArray[n][BLU] = b;
-			LedArray[n][RED] = r;
-			LedArray[n][GRN] = g;
-		}
-		else
-		{
-			b = LedArray[N_LEDS-1][BLU];
-			r = LedArray[N_LEDS-1][RED];
-			g = LedArray[N_LEDS-1][GRN];
-			for(n=N_LEDS-2; n >=0; n--)
-			{
-				LedArray[n+1][BLU] = LedArray[n][BLU];
-				LedArray[n+1][RED] = LedArray[n][RED];
-				LedArray[n+1][GRN] = LedArray[n][GRN];
-				
-			}
-			LedArray[0][BLU] = b;
-			LedArray[0][RED] = r;
-			LedArray[0][GRN] = g;	
-		}				
-}
-
-
-void
-rotate_led_color(void)
-{
-	// Rotate the LED matrix by one color . i.e Green becomes Red & Red => Blue & Blue => Green -- only one diection
-	unsigned char n;
-	unsigned char t;
-	for(n =0; n < N_LEDS; n++)
-	{
-		t =LedArray[n][0];
-		LedArray[n][0] = LedArray[n][1];
-		LedArray[n][1] = LedArray[n][2];
-		LedArray[n][2] = t;
-	}
-	
-}
-/* Function to run a light patter in a circular motion, changing direction of rotation and colors along the way.
- *	
- 
-   Arguments: 
-		direction: The sense of rotation ClockWise, Counter Clock Wise or Alternating
-		speed:     The speed of the chasing pattern, low numbers == faster speed. E.g. settng this to Frames_per_Second
-		           and the pattern will advance one position per second. Using 0 the pattern will not appear to move
-		interval:  time until the color and the direction changes (if set to Alternate). 
-				   Note: the colors are swapped in one direction only. If color mixing is present i.e. more than
-				         one color turned on the array, rotating through the colors will yield 3 distinct colors.
-		duration:  overall duration of execution of the pattern. If set to 0 the pattern continues indefinitely  				   
-
- */
-
-void
-RoundAbout(t_dir direction, uint8_t speed , uint8_t interval_S, uint16_t duration)
-{
-	short i;
-	t_dir dir; 
-	
-	if (direction == ALTERNATE ) 
-		dir = CW;
-	else 
-		dir = direction;
-
-	duration *= FRAMES_P_SECOND;		// Duration of the run in frame counts
-	for(;;) 
-	{
-			 
-		for (i = 0; i < FRAMES_P_SECOND * interval_S; i++)	// run for n seconds
-		{
-			if (duration)			// if duration is not zero decrement and return when elapsed
-			{
-				if (--duration == 0)
-					return;
-			}
-
-			// Advance the pattern by one LED position
-			if ( i % speed == 0)
-			{
-				rotate_one_led(dir);
-				set_TLC5947_Grayscale();	// Send LED pattern out to the LED driver chip
-			}
-		
-			delay( FRAME_EXPOSURE_MS);  // about 20 ms exposure per frame
-		}
-		rotate_led_color();
-		if (direction == ALTERNATE ) 
-		{
-			dir++;
-			if (dir == ALTERNATE)
-				dir =0;
-		}
-
-	
-	}
-}
-
-
-/* Function to run flash all LEDs in a ascending or decaying mode.
- *	
-   Arguments: 
-		BR:		The Maximum brightness of the LEDs. 
-		R,G,B	boolean flags indicating the use of the individual colors, 6 colors plus white possible
-		delay:  In ms, the rate of pulsating. The pattern pulsates at (N_LEDS+2) * delay rate. 
-		up_down: -1 == initially bright then decaying, +1 == initially off then ascending, 0 == ascend then decay.
-				 There is an extra delay when at 0 intensity.
-		
-*/	
-	
-void
-Flash(uint8_t BR, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
-{
-	int8_t br; 
-	int8_t u_d;
-
-	if (up_down == TRIANGLE)	// up, then down, then up
-		u_d= 1;
-	else
-		u_d = up_down;
-		
-	memset(LedArray,0,sizeof(LedArray)); 
-	
-	for (;;)//ever
-	{
-		if (up_down)
-		{
-			if ( br < LEDS_OFF)
-			{
-				br = BR;
-			}			
-			else if (br > BR)
-			{
-				br = LEDS_OFF;
-			}			
-		}
-		else
-		{
-			if(br <= LEDS_OFF+1)
-			{
-				u_d *= -1;
-			}
-			else if ( br > BR)
-			{
-				u_d *= -1;
-			}
-		}
-		
-		for( int i =0 ; i<N_LEDS;i++)
-		{
-			LedArray[i][RED] = br*R;
-			LedArray[i][GRN] = br*G;
-			LedArray[i][BLU] = br*B;
-		}
-		set_TLC5947_Grayscale();
-		delay(delay_ms);
-		
-		if (br == 0)			// Give extra delay when lights are out
-		{
-			delay(delay_ms);	
-		}
-		br += u_d;
-	}	
-	
-}
-
-// Heartbeat 
-void
-ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 )
-{
-	int8_t n;
-	
-	
-	for(;;)
-	{
-		memset(LedArray,0,sizeof(LedArray)); 
-		for ( n=13; n>7; n--)
-		{
-			for( int i =0 ; i<N_LEDS;i++)
-			{
-				LedArray[i][col1] = n;
-			}
-			set_TLC5947_Grayscale();
-			delay(delay_ms/2);
-		}	
-		memset(LedArray,0,sizeof(LedArray)); 
-		for (; n<10; n++)
-		{
-			for( int i =0 ; i<N_LEDS;i++)
-			{
-				//LedArray[i][col1] = n;
-				LedArray[i][col2] = n;
-			}
-			set_TLC5947_Grayscale();
-			delay(delay_ms/2);
-		}
-		memset(LedArray,0,sizeof(LedArray)); 
-		for (; n>=LEDS_OFF; n--)
-		{
-			for( int i =0 ; i<N_LEDS;i++)
-			{
-				//LedArray[i][col1] = n;
-				//LedArray[i][col2] = n;
-				LedArray[i][col3] = n;
-			}
-			set_TLC5947_Grayscale();
-			delay(delay_ms);
-		}
-		delay(delay_ms*2);
-
-	}
-	
-}
-
-int 
-main(void) 
-{
-	unsigned int i;
-	uint8_t fl_seq;
-
-	HW_init();
-
-	delay(1000);	 // Power on good and solid until ee program
-	fl_seq = eeprom_read_byte(&EE_flashSequence_index);		// get the last sequence number from the EEPROM and advance to the next 
-	eeprom_write_byte(&EE_flashSequence_index,++fl_seq);	// store the next seq number in EEPROM 
-	
-	
-	switch (fl_seq)
-	{
-		case 1:
-			//ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 ) 
-			ThumpThump(80,RED, RED,RED);
-			break;
-		
-		case 2:
-			//ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 )
-			ThumpThump(80,GRN, GRN,GRN);
-			break;
-		
-		case 3:
-			//ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 )
-			ThumpThump(80,RED, GRN,BLU);
-			break;
-			
-		case 4:
-			//Flash(uint8_t BRirightness, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
-			Flash( 12,0,0,1,70,UP);
-			break;
-		
-		case 5:
-			//Flash(uint8_t BRirightness, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
-			Flash( 12,0,1,0,70,DOWN);
-			break;
-			
-		case 6:
-			//Flash(uint8_t BRirightness, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
-			Flash( 12,1,0,0,50,TRIANGLE);
-			break;
-			
-		case 7:
-			memset(LedArray,0,sizeof(LedArray)); 
-			LedArray[0][BLU] = 3; // long trail	
-			LedArray[1][BLU] = 4; 
-			LedArray[2][BLU] = 5;	
-			LedArray[3][BLU] = 6;	
-			LedArray[4][BLU] = 7; 
-			LedArray[5][GRN] = 10;	//White head
-			LedArray[5][RED] = 10;
-			LedArray[5][BLU] = 10;
-			//RoundAbout(t_dir direction, uint8_t speed , uint8_t interval_S, uint16_t duration)
-			RoundAbout(CW,4,5,0);
-			break;
-			
-		case 8:
-			memset(LedArray,0,sizeof(LedArray));
-			LedArray[5][BLU] = 3; // long trail
-			LedArray[4][BLU] = 4;
-			LedArray[3][BLU] = 5;
-			LedArray[2][BLU] = 6;
-			LedArray[1][BLU] = 7;
-			LedArray[0][GRN] = 10;	//White head
-			LedArray[0][RED] = 10;
-			LedArray[0][BLU] = 10;
-			RoundAbout(CCW,4,5,0);
-			break;
-			
-		case 9:
-			memset(LedArray,0,sizeof(LedArray)); 
-			LedArray[0][GRN] = 4;	
-			LedArray[1][GRN] = 10; // trail
-			LedArray[2][GRN] = 4;	
-			//RoundAbout( direction, speed,interval_S,  duration)
-			RoundAbout(ALTERNATE,1,3,0);
-			break;
-			
-		case 10:
-			memset(LedArray,0,sizeof(LedArray));
-			LedArray[0][GRN] = 3;
-			LedArray[1][GRN] = 11; // dot
-			LedArray[2][GRN] = 3;
-			LedArray[0][RED] = 4;
-			LedArray[1][RED] = 11; // dot
-			LedArray[2][RED] = 4;
-			LedArray[0][BLU] = 6;
-			LedArray[1][BLU] = 11; // dot
-			LedArray[2][BLU] = 6;
-			RoundAbout(CCW,3,4,0);
-			break;
-	
-		case 11:
-			memset(LedArray,0,sizeof(LedArray));
-			LedArray[0][RED] = 4;
-			LedArray[1][RED] = 10; // trail
-			LedArray[2][RED] = 4;
-			LedArray[0][BLU] = 4;
-			LedArray[1][BLU] = 10; // trail
-			LedArray[2][BLU] = 4;
-			RoundAbout(ALTERNATE,3,4,0);
-			break;
-			
-		default :	// default case -- end of possible choices, indicate by static pattern and reset fl_seq in eeprom to start from the beginning again
-			fl_seq = 0;	
-			eeprom_write_byte(&EE_flashSequence_index,fl_seq);
-			LedArray[0][RED] = 6; 
-			LedArray[1][GRN] = 6;
-			LedArray[2][BLU] = 6;
-			LedArray[3][RED] = 6;
-			LedArray[4][GRN] = 6;
-			LedArray[5][BLU] = 6;	
-			LedArray[6][RED] = 6;
-			LedArray[7][GRN] = 6;
-			LedArray[7][RED] = 6;
-			set_TLC5947_Grayscale();
-			break;
-
-	}	
-	
-	// we should never get to this point, except for the default clause above.	
-	for(;;);	//never exit 
-  
-}
-
-
-
+/*
+ *ATtiny / TLC5947 LEDs
+ *
+ * Created: 6/4/2012 9:40:15 PM
+ *  Author: gary
+ */ 
+
+/*
+ATtiny 4313 Fuse settings: 
+~-~-~-~-~-~-~-~-~-~-~-~-~-~-
+EXTENDED = 0xFF 
+HIGH = 0xDF, or 0x5F for DebugWire enable
+LOW = 0xE4 
+*/
+
+// Frame sync of several boards in one installation, see frame_sync.c. The sync line joins PD2 (INT0) of every board,
+// the board with PD3 strapped to ground is the leader and drives it, only one may be. The boards start their sequence
+// together on a turn the leader marks, 8.4s after its power up, power them up within a few seconds of each other. A
+// board without pulses starts alone 0.8s later and runs free
+//#define FRAME_SYNC
+
+#define F_CPU 8000000UL
+#include <avr/io.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <avr/pgmspace.h>
+#include "../Common/timer_wheel.h"
+#include "../Common/stack_check.h"
+#include "frame_sync.h"
+
+
+
+#define XLAT_LOW()	PORTD &= ~_BV(PORTD0)
+#define XLAT_HIGH()	PORTD |=  _BV(PORTD0)
+#define BLANK_LOW()	PORTB &= ~_BV(PORTB4)	
+#define BLANK_HIGH()PORTB |=  _BV(PORTB4)
+#define SYNC_LOW()	PORTD &= ~_BV(PORTD2)
+#define SYNC_HIGH()	PORTD |=  _BV(PORTD2)
+
+
+#define N_LEDS	8
+#define N_GRAYSCALE 12		// NOTE: These are only the Gray scale steps 1based , additionally there is 0 for all off and 13 for all on (MAX brightness)
+#define LEDS_OFF 0
+#define LEDS_MAX N_GRAYSCALE+1
+
+#define FRAMES_P_SECOND	48	// evenly divisible by 8 and 24 
+#define FRAME_EXPOSURE_MS	20	// about 20 ms exposure per frame
+
+#define TICK_MS			1	// Timer0 compare match, drives the timer wheel, see HW_init()
+#define MS_TICKS(ms)	((ms) / TICK_MS)
+
+#define TLC_GS_CYCLE_US	1025	// gray scale cycle of the TLC5947, 4096 + 5 clocks of its oscillator, see Dim_Set()
+#define DIM_PERIODS_MAX	8		// BLANK period of the dimmer at most, in gray scale cycles
+#define DIM_FULL		255
+#define MASTER_LEVEL	DIM_FULL	// brightness of the whole board, lower it to limit every pattern
+#define FADE_IN_MS		2		// per level step when a sequence starts, 0.5s from dark
+
+typedef enum Colors {BLU=0,RED,GRN,N_COLOR} t_Color;
+typedef enum Direction {CCW,CW,ALTERNATE} t_dir;
+typedef enum Up_Down { TRIANGLE=0,UP,DOWN=-1} t_up_down;
+uint8_t LedArray[N_LEDS][N_COLOR];	
+uint8_t EEMEM EE_flashSequence_index;	 
+uint16_t Stack_free;		// least RAM left over the stack since the reset, a watch for the debugger, see stack_check.c
+	
+extern unsigned char SPI_Xfer( unsigned char );
+
+
+void 
+HW_init(void)
+{
+	int i;
+
+	cli();
+	// set CPU clock divider to 1
+	// CLOCK source is selected by fuses and can not be  changed in the program
+	// Set fuses to 8Mhz and NO CLKDIV
+
+	// Watchdog 
+	// Watchdog is controlled by a fuse setting and can not be disabled by a program when the fuse is set
+	// Make sure the Watchdog fuse is not set 
+
+	// Port directions
+	DDRD |= _BV(PORTD0); //PD0 as output for TLC5947 XLAT signal  
+	DDRB |= _BV(PORTB4); //PB4 as output for TLC5947 Blank signal
+	DDRB |= _BV(PORTB6); //PB6 as output for USI Pin DO, connected to TLC5947 SIN
+	DDRB |= _BV(PORTB7); //PB7 as output for USI pin USCK, connected to TLC5947 SCLK
+	
+	PORTB = 0;			// Make sure DO and USCK are low to begin with 
+
+	BLANK_HIGH();	// Turn All The LEDs off -- nor really needed 
+	
+	// set all GrayScale values to 0 in the TLC
+	for (i = 0; i < 36; i++)
+	{
+		SPI_Xfer(0);
+	}
+	
+	XLAT_HIGH();	// Latch it to the outputs
+	XLAT_LOW();		// 
+	
+	BLANK_LOW();	// Turn all The LEDs active 
+
+	// Timer0 CTC at 8Mhz/64/125 = 1ms, the tick of the timer wheel (Common/timer_wheel.c), all timing comes from it
+	TCCR0A = _BV(WGM01);
+	OCR0A = 124;
+	TCCR0B = _BV(CS01) | _BV(CS00);
+	TIMSK |= _BV(OCIE0A);
+
+	// USI config for 3wire SPI master mode in spiXfer()
+}
+
+
+#ifdef FRAME_SYNC
+static bool sync_leader;
+static sync_pll_t sync_pll;
+#endif
+
+ISR(TIMER0_COMPA_vect, ISR_BLOCK)
+{
+	TW_Tick();
+#ifdef FRAME_SYNC
+	Sync_Tick(&sync_pll, TW_ticks, (PIND & _BV(PIND2)) != 0);
+	if (sync_leader)
+	{
+		if (TW_ticks == 0)		// a 1ms pulse every SYNC_TICKS ticks, longer on the turn before the sequence starts
+			SYNC_HIGH();
+		else if (TW_ticks == Sync_PulseTicks(&sync_pll))
+			SYNC_LOW();
+	}
+	else
+		OCR0A = Sync_TickOcr(&sync_pll);
+#endif
+}
+
+
+#ifdef FRAME_SYNC
+// Sync pulse from the leader, the phase of this board's tick against it
+ISR(INT0_vect, ISR_BLOCK)
+{
+	uint8_t tcnt = TCNT0;
+	uint8_t ticks = TW_ticks;
+	uint8_t turns = sync_pll.turns;
+
+	if ((TIFR & _BV(OCF0A)) && tcnt < SYNC_TICK_COUNTS / 2)	// the counter restarted, its tick not counted yet
+	{
+		if (++ticks == 0)
+			turns++;
+	}
+	Sync_Edge(&sync_pll, turns, ticks, tcnt, OCR0A);
+}
+
+
+// The strap on PD3 picks the leader. The leader drives the sync line, the followers listen on INT0 for its rising
+// edge, the pull-up keeps a board without the line quiet
+static void
+Sync_Init(void)
+{
+	DDRD &= ~(_BV(PORTD2) | _BV(PORTD3));
+	PORTD |= _BV(PORTD2) | _BV(PORTD3);
+	__asm__ __volatile__ ("nop\n\tnop");	// through the pin synchronizer
+	sync_leader = (PIND & _BV(PIND3)) == 0;
+	if (sync_leader)
+	{
+		SYNC_LOW();
+		DDRD |= _BV(PORTD2);
+		sync_pll.start_turn = SYNC_MARK_TURN + 1;
+	}
+	else
+	{
+		MCUCR |= _BV(ISC01) | _BV(ISC00);	// rising edge
+		GIFR = _BV(INTF0);
+		GIMSK |= _BV(INT0);
+	}
+}
+#endif
+
+
+// Global dimmer: Timer1 drives BLANK on its OC1B pin (PB4), so the whole board dims with no SPI traffic and no CPU
+// time, over any pattern. BLANK going low starts a gray scale cycle of the TLC5947 from 0 and the cycles repeat while
+// it stays low. Timer1 holds BLANK low for exactly one cycle and high for the rest of its period, every LED shows its
+// whole gray scale value once per period and all of them scale by the same factor, level / 255. The period grows as
+// the level falls, to just under DIM_PERIODS_MAX cycles (8.2ms) at level 32. From 31 down the period is those cycles
+// and the low window gets shorter than a cycle: the LEDs brighter than the window come down to it, a limiter more
+// than a dimmer.
+//
+// The oscillator of the TLC5947 is only good for 2.4 to 5.6MHz, 4MHz typical. If the brightest LEDs (gray scale
+// 0xfff) clip or flicker at the lower levels, measure a cycle on an output and set TLC_GS_CYCLE_US to it.
+static uint8_t dim_level, dim_target, dim_fade_ms;
+static tw_timer_t dim_timer;
+
+
+static void
+Dim_Init(void)
+{
+	// Timer1 fast PWM with TOP == OCR1A, 8Mhz/8 = 1us per tick. OCR1A and OCR1B are double buffered, a new level
+	// starts with the next period
+	TCCR1A = _BV(WGM11) | _BV(WGM10);
+	TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS11);
+}
+
+
+// Master brightness, 0 == off .. 255 == the gray scale values as they are
+static void
+Dim_Set(uint8_t level)
+{
+	uint16_t period, low;
+
+	dim_level = level;
+	if (level == 0 || level == DIM_FULL)
+	{
+		TCCR1A = _BV(WGM11) | _BV(WGM10);	// BLANK back to the port
+		if (level)
+			BLANK_LOW();
+		else
+			BLANK_HIGH();
+		return;
+	}
+	if (level > DIM_FULL / DIM_PERIODS_MAX)		// period at most DIM_PERIODS_MAX cycles
+	{
+		low = TLC_GS_CYCLE_US;
+		period = (uint32_t)TLC_GS_CYCLE_US * DIM_FULL / level;
+	}
+	else
+	{
+		period = TLC_GS_CYCLE_US * DIM_PERIODS_MAX;
+		low = (uint32_t)period * level / DIM_FULL;
+	}
+	OCR1A = period - 1;
+	OCR1B = period - low - 1;		// BLANK high from BOTTOM to here, low from here to TOP
+	TCCR1A = _BV(COM1B1) | _BV(WGM11) | _BV(WGM10);
+}
+
+
+static void
+Dim_FadeStep(void)
+{
+	if (dim_level == dim_target)
+		return;
+	Dim_Set(dim_level < dim_target ? dim_level + 1 : dim_level - 1);
+	TW_Start(&dim_timer, MS_TICKS(dim_fade_ms), 0, Dim_FadeStep);
+}
+
+
+// Moves the master brightness to level, a step every ms milliseconds, from the timer wheel
+static void
+Dim_Fade(uint8_t level, uint8_t ms)
+{
+	dim_target = level;
+	dim_fade_ms = ms;
+	Dim_FadeStep();
+}
+
+
+// The pattern running is stepped by a timer, each step shows a frame and returns how long it stays, in ms. Nothing
+// waits in between, the CPU sleeps until the next tick. Only one pattern runs at a time, their state shares the RAM
+typedef uint16_t (*t_effect)(void);		// one step, returns the ms to the next one, 0 when the pattern is over
+
+static t_effect effect;
+static tw_timer_t effect_timer;
+
+static union
+{
+	struct
+	{
+		t_dir direction, dir;
+		uint8_t speed, interval_S;
+		uint16_t duration, i;
+	} round;
+	struct
+	{
+		uint8_t max, delay_ms;
+		bool r, g, b;
+		int8_t br, u_d;
+		t_up_down up_down;
+	} flash;
+	struct
+	{
+		uint8_t delay_ms, phase;
+		t_Color col[3];
+		int8_t n;
+	} thump;
+	struct
+	{
+		uint8_t chance, decay, colors;
+		uint8_t v[N_LEDS], col[N_LEDS];
+	} twinkle;
+	struct
+	{
+		uint8_t flicker;
+		uint8_t heat[N_LEDS], target[N_LEDS];
+	} fire;
+	struct
+	{
+		int8_t speed_a, speed_b;
+		uint8_t a, b, hue;
+	} plasma;
+} fx;
+
+
+static void
+Effect_Step(void)
+{
+	uint16_t ms = effect();
+
+	Stack_free = Stack_Unused();	// the deepest calls of the board are in a step
+	if (ms)
+		TW_Start(&effect_timer, MS_TICKS(ms), 0, Effect_Step);
+}
+
+
+static void
+Effect_Run(t_effect e)
+{
+	effect = e;
+	Effect_Step();
+}
+
+
+void
+set_TLC5947_Grayscale(void)
+{
+	unsigned char *cp;
+	signed char lum;
+	unsigned short led_a, led_b;
+ 
+	// loop to fill the TLC5947 shift register with 12bit x 24Led data -- Led nomenclature as per TLC5947 pin-out
+	cp = &LedArray[N_LEDS-1][N_COLOR-1]; // start at end of array and work backwards-- Must send most sig bit of LED 23 first
+
+	for (cp = &LedArray[N_LEDS-1][N_COLOR-1]; cp >= &LedArray[0][0] ; ) // Process two LEDs per iteration so we end up with 24 bits, i.e. 3 bytes to transfer each
+	{
+		lum = (*cp--);	
+		if (lum == 0)
+			led_a = 0;
+		else if (lum > N_GRAYSCALE)	
+			led_a = 0xfff;
+		else	
+			led_a = 1 << (lum-1);	// LED23  gray scale lookup, ... LED21, ... .... LED 1
+		
+		lum = (*cp--);
+		if (lum == 0)
+			led_b = 0;
+		else if( lum > N_GRAYSCALE)
+			led_b = 0xfff;
+		else 	
+			led_b = 1 << (lum-1);	// LED22  gray scale lookup, ... LED20. ... .... LED 0
+		
+		SPI_Xfer(( led_a & 0x0ff0) >> 4 );	// store 8 most significant bits of 1st LED value into transmit register
+		SPI_Xfer(((led_a & 0x00f) << 4 ) | ( (led_b & 0xf00) >>8 ) );  // Store 4 least sig. bits of led a and 4 most sig. bits of led b
+		SPI_Xfer(  led_b & 0xff);
+	}
+	XLAT_HIGH();	// Latch it to the outputs
+	XLAT_LOW();		//
+}
+
+
+void
+rotate_one_led( t_dir dir)	// Rotate the entire LED matrix by one tri-color LED position (8 tri-color leds) 
+{
+	// Rotate the pattern CCW
+		short n;
+		unsigned char r,b,g;
+						
+		if (dir == CCW)
+		{
+			b = LedArray[0][BLU];
+			r = LedArray[0][RED];
+			g = LedArray[0][GRN];
+			for(n =0; n < N_LEDS-1; n++)
+			{
+				LedArray[n][BLU] = LedArray[n+1][BLU];
+				LedArray[n][RED] = LedArray[n+1][RED];
+				LedArray[n][GRN] = LedArray[n+1][GRN];
+				
+			}
+			LedArray[n][BLU] = b;
+			LedArray[n][RED] = r;
+			LedArray[n][GRN] = g;
+		}
+		else
+		{
+			b = LedArray[N_LEDS-1][BLU];
+			r = LedArray[N_LEDS-1][RED];
+			g = LedArray[N_LEDS-1][GRN];
+			for(n=N_LEDS-2; n >=0; n--)
+			{
+				LedArray[n+1][BLU] = LedArray[n][BLU];
+				LedArray[n+1][RED] = LedArray[n][RED];
+				LedArray[n+1][GRN] = LedArray[n][GRN];
+				
+			}
+			LedArray[0][BLU] = b;
+			LedArray[0][RED] = r;
+			LedArray[0][GRN] = g;	
+		}				
+}
+
+
+void
+rotate_led_color(void)
+{
+	// Rotate the LED matrix by one color . i.e Green becomes Red & Red => Blue & Blue => Green -- only one diection
+	unsigned char n;
+	unsigned char t;
+	for(n =0; n < N_LEDS; n++)
+	{
+		t =LedArray[n][0];
+		LedArray[n][0] = LedArray[n][1];
+		LedArray[n][1] = LedArray[n][2];
+		LedArray[n][2] = t;
+	}
+	
+}
+/* Function to run a light patter in a circular motion, changing direction of rotation and colors along the way.
+ *	
+ 
+   Arguments: 
+		direction: The sense of rotation ClockWise, Counter Clock Wise or Alternating
+		speed:     The speed of the chasing pattern, low numbers == faster speed. E.g. settng this to Frames_per_Second
+		           and the pattern will advance one position per second. Using 0 the pattern will not appear to move
+		interval:  time until the color and the direction changes (if set to Alternate). 
+				   Note: the colors are swapped in one direction only. If color mixing is present i.e. more than
+				         one color turned on the array, rotating through the colors will yield 3 distinct colors.
+		duration:  overall duration of execution of the pattern. If set to 0 the pattern continues indefinitely  				   
+
+ */
+
+static uint16_t
+RoundAbout_Step(void)
+{
+	if (fx.round.duration)			// if duration is not zero decrement and stop when elapsed
+	{
+		if (--fx.round.duration == 0)
+			return 0;
+	}
+
+	// Advance the pattern by one LED position
+	if (fx.round.speed && fx.round.i % fx.round.speed == 0)
+	{
+		rotate_one_led(fx.round.dir);
+		set_TLC5947_Grayscale();	// Send LED pattern out to the LED driver chip
+	}
+
+	if (++fx.round.i == FRAMES_P_SECOND * fx.round.interval_S)	// n seconds are up
+	{
+		fx.round.i = 0;
+		rotate_led_color();
+		if (fx.round.direction == ALTERNATE)
+		{
+			fx.round.dir++;
+			if (fx.round.dir == ALTERNATE)
+				fx.round.dir = 0;
+		}
+	}
+	return FRAME_EXPOSURE_MS;		// about 20 ms exposure per frame
+}
+
+
+void
+RoundAbout(t_dir direction, uint8_t speed , uint8_t interval_S, uint16_t duration)
+{
+	fx.round.direction = direction;
+	if (direction == ALTERNATE ) 
+		fx.round.dir = CW;
+	else 
+		fx.round.dir = direction;
+	fx.round.speed = speed;
+	fx.round.interval_S = interval_S;
+	fx.round.duration = duration * FRAMES_P_SECOND;		// Duration of the run in frame counts
+	fx.round.i = 0;
+	Effect_Run(RoundAbout_Step);
+}
+
+
+/* Function to run flash all LEDs in a ascending or decaying mode.
+ *	
+   Arguments: 
+		BR:		The Maximum brightness of the LEDs. 
+		R,G,B	boolean flags indicating the use of the individual colors, 6 colors plus white possible
+		delay:  In ms, the rate of pulsating. The pattern pulsates at (N_LEDS+2) * delay rate. 
+		up_down: -1 == initially bright then decaying, +1 == initially off then ascending, 0 == ascend then decay.
+				 There is an extra delay when at 0 intensity.
+		
+*/	
+	
+static uint16_t
+Flash_Step(void)
+{
+	uint16_t ms = fx.flash.delay_ms;
+
+	if (fx.flash.up_down == TRIANGLE)
+	{
+		if (fx.flash.br >= fx.flash.max)
+			fx.flash.u_d = -1;
+		else if (fx.flash.br <= LEDS_OFF)
+			fx.flash.u_d = 1;
+	}
+	else if (fx.flash.br < LEDS_OFF)
+		fx.flash.br = fx.flash.max;
+	else if (fx.flash.br > fx.flash.max)
+		fx.flash.br = LEDS_OFF;
+
+	for( int i =0 ; i<N_LEDS;i++)
+	{
+		LedArray[i][RED] = fx.flash.br*fx.flash.r;
+		LedArray[i][GRN] = fx.flash.br*fx.flash.g;
+		LedArray[i][BLU] = fx.flash.br*fx.flash.b;
+	}
+	set_TLC5947_Grayscale();
+
+	if (fx.flash.br == 0)			// Give extra delay when lights are out
+		ms *= 2;
+	fx.flash.br += fx.flash.u_d;
+	return ms;
+}
+
+
+void
+Flash(uint8_t BR, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
+{
+	fx.flash.max = BR;
+	fx.flash.r = R;
+	fx.flash.g = G;
+	fx.flash.b = B;
+	fx.flash.delay_ms = delay_ms;
+	fx.flash.up_down = up_down;
+	if (up_down == DOWN)
+	{
+		fx.flash.br = BR;
+		fx.flash.u_d = -1;
+	}
+	else
+	{
+		fx.flash.br = LEDS_OFF;
+		fx.flash.u_d = 1;
+	}
+	memset(LedArray,0,sizeof(LedArray)); 
+	Effect_Run(Flash_Step);
+}
+
+
+// Heartbeat 
+static void
+Thump_Set(t_Color col, int8_t n)
+{
+	for( int i =0 ; i<N_LEDS;i++)
+	{
+		LedArray[i][col] = n;
+	}
+	set_TLC5947_Grayscale();
+}
+
+
+// A strong beat fading from full, a weak one getting brighter, a long fade out, then a pause
+static uint16_t
+ThumpThump_Step(void)
+{
+	switch (fx.thump.phase)
+	{
+		case 0:
+			Thump_Set(fx.thump.col[0], fx.thump.n);
+			if (--fx.thump.n == 7)
+			{
+				memset(LedArray,0,sizeof(LedArray)); 
+				fx.thump.phase = 1;
+			}
+			return fx.thump.delay_ms/2;
+
+		case 1:
+			Thump_Set(fx.thump.col[1], fx.thump.n);
+			if (++fx.thump.n == 10)
+			{
+				memset(LedArray,0,sizeof(LedArray)); 
+				fx.thump.phase = 2;
+			}
+			return fx.thump.delay_ms/2;
+
+		case 2:
+			Thump_Set(fx.thump.col[2], fx.thump.n);
+			if (fx.thump.n-- == LEDS_OFF)
+				fx.thump.phase = 3;
+			return fx.thump.delay_ms;
+
+		default:
+			memset(LedArray,0,sizeof(LedArray)); 
+			fx.thump.n = 13;
+			fx.thump.phase = 0;
+			return fx.thump.delay_ms*2;
+	}
+}
+
+
+void
+ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 )
+{
+	fx.thump.delay_ms = delay_ms;
+	fx.thump.col[0] = col1;
+	fx.thump.col[1] = col2;
+	fx.thump.col[2] = col3;
+	fx.thump.n = 13;
+	fx.thump.phase = 0;
+	memset(LedArray,0,sizeof(LedArray)); 
+	Effect_Run(ThumpThump_Step);
+}
+
+
+// Procedural effects: twinkle, fire and plasma work every frame out anew from a random generator and a sine table
+// instead of moving a pattern around. They are in 8 bit fixed point, 0..255 for off..LEDS_MAX, Fx_Level() makes the
+// gray scale level of LedArray from it. A level is twice the light of the one below, so a value falling at a steady
+// rate is light decaying exponentially, the way a glow does.
+//
+// Cost of a step at 8MHz, counted from the code, Tools/avrcycles/bench.txt measures the build: Twinkle_Step about 500
+// cycles, Fire_Step about 800, Plasma_Step about 1500, each plus some 5000 for set_TLC5947_Grayscale(). Under 1ms of
+// the 20ms frame. The tiny core has no MUL, the arithmetic is shifts and adds. RAM: twinkle has the largest state,
+// 19 bytes of the fx union. The sine table is in flash.
+static uint16_t fx_seed = 0xace1;		// the same sparkles after every reset
+
+// a quarter of a sine wave, 127 * sin((i + 0.5) * 2pi / 256)
+static const uint8_t fx_sine[64] PROGMEM =
+{
+	  2,   5,   8,  11,  14,  17,  20,  23,  26,  29,  32,  35,  38,  41,  44,  47,
+	 50,  53,  56,  58,  61,  64,  67,  69,  72,  74,  77,  79,  82,  84,  86,  89,
+	 91,  93,  95,  97,  99, 101, 103, 105, 106, 108, 110, 111, 113, 114, 115, 117,
+	118, 119, 120, 121, 122, 123, 124, 124, 125, 125, 126, 126, 127, 127, 127, 127
+};
+
+
+// xorshift16 (7, 9, 8), runs through all 65535 states but 0
+static uint8_t
+Fx_Rand(void)
+{
+	uint16_t x = fx_seed;
+
+	x ^= x << 7;
+	x ^= x >> 9;
+	x ^= x << 8;
+	fx_seed = x;
+	return x >> 8;
+}
+
+
+// 128 + 127 * sin(x * 2pi / 256), 1..255
+static uint8_t
+Fx_Sin8(uint8_t x)
+{
+	uint8_t i = x & 0x3f, s;
+
+	if (x & 0x40)
+		i = 63 - i;
+	s = pgm_read_byte(&fx_sine[i]);
+	return (x & 0x80) ? 128 - s : 128 + s;
+}
+
+
+// 0..255 to LEDS_OFF..LEDS_MAX, v * 14 / 256
+static uint8_t
+Fx_Level(uint8_t v)
+{
+	return (((uint16_t)v << 4) - ((uint16_t)v << 1)) >> 8;
+}
+
+
+/* Random twinkle: now and then a LED lights up full in a random mix of the colors given and decays.
+ *
+   Arguments:
+		chance:	of a new sparkle each frame, out of 256
+		decay:	taken off the 8 bit brightness each frame, 255 / decay frames from full to off
+		R,G,B	boolean flags of the colors a sparkle may have
+*/
+
+static uint16_t
+Twinkle_Step(void)
+{
+	uint8_t i, c, r, lum;
+
+	for (i = 0; i < N_LEDS; i++)
+	{
+		r = fx.twinkle.v[i];
+		fx.twinkle.v[i] = r > fx.twinkle.decay ? r - fx.twinkle.decay : 0;
+	}
+	if (Fx_Rand() < fx.twinkle.chance)
+	{
+		r = Fx_Rand();
+		i = r & (N_LEDS - 1);			// N_LEDS is a power of 2
+		c = (r >> 3) & fx.twinkle.colors;
+		fx.twinkle.col[i] = c ? c : fx.twinkle.colors;
+		fx.twinkle.v[i] = 255;
+	}
+
+	for (i = 0; i < N_LEDS; i++)
+	{
+		lum = Fx_Level(fx.twinkle.v[i]);
+		for (c = 0; c < N_COLOR; c++)
+			LedArray[i][c] = (fx.twinkle.col[i] & _BV(c)) ? lum : LEDS_OFF;
+	}
+	set_TLC5947_Grayscale();
+	return FRAME_EXPOSURE_MS;
+}
+
+
+void
+Twinkle(uint8_t chance, uint8_t decay, _Bool R, _Bool G, _Bool B)
+{
+	fx.twinkle.chance = chance;
+	fx.twinkle.decay = decay;
+	fx.twinkle.colors = R << RED | G << GRN | B << BLU;
+	memset(fx.twinkle.v, 0, sizeof(fx.twinkle.v));
+	memset(fx.twinkle.col, 0, sizeof(fx.twinkle.col));
+	Effect_Run(Twinkle_Step);
+}
+
+
+/* Flicker fire: every LED glows on its own, its heat creeps a quarter of the way to a random target each frame, a
+ * smoothed noise. The targets are mostly in the upper half with a dip to almost out now and then. Red follows the
+ * heat, green 5 levels (1/32) under it makes the orange, yellower when it flares.
+ *
+   Arguments:
+		flicker: chance a LED gets a new target each frame, out of 256, higher is more restless
+*/
+
+static uint16_t
+Fire_Step(void)
+{
+	uint8_t i, r, h, t, lum;
+
+	for (i = 0; i < N_LEDS; i++)
+	{
+		if (Fx_Rand() < fx.fire.flicker)
+		{
+			r = Fx_Rand();
+			fx.fire.target[i] = r < 40 ? r : r | 0x80;
+		}
+		h = fx.fire.heat[i];
+		t = fx.fire.target[i];
+		if (t > h)
+			h += (t - h + 3) >> 2;		// at least 1, never past the target
+		else
+			h -= (h - t + 3) >> 2;
+		fx.fire.heat[i] = h;
+
+		lum = Fx_Level(h);
+		LedArray[i][RED] = lum;
+		LedArray[i][GRN] = lum > 5 ? lum - 5 : LEDS_OFF;
+		LedArray[i][BLU] = LEDS_OFF;
+	}
+	set_TLC5947_Grayscale();
+	return FRAME_EXPOSURE_MS;
+}
+
+
+void
+Fire(uint8_t flicker)
+{
+	fx.fire.flicker = flicker;
+	memset(fx.fire.heat, 0, sizeof(fx.fire.heat));
+	memset(fx.fire.target, 0, sizeof(fx.fire.target));
+	Effect_Run(Fire_Step);
+}
+
+
+/* Plasma: two sine waves travel around the ring, one wave round it and one twice round, at their own speeds. Their
+ * sum picks each LED's place on a color wheel, red, green and blue each light the top half of a sine a third apart,
+ * and the wheel turns slowly on its own.
+ *
+   Arguments:
+		speed_a, speed_b: steps of the two waves per frame, 256 a turn, negative runs the other way
+*/
+
+// One color of the wheel, the top half of the sine stretched to 0..254
+static uint8_t
+Plasma_Color(uint8_t x)
+{
+	uint8_t s = Fx_Sin8(x);
+
+	return s > 128 ? (uint8_t)((s - 128) << 1) : 0;
+}
+
+
+static uint16_t
+Plasma_Step(void)
+{
+	uint8_t i, v;
+
+	for (i = 0; i < N_LEDS; i++)
+	{
+		v = (Fx_Sin8(fx.plasma.a + i * (256 / N_LEDS)) >> 1) + (Fx_Sin8(fx.plasma.b - i * (512 / N_LEDS)) >> 1);
+		v += fx.plasma.hue;
+		LedArray[i][RED] = Fx_Level(Plasma_Color(v));
+		LedArray[i][GRN] = Fx_Level(Plasma_Color(v + 85));
+		LedArray[i][BLU] = Fx_Level(Plasma_Color(v + 170));
+	}
+	set_TLC5947_Grayscale();
+
+	fx.plasma.a += fx.plasma.speed_a;
+	fx.plasma.b += fx.plasma.speed_b;
+	fx.plasma.hue++;
+	return FRAME_EXPOSURE_MS;
+}
+
+
+void
+Plasma(int8_t speed_a, int8_t speed_b)
+{
+	fx.plasma.speed_a = speed_a;
+	fx.plasma.speed_b = speed_b;
+	fx.plasma.a = 0;
+	fx.plasma.b = 0;
+	fx.plasma.hue = 0;
+	Effect_Run(Plasma_Step);
+}
+
+
+// The power on wait is over, picks the next sequence
+static void
+Sequence_Start(void)
+{
+	uint8_t fl_seq;
+
+	fl_seq = eeprom_read_byte(&EE_flashSequence_index);		// get the last sequence number from the EEPROM and advance to the next 
+	eeprom_write_byte(&EE_flashSequence_index,++fl_seq);	// store the next seq number in EEPROM 
+	
+	
+	Dim_Set(0);				// every sequence fades in from dark
+	Dim_Fade(MASTER_LEVEL, FADE_IN_MS);
+
+	switch (fl_seq)
+	{
+		case 1:
+			//ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 ) 
+			ThumpThump(80,RED, RED,RED);
+			break;
+		
+		case 2:
+			//ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 )
+			ThumpThump(80,GRN, GRN,GRN);
+			break;
+		
+		case 3:
+			//ThumpThump( uint8_t delay_ms, t_Color col1, t_Color col2, t_Color col3 )
+			ThumpThump(80,RED, GRN,BLU);
+			break;
+			
+		case 4:
+			//Flash(uint8_t BRirightness, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
+			Flash( 12,0,0,1,70,UP);
+			break;
+		
+		case 5:
+			//Flash(uint8_t BRirightness, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
+			Flash( 12,0,1,0,70,DOWN);
+			break;
+			
+		case 6:
+			//Flash(uint8_t BRirightness, _Bool R, _Bool G, _Bool B, uint8_t delay_ms, t_up_down up_down )
+			Flash( 12,1,0,0,50,TRIANGLE);
+			break;
+			
+		case 7:
+			memset(LedArray,0,sizeof(LedArray)); 
+			LedArray[0][BLU] = 3; // long trail	
+			LedArray[1][BLU] = 4; 
+			LedArray[2][BLU] = 5;	
+			LedArray[3][BLU] = 6;	
+			LedArray[4][BLU] = 7; 
+			LedArray[5][GRN] = 10;	//White head
+			LedArray[5][RED] = 10;
+			LedArray[5][BLU] = 10;
+			//RoundAbout(t_dir direction, uint8_t speed , uint8_t interval_S, uint16_t duration)
+			RoundAbout(CW,4,5,0);
+			break;
+			
+		case 8:
+			memset(LedArray,0,sizeof(LedArray));
+			LedArray[5][BLU] = 3; // long trail
+			LedArray[4][BLU] = 4;
+			LedArray[3][BLU] = 5;
+			LedArray[2][BLU] = 6;
+			LedArray[1][BLU] = 7;
+			LedArray[0][GRN] = 10;	//White head
+			LedArray[0][RED] = 10;
+			LedArray[0][BLU] = 10;
+			RoundAbout(CCW,4,5,0);
+			break;
+			
+		case 9:
+			memset(LedArray,0,sizeof(LedArray)); 
+			LedArray[0][GRN] = 4;	
+			LedArray[1][GRN] = 10; // trail
+			LedArray[2][GRN] = 4;	
+			//RoundAbout( direction, speed,interval_S,  duration)
+			RoundAbout(ALTERNATE,1,3,0);
+			break;
+			
+		case 10:
+			memset(LedArray,0,sizeof(LedArray));
+			LedArray[0][GRN] = 3;
+			LedArray[1][GRN] = 11; // dot
+			LedArray[2][GRN] = 3;
+			LedArray[0][RED] = 4;
+			LedArray[1][RED] = 11; // dot
+			LedArray[2][RED] = 4;
+			LedArray[0][BLU] = 6;
+			LedArray[1][BLU] = 11; // dot
+			LedArray[2][BLU] = 6;
+			RoundAbout(CCW,3,4,0);
+			break;
+	
+		case 11:
+			memset(LedArray,0,sizeof(LedArray));
+			LedArray[0][RED] = 4;
+			LedArray[1][RED] = 10; // trail
+			LedArray[2][RED] = 4;
+			LedArray[0][BLU] = 4;
+			LedArray[1][BLU] = 10; // trail
+			LedArray[2][BLU] = 4;
+			RoundAbout(ALTERNATE,3,4,0);
+			break;
+
+		case 12:
+			//Twinkle(uint8_t chance, uint8_t decay, _Bool R, _Bool G, _Bool B)
+			Twinkle(40,6,1,1,1);
+			break;
+
+		case 13:
+			//Fire(uint8_t flicker)
+			Fire(60);
+			break;
+
+		case 14:
+			//Plasma(int8_t speed_a, int8_t speed_b)
+			Plasma(3,-2);
+			break;
+
+		default :	// default case -- end of possible choices, indicate by static pattern and reset fl_seq in eeprom to start from the beginning again
+			fl_seq = 0;	
+			eeprom_write_byte(&EE_flashSequence_index,fl_seq);
+			LedArray[0][RED] = 6; 
+			LedArray[1][GRN] = 6;
+			LedArray[2][BLU] = 6;
+			LedArray[3][RED] = 6;
+			LedArray[4][GRN] = 6;
+			LedArray[5][BLU] = 6;	
+			LedArray[6][RED] = 6;
+			LedArray[7][GRN] = 6;
+			LedArray[7][RED] = 6;
+			set_TLC5947_Grayscale();
+			break;
+
+	}	
+}
+
+
+#ifdef FRAME_SYNC
+static tw_timer_t sync_turn;
+
+
+// At every turn of the wheel, on the ticks the leader's turns start. The sequence started from here steps on the same
+// ticks on every board
+static void
+Sync_Turn(void)
+{
+	if (Sync_StartTurn(&sync_pll))
+	{
+		TW_Stop(&sync_turn);
+		Sequence_Start();
+	}
+}
+#endif
+
+
+int 
+main(void) 
+{
+#ifndef FRAME_SYNC
+	static tw_timer_t power_on;
+#endif
+
+	HW_init();
+#ifdef FRAME_SYNC
+	Sync_Init();
+#endif
+	Dim_Init();
+	Dim_Set(MASTER_LEVEL);
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sei();
+
+#ifdef FRAME_SYNC
+	TW_Start(&sync_turn, SYNC_TICKS, SYNC_TICKS, Sync_Turn);	// the wheel starts at 0 with TW_ticks
+#else
+	TW_Start(&power_on, MS_TICKS(1000), 0, Sequence_Start);	 // Power on good and solid until ee program
+#endif
+
+	for(;;)		//never exit, the patterns run from the timers
+	{
+		TW_Poll();
+		cli();
+		if (!TW_Pending())
+		{
+			sleep_enable();
+			sei();
+			sleep_cpu();		// until the next tick, the instruction after sei runs before any interrupt
+			sleep_disable();
+		}
+		sei();
+	}
+}
+
+
+
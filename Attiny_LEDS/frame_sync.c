@@ -0,0 +1,92 @@
+/*
+ * frame_sync.c
+ *
+ * Created: 10/19/2026
+ *
+ * The patterns run from the 1ms tick of Timer0 and the ATtiny runs from its RC oscillator, a percent or two off and
+ * different on every board, so boards started together are apart by a frame within seconds. With FRAME_SYNC (LEDs.c)
+ * one board, the leader, pulses the sync line every time TW_ticks turns over, every SYNC_TICKS ticks, and the others
+ * lock the phase of their own TW_ticks to it.
+ *
+ * A follower takes its phase at the pulse, TW_ticks and TCNT0, as the error against the turn over it should be at:
+ * the counts since it when it is past it, the counts still to go with the OCR0A of the tick running when it isn't.
+ * Nothing gets reset, the error goes through a PI loop filter into the trim, the Timer0 counts added to the next
+ * SYNC_TICKS ticks, and Sync_TickOcr() spreads those over the ticks as OCR0A 124 +- 1 or so. The proportional part
+ * takes half the error out by the next pulse, the integral learns the frequency error of the oscillator, after that
+ * the phase stays within a few Timer0 counts (8us each) of the leader. Per pulse:
+ *	integ += error				(8ths)
+ *	trim = integ / 8 + error / 2
+ * The integral stops while the trim is at its limit: a board started half a period off slews in at about 6% faster or
+ * slower and doesn't wind the integral up on the way.
+ *
+ * Without pulses the trim stays as it is, the board runs on at the leader's rate. The state is in a struct so the host
+ * simulator can run several boards on this code, HostSim/ledsync_sim.c.
+ *
+ * The lock only puts TW_ticks in step, the turn it is on may differ from board to board by their power up. The patterns
+ * are stepped from the timer wheel, whose times run from the reset, so for the frames to line up every board has to
+ * start its sequence on the same turn of the leader's. The leader marks turn SYNC_MARK_TURN with a pulse SYNC_MARK_TICKS
+ * long, by then the followers have locked, and starts with the next turn. A follower looks at the line SYNC_MARK_PROBE
+ * ticks after every pulse, still high is the mark, and starts with its turn after the one nearest to that pulse: the
+ * turn the loop filter puts on the leader's. Each board then starts from a wheel timer at a turn, the first step of the
+ * sequence and everything after it fall on the same ticks on all of them. A follower waits for the mark
+ * SYNC_MARK_TURN + SYNC_MARK_WAIT turns from its first pulse, or from its reset while there is none, so the boards
+ * may power up in any order within a few seconds. After that it starts alone.
+ */
+#include "frame_sync.h"
+
+
+static int16_t
+Sync_Clamp(int16_t v, int16_t max)
+{
+	if (v > max)
+		return max;
+	if (v < -max)
+		return -max;
+	return v;
+}
+
+
+// A sync pulse came in, turns, ticks, tcnt and ocr are the turns, TW_ticks, TCNT0 and OCR0A at the edge
+void
+Sync_Edge(sync_pll_t *p, uint8_t turns, uint8_t ticks, uint8_t tcnt, uint8_t ocr)
+{
+	int16_t e, t;
+
+	if (ticks < SYNC_TICKS / 2)		// past the turn over, ahead
+	{
+		e = ticks * SYNC_TICK_COUNTS + tcnt;
+		p->edge_turn = turns;
+	}
+	else							// behind, the rest of this tick and the ticks after it
+	{
+		e = -((uint8_t)(SYNC_TICKS - 1 - ticks) * SYNC_TICK_COUNTS + (ocr + 1 - tcnt));
+		p->edge_turn = turns + 1;
+	}
+	p->error = e;
+	p->probe = SYNC_MARK_PROBE;
+	if (!p->wait_turn)
+		p->wait_turn = turns + SYNC_MARK_TURN + SYNC_MARK_WAIT;
+
+	t = p->integ / 8 + e / 2;
+	if (t < SYNC_TRIM_MAX && t > -SYNC_TRIM_MAX)
+	{
+		p->integ = Sync_Clamp(p->integ + e, SYNC_TRIM_MAX * 8);
+		t = p->integ / 8 + e / 2;
+	}
+	p->trim = Sync_Clamp(t, SYNC_TRIM_MAX);
+}
+
+
+// Called at every turn of the timer wheel, true once, at the turn the sequence starts with
+bool
+Sync_StartTurn(sync_pll_t *p)
+{
+	uint8_t start = p->start_turn;
+
+	if (!start)
+		start = p->wait_turn ? p->wait_turn : SYNC_MARK_TURN + SYNC_MARK_WAIT;
+	if (p->started || p->turns != start)
+		return false;
+	p->started = true;
+	return true;
+}
@@ -0,0 +1,70 @@
+/*
+ * frame_sync.h
+ *
+ * Created: 10/19/2026
+ *
+ * Frame sync of several LED boards, the loop filter that locks a follower's tick to the leader's pulse. See
+ * frame_sync.c
+ */
+
+#ifndef FRAME_SYNC_H_
+#define FRAME_SYNC_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define SYNC_TICKS			256			// ticks from one sync pulse to the next, a turn of TW_ticks
+#define SYNC_TICK_COUNTS	125			// Timer0 counts per tick, OCR0A + 1 untrimmed
+#define SYNC_TRIM_MAX		(8 * 256 - 1)	// +-8 counts a tick, 6.4%, two RC oscillators 3% off either way
+#define SYNC_MARK_TURN		32			// the leader marks this turn, 8.2s after power up, and starts with the next
+#define SYNC_MARK_TICKS		5			// ticks the line is high on that turn, 1 on the others
+#define SYNC_MARK_PROBE		3			// ticks after a pulse a follower looks if the line is still high
+#define SYNC_MARK_WAIT		4			// turns past SYNC_MARK_TURN a follower waits for the mark, then starts alone
+
+typedef struct sync_pll
+{
+	int16_t trim;				// Timer0 counts added to SYNC_TICKS ticks, 1/256 count to each
+	int16_t integ;				// integral of the phase error, 8ths of trim
+	int16_t error;				// phase error at the last pulse, Timer0 counts, +ve == this board ahead
+	uint8_t acc;				// fraction of trim carried from tick to tick
+	uint8_t turns;				// turns of TW_ticks since the reset
+	uint8_t edge_turn;			// this board's turn nearest to the last pulse, the turn of the leader that sent it
+	uint8_t probe;				// ticks until the look at the line after a pulse, 0 for none
+	uint8_t start_turn;			// the sequence starts with this turn, 0 while not known
+	uint8_t wait_turn;			// or alone with this one, SYNC_MARK_TURN + SYNC_MARK_WAIT turns after the first pulse
+	bool started;
+} sync_pll_t;
+
+void Sync_Edge(sync_pll_t *p, uint8_t turns, uint8_t ticks, uint8_t tcnt, uint8_t ocr);
+bool Sync_StartTurn(sync_pll_t *p);
+
+// OCR0A of the next tick: 124 plus the trim spread evenly over the ticks. Called from the compare interrupt, the
+// counter has just restarted and is still well below the new value
+static inline uint8_t
+Sync_TickOcr(sync_pll_t *p)
+{
+	uint8_t a = p->acc + (uint8_t)p->trim;
+	uint8_t ocr = SYNC_TICK_COUNTS - 1 + (p->trim >> 8) + (a < p->acc);
+
+	p->acc = a;
+	return ocr;
+}
+
+// Every tick, after TW_Tick(): counts the turns, and looks at the sync line, high, when a pulse asks for it
+static inline void
+Sync_Tick(sync_pll_t *p, uint8_t ticks, bool line)
+{
+	if (ticks == 0)
+		p->turns++;
+	if (p->probe && --p->probe == 0 && line)
+		p->start_turn = p->edge_turn + 1;		// the leader's mark, it starts with its next turn
+}
+
+// Leader: ticks the pulse of this turn lasts
+static inline uint8_t
+Sync_PulseTicks(const sync_pll_t *p)
+{
+	return p->turns == SYNC_MARK_TURN && !p->started ? SYNC_MARK_TICKS : 1;
+}
+
+#endif /* FRAME_SYNC_H_ */
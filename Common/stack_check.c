@@ -0,0 +1,56 @@
+/*
+ * stack_check.c
+ *
+ * Created: 10/19/2026
+ *
+ * Before the start up code of avr-libc sets up anything, Stack_Paint() fills the RAM from the end of .bss (_end) to
+ * the top (__stack) with STACK_CANARY. The stack grows down from the top into that, the ISR frames included, and
+ * whatever it ever reached is overwritten. Stack_Unused() counts the canary bytes left above _end, the least free
+ * RAM there ever was since the reset. Low numbers mean the stack came close to LedArray and the other variables,
+ * 0 that it ran into them.
+ *
+ * A canary byte the stack happened to write back with the same value counts as unused, so the figure can be a few
+ * bytes too good, never too bad by more than that. None of the firmwares uses malloc(), the heap doesn't get in
+ * the way. Tools/ramreport gives the figure for the worst case path from the build, this one is what really happened.
+ */
+#include "stack_check.h"
+
+#ifdef __AVR__
+
+extern uint8_t _end;				// from the linker script
+extern uint8_t __stack;
+
+void Stack_Paint(void) __attribute__((naked, used, section(".init1")));
+
+
+// Runs from .init1, no stack and no C environment yet: Z walks from _end to __stack, both included
+void
+Stack_Paint(void)
+{
+	__asm__ __volatile__ (
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (STACK_CANARY));
+}
+
+
+// Bytes above the variables the stack never touched
+uint16_t
+Stack_Unused(void)
+{
+	const uint8_t *p = &_end;
+
+	while (p <= &__stack && *p == STACK_CANARY)
+		p++;
+	return p - &_end;
+}
+
+#endif // __AVR__
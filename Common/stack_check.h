@@ -0,0 +1,26 @@
+/*
+ * stack_check.h
+ *
+ * Created: 10/19/2026
+ *
+ * Stack high-water mark of all three firmwares, from painting the free RAM at start up. See stack_check.c
+ */
+
+#ifndef STACK_CHECK_H_
+#define STACK_CHECK_H_
+
+#include <inttypes.h>
+
+#define STACK_CANARY	0xC5		// what the free RAM is painted with
+
+#ifdef __AVR__
+uint16_t Stack_Unused(void);
+#else
+static inline uint16_t
+Stack_Unused(void)					// HostSim: there is no AVR stack to look at
+{
+	return 0;
+}
+#endif
+
+#endif /* STACK_CHECK_H_ */
@@ -0,0 +1,131 @@
+/*
+ * timer_wheel.c
+ *
+ * Created: 10/19/2026
+ *
+ * A hashed timer wheel: TW_SLOTS lists of timers, the wheel moves on by one slot per tick. A timer goes into the slot
+ * its expiry falls on, with the number of whole turns still to wait, so starting and stopping one is a list insert or
+ * unlink and a tick only looks at the timers of one slot. The interrupt of the hardware tick just counts (TW_Tick()),
+ * the main loop turns the wheel by the ticks counted and calls the expired timers' functions (TW_Poll()), so those
+ * can do anything the main loop does. Timers are only started and stopped from the main loop, the lists need no
+ * locking then. A tick is only counted in a byte, TW_Poll() must run at least every 255 ticks.
+ *
+ * Each firmware drives it from a timer it already runs: the ATtiny LEDs from Timer0 at 1ms, DotClock from the Timer0
+ * overflow of the LED PWM at 4.1ms, the IR switch from the Timer1 overflow at 32.8ms.
+ */
+#include "timer_wheel.h"
+
+volatile uint8_t TW_ticks;		// counted by the interrupt
+static uint8_t tw_done;			// ticks the wheel turned for
+static uint8_t tw_cursor;		// slot of the tick last done
+static tw_timer_t *tw_slots[TW_SLOTS];
+uint8_t TW_armed;
+
+
+static void
+TW_Insert(tw_timer_t *t, tw_timer_t **list)
+{
+	t->next = *list;
+	if (t->next)
+		t->next->pprev = &t->next;
+	t->pprev = list;
+	*list = t;
+}
+
+
+static void
+TW_Unlink(tw_timer_t *t)
+{
+	*t->pprev = t->next;
+	if (t->next)
+		t->next->pprev = t->pprev;
+	t->pprev = 0;
+}
+
+
+// ticks from now, 0 counts as 1
+static void
+TW_Arm(tw_timer_t *t, uint16_t ticks)
+{
+	if (ticks == 0)
+		ticks = 1;
+	t->rounds = (ticks - 1) / TW_SLOTS;
+	TW_Insert(t, &tw_slots[(uint8_t)(tw_cursor + ticks) & (TW_SLOTS - 1)]);
+	TW_armed++;
+}
+
+
+// fn is called after ticks, then every period ticks if that isn't 0. A running timer starts over. fn may be NULL for
+// a timer that is only asked if it is still running
+void
+TW_Start(tw_timer_t *t, uint16_t ticks, uint16_t period, void (*fn)(void))
+{
+	TW_Stop(t);
+	t->period = period;
+	t->fn = fn;
+	TW_Arm(t, ticks);
+}
+
+
+void
+TW_Stop(tw_timer_t *t)
+{
+	if (!t->pprev)
+		return;
+	TW_Unlink(t);
+	TW_armed--;
+}
+
+
+// One slot. Its timers are moved to a list of their own first, the ones to wait another turn go back, the others
+// expire one by one. A function called may start or stop any timer, also one still on that list
+static void
+TW_Turn(void)
+{
+	tw_timer_t *list = 0, *t;
+	tw_timer_t **slot;
+
+	tw_cursor = (tw_cursor + 1) & (TW_SLOTS - 1);
+	slot = &tw_slots[tw_cursor];
+	if (!*slot)
+		return;
+	list = *slot;
+	list->pprev = &list;
+	*slot = 0;
+
+	while ((t = list))
+	{
+		TW_Unlink(t);
+		if (t->rounds)
+		{
+			t->rounds--;
+			TW_Insert(t, slot);
+			continue;
+		}
+		TW_armed--;
+		if (t->period)
+			TW_Arm(t, t->period);
+		if (t->fn)
+			t->fn();
+	}
+}
+
+
+// Main loop: turns the wheel for the ticks counted since, the functions of the timers that expired run from here
+void
+TW_Poll(void)
+{
+	while (tw_done != TW_ticks)
+	{
+		tw_done++;
+		TW_Turn();
+	}
+}
+
+
+// Ticks counted that the wheel hasn't turned for yet
+bool
+TW_Pending(void)
+{
+	return tw_done != TW_ticks;
+}
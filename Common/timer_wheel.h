@@ -0,0 +1,58 @@
+/*
+ * timer_wheel.h
+ *
+ * Created: 10/19/2026
+ *
+ * Software timers of all three firmwares, any number of them from one hardware tick. See timer_wheel.c
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifndef TW_SLOTS
+#define TW_SLOTS	8			// a power of 2, 2 bytes of RAM each
+#endif
+
+typedef struct tw_timer
+{
+	struct tw_timer *next;
+	struct tw_timer **pprev;	// the pointer to this one in its list, NULL when stopped
+	uint16_t rounds;			// turns of the wheel left before it expires in its slot
+	uint16_t period;			// ticks, 0 for a one shot
+	void (*fn)(void);			// called from TW_Poll(), or NULL
+} tw_timer_t;
+
+extern volatile uint8_t TW_ticks;
+
+// Hardware tick, from the interrupt of the firmware's timer. Only counts, the wheel turns in TW_Poll()
+static inline void
+TW_Tick(void)
+{
+	TW_ticks++;
+}
+
+void TW_Start(tw_timer_t *t, uint16_t ticks, uint16_t period, void (*fn)(void));
+void TW_Stop(tw_timer_t *t);
+void TW_Poll(void);
+bool TW_Pending(void);
+
+// Running, it will still expire
+static inline bool
+TW_Running(const tw_timer_t *t)
+{
+	return t->pprev != 0;
+}
+
+// Timers running, the tick must go on
+extern uint8_t TW_armed;
+
+static inline bool
+TW_Armed(void)
+{
+	return TW_armed != 0;
+}
+
+#endif /* TIMER_WHEEL_H_ */
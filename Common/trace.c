@@ -0,0 +1,109 @@
+/*
+ * trace.c
+ *
+ * Created: 10/19/2026
+ *
+ * Event trace into a RAM ring. TRACE_BEGIN(), TRACE_END() and TRACE_MARK() (trace.h) write one 4 byte record each:
+ * the event id with its kind in the top 2 bits, a byte of data and the 16 bit time of the firmware's timer. That is
+ * a few cycles with the interrupts held off, cheap enough for every ISR. Records that don't fit are counted.
+ *
+ * The ring is drained as a byte stream, Trace_Byte() hands out the next byte whenever the main loop has room for it,
+ * on a spare USART or in the host simulator. Every TRACE_SYNC_EVERY records a sync record goes first, 0xFF, F_CPU
+ * in Mhz and the prescaler of the timer, a reader that started in the middle of the stream finds the record
+ * boundaries and the time unit from it. A lost record, 0xFE and the count, goes out once the records queued before
+ * the first drop are out, Trace_Put() drops everything until then. Its time field is unused: the records were lost
+ * right after the one before it and before the one after it. Tools/tracedec turns the stream into a Chrome trace.
+ *
+ * The time wraps after 65536 timer ticks, something must be traced more often than that, the timer's overflow
+ * interrupt does.
+ */
+#include "trace.h"
+
+#ifdef TRACE
+
+#define TRACE_SYNC_EVERY	64		// records
+
+trace_rec_t Trace_ring[TRACE_SIZE];
+volatile uint8_t Trace_head;
+volatile uint8_t Trace_tail;
+volatile uint8_t Trace_lost;
+
+static uint8_t trace_out[4];		// the record going out
+static uint8_t trace_out_ndx = sizeof(trace_out);
+static uint8_t trace_sync;			// records until the next sync record, 0: one is due
+static uint8_t trace_mhz;
+static uint16_t trace_prescale;
+
+
+void
+Trace_Init(uint8_t mhz, uint16_t prescale)
+{
+	trace_mhz = mhz;
+	trace_prescale = prescale;
+	trace_sync = 0;
+}
+
+
+static void
+Trace_Out(uint8_t id, uint8_t arg, uint16_t time)
+{
+	trace_out[0] = id;
+	trace_out[1] = arg;
+	trace_out[2] = time;
+	trace_out[3] = time >> 8;
+	trace_out_ndx = 0;
+}
+
+
+// The next record into trace_out, false when there is none
+static bool
+Trace_Next(void)
+{
+	uint8_t tail = Trace_tail;
+	uint8_t sreg;
+	trace_rec_t *r;
+
+	if (tail == Trace_head && !Trace_lost)
+		return false;
+	if (trace_sync == 0)
+	{
+		Trace_Out(TRACE_SYNC, trace_mhz, trace_prescale);
+		trace_sync = TRACE_SYNC_EVERY;
+		return true;
+	}
+	trace_sync--;
+	if (Trace_lost && tail == Trace_head)		// the records older than the drops are out
+	{
+		sreg = SREG;
+		cli();
+		Trace_Out(TRACE_LOST, Trace_lost, 0);
+		Trace_lost = 0;
+		SREG = sreg;
+		return true;
+	}
+	r = &Trace_ring[tail & (TRACE_SIZE-1)];
+	Trace_Out(r->id, r->arg, r->time);
+	Trace_tail = tail + 1;			// after the record was read, Trace_Put() may reuse the slot
+	return true;
+}
+
+
+// Next byte of the stream, false when there is nothing to send
+bool
+Trace_Byte(uint8_t *c)
+{
+	if (trace_out_ndx == sizeof(trace_out) && !Trace_Next())
+		return false;
+	*c = trace_out[trace_out_ndx++];
+	return true;
+}
+
+
+// Records waiting or one going out
+bool
+Trace_Busy(void)
+{
+	return trace_out_ndx != sizeof(trace_out) || Trace_tail != Trace_head || Trace_lost;
+}
+
+#endif // TRACE
@@ -0,0 +1,108 @@
+/*
+ * trace.h
+ *
+ * Created: 10/19/2026
+ *
+ * Event trace of the ISRs and the main loop, for seeing how they interleave. Only built with TRACE defined, without
+ * it the TRACE_ macros are empty. See trace.c
+ *
+ * A firmware includes its own trace_ids.h, not this one. That defines the event ids (TR_ names, 0..63), the
+ * timestamp TRACE_CLOCK() of its 16 bit timer and TRACE_PRESCALE, its clock divider, then includes this.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#ifdef TRACE
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#ifndef TRACE_SIZE
+#define TRACE_SIZE		32			// records, a power of 2, 4 bytes each
+#endif
+
+// Kind in the top 2 bits of the id
+#define TRACE_BEGIN_ID	0x00		// start of a span, an ISR or some main loop work
+#define TRACE_END_ID	0x40
+#define TRACE_MARK_ID	0x80		// a single event with a byte of data
+#define TRACE_LOST		0xFE		// arg: records dropped for a full ring, at most 255, no time, they follow the
+									// record before it
+#define TRACE_SYNC		0xFF		// arg: F_CPU in Mhz, time: TRACE_PRESCALE
+
+typedef struct
+{
+	uint8_t id;
+	uint8_t arg;
+	uint16_t time;					// TRACE_CLOCK(), little endian as on the AVR
+} trace_rec_t;
+
+extern trace_rec_t Trace_ring[TRACE_SIZE];
+extern volatile uint8_t Trace_head;	// written by Trace_Put() only
+extern volatile uint8_t Trace_tail;	// written by the drain only
+extern volatile uint8_t Trace_lost;
+
+void Trace_Init(uint8_t mhz, uint16_t prescale);
+bool Trace_Byte(uint8_t *c);
+bool Trace_Busy(void);
+
+#ifdef TRACE_PRESCALE				// not for trace.c, it doesn't know the firmware's clock
+
+#ifdef SIM_AVR_IO_H_
+// HostSim: the simulator's clock in steps of 8 cycles, finer than most boards' timers, and where an ISR ends once its
+// modelled cycles have passed
+uint16_t sim_trace_clock(uint16_t prescale, bool end);
+#define TRACE_UNIT		8
+#define TRACE_TIME(end)	sim_trace_clock(TRACE_UNIT, end)
+#else
+#define TRACE_UNIT		TRACE_PRESCALE
+#define TRACE_TIME(end)	TRACE_CLOCK()
+#endif
+
+// From ISRs and the main loop alike. A full ring drops the record and counts it, and so does the ring until the
+// count went out behind the records that were in it, the records lost are one gap in the stream
+static inline void
+Trace_Put(uint8_t id, uint8_t arg, bool end)
+{
+	uint8_t sreg = SREG;
+	uint8_t head;
+	trace_rec_t *r;
+
+	cli();
+	head = Trace_head;
+	if (Trace_lost || (uint8_t)(head - Trace_tail) >= TRACE_SIZE)
+	{
+		if (Trace_lost != 0xff)
+			Trace_lost++;
+	}
+	else
+	{
+		r = &Trace_ring[head & (TRACE_SIZE-1)];
+		r->id = id;
+		r->arg = arg;
+		r->time = TRACE_TIME(end);
+		Trace_head = head + 1;
+	}
+	SREG = sreg;
+}
+
+#define TRACE_INIT()		Trace_Init(F_CPU / 1000000UL, TRACE_UNIT)
+#define TRACE_BEGIN(id)		Trace_Put(TRACE_BEGIN_ID | (id), 0, false)
+#define TRACE_END(id)		Trace_Put(TRACE_END_ID | (id), 0, true)
+#define TRACE_MARK(id, v)	Trace_Put(TRACE_MARK_ID | (id), (v), false)
+
+#endif // TRACE_PRESCALE
+
+#else
+
+#define TRACE_INIT()
+#define TRACE_BEGIN(id)
+#define TRACE_END(id)
+#define TRACE_MARK(id, v)
+
+#endif // TRACE
+
+#endif /* TRACE_H_ */
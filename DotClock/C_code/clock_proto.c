@@ -0,0 +1,138 @@
+/*
+ * clock_proto.c
+ *
+ * Created: 10/19/2026
+ *
+ * Binary packets between the clock and a host over the USB serial port.
+ * A frame is PROTO_SYNC, type, payload length, payload, CRC-8 (polynomial 0x07) over type, length and payload.
+ * The receiver hunts for PROTO_SYNC, so a frame that got cut or corrupted costs only itself. Multi byte fields are
+ * little endian. Plain C without any AVR headers, the host tools build the same file.
+ */
+#include "clock_proto.h"
+
+#define RX_SYNC		0
+#define RX_TYPE		1
+#define RX_LEN		2
+#define RX_PAYLOAD	3
+#define RX_CRC		4
+
+
+static uint8_t
+crc8(uint8_t crc, uint8_t c)
+{
+	uint8_t i;
+
+	crc ^= c;
+	for (i = 0; i < 8; i++)
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	return crc;
+}
+
+
+// Feeds one received byte, returns the type of a complete and good packet, 0 otherwise
+uint8_t
+Proto_Rx(proto_rx_t *rx, uint8_t c)
+{
+	switch (rx->state)
+	{
+		case RX_SYNC:
+			if (c == PROTO_SYNC)
+				rx->state = RX_TYPE;
+			break;
+
+		case RX_TYPE:
+			rx->type = c;
+			rx->crc = crc8(0, c);
+			rx->state = RX_LEN;
+			break;
+
+		case RX_LEN:
+			if (c > PROTO_MAX)
+			{
+				rx->state = (c == PROTO_SYNC) ? RX_TYPE : RX_SYNC;
+				break;
+			}
+			rx->len = c;
+			rx->n = 0;
+			rx->crc = crc8(rx->crc, c);
+			rx->state = c ? RX_PAYLOAD : RX_CRC;
+			break;
+
+		case RX_PAYLOAD:
+			rx->payload[rx->n++] = c;
+			rx->crc = crc8(rx->crc, c);
+			if (rx->n == rx->len)
+				rx->state = RX_CRC;
+			break;
+
+		case RX_CRC:
+			rx->state = RX_SYNC;
+			if (c == rx->crc)
+				return rx->type;
+			break;
+	}
+	return 0;
+}
+
+
+// Builds a frame, returns its length. frame needs room for PROTO_FRAME_MAX bytes
+uint8_t
+Proto_Frame(uint8_t *frame, uint8_t type, const uint8_t *payload, uint8_t len)
+{
+	uint8_t i, crc;
+
+	frame[0] = PROTO_SYNC;
+	frame[1] = type;
+	frame[2] = len;
+	crc = crc8(crc8(0, type), len);
+	for (i = 0; i < len; i++)
+	{
+		frame[3 + i] = payload[i];
+		crc = crc8(crc, payload[i]);
+	}
+	frame[3 + len] = crc;
+	return len + 4;
+}
+
+
+void
+Proto_PutTelemetry(uint8_t *p, const proto_telemetry_t *t)
+{
+	p[0] = t->uptime;
+	p[1] = t->uptime >> 8;
+	p[2] = t->uptime >> 16;
+	p[3] = t->uptime >> 24;
+	p[4] = t->hours;
+	p[5] = t->minutes;
+	p[6] = t->seconds;
+	p[7] = t->mode;
+	p[8] = t->drift;
+	p[9] = (uint16_t)t->drift >> 8;
+	p[10] = t->isr_load;
+	p[11] = t->isr_load >> 8;
+	p[12] = t->loop_passes;
+	p[13] = t->loop_passes >> 8;
+	p[14] = t->loop_passes >> 16;
+	p[15] = t->loop_passes >> 24;
+	p[16] = t->dim_level;
+	p[17] = t->bright_level;
+	p[18] = t->stack_free;
+	p[19] = t->stack_free >> 8;
+}
+
+
+void
+Proto_GetTelemetry(proto_telemetry_t *t, const uint8_t *p)
+{
+	t->uptime = p[0] | (uint16_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+	t->hours = p[4];
+	t->minutes = p[5];
+	t->seconds = p[6];
+	t->mode = p[7];
+	t->drift = (int16_t)(p[8] | p[9] << 8);
+	t->isr_load = p[10] | p[11] << 8;
+	t->loop_passes = p[12] | (uint16_t)p[13] << 8 | (uint32_t)p[14] << 16 | (uint32_t)p[15] << 24;
+	t->dim_level = p[16];
+	t->bright_level = p[17];
+	t->stack_free = p[18] | p[19] << 8;
+}
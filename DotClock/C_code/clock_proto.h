@@ -0,0 +1,59 @@
+/*
+ * clock_proto.h
+ *
+ * Created: 10/19/2026
+ *
+ * Binary packets between the clock and a host over the USB serial port. See clock_proto.c
+ */
+
+#ifndef CLOCK_PROTO_H_
+#define CLOCK_PROTO_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define PROTO_SYNC			0xD5
+#define PROTO_MAX			20		// payload bytes
+#define PROTO_FRAME_MAX		(PROTO_MAX + 4)
+
+// packet types, host -> clock
+#define PROTO_SET_TIME		'T'		// hours 0..23, minutes, seconds. Starts the second from here, answered with 'S'
+#define PROTO_GET			'G'		// no payload, answered with 'S'
+#define PROTO_STREAM		'R'		// 1 byte: send 'S' every n seconds, 0 == stop
+
+// packet types, clock -> host
+#define PROTO_TELEMETRY		'S'		// see proto_telemetry_t
+#define PROTO_TELEMETRY_LEN	20
+#define PROTO_TELEMETRY_OLD	18		// before stack_free, the host fills in 0
+
+typedef struct proto_telemetry
+{
+	uint32_t uptime;			// seconds since power up
+	uint8_t hours;				// 0..23
+	uint8_t minutes;
+	uint8_t seconds;
+	uint8_t mode;				// 0 == running, see main.c
+	int16_t drift;				// crystal trim in 0.1ppm
+	uint16_t isr_load;			// in 0.1%, the share of the CPU the main loop lost in the last second
+	uint32_t loop_passes;		// main loop passes in the last second
+	uint8_t dim_level;			// OCR0B
+	uint8_t bright_level;		// OCR0A
+	uint16_t stack_free;		// bytes of RAM the stack never reached since the reset, see stack_check.c
+} proto_telemetry_t;
+
+typedef struct proto_rx
+{
+	uint8_t state;
+	uint8_t type;
+	uint8_t len;
+	uint8_t n;
+	uint8_t crc;
+	uint8_t payload[PROTO_MAX];
+} proto_rx_t;
+
+uint8_t Proto_Rx(proto_rx_t *rx, uint8_t c);
+uint8_t Proto_Frame(uint8_t *frame, uint8_t type, const uint8_t *payload, uint8_t len);
+void Proto_PutTelemetry(uint8_t *payload, const proto_telemetry_t *t);
+void Proto_GetTelemetry(proto_telemetry_t *t, const uint8_t *payload);
+
+#endif /* CLOCK_PROTO_H_ */
@@ -0,0 +1,39 @@
+/*
+ * config.h
+ *
+ * Created: 10/19/2026
+ *
+ * Build options of the binary clock. Uncomment here or define them in the project's compiler symbols.
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+// Seconds LED and LED1 driven by the Timer1 output compare pins instead of the PWM interrupts, the 1 Hz is then
+// derived from the Timer0 overflow. Needs the board rewired, see main.c
+//#define HW_PWM_LEDS
+
+// LEDs in a row scanned matrix, hours, minutes and seconds in BCD on 10 pins, see ledmux.c. Needs a matrix board.
+// MUX_24H shows 0..23 hours instead of 1..12 and PM
+//#define MUX_LEDS
+//#define MUX_24H
+
+// USB serial port for setting the time from a host and reading telemetry, see usb_cdc.c and clock_proto.c
+//#define USB_CDC
+
+// Event trace of the ISRs and the main loop into a RAM ring, see Common/trace.c and trace_ids.h. Only the host
+// simulator reads it out
+//#define TRACE
+
+#if defined(MUX_LEDS) && defined(HW_PWM_LEDS)
+#error "MUX_LEDS and HW_PWM_LEDS wire the LEDs differently, pick one"
+#endif
+
+// Timer0 clock, 256 of these are a PWM period and the tick of the timer wheel
+#ifdef MUX_LEDS
+#define T0_PRESCALE		64			// 4us, a row of the matrix every 1.024ms
+#else
+#define T0_PRESCALE		256			// 16us
+#endif
+
+#endif /* CONFIG_H_ */
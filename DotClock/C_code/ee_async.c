@@ -0,0 +1,121 @@
+/*
+ * ee_async.c
+ *
+ * Created: 10/19/2026
+ *
+ * Interrupt driven EEPROM writer.
+ * A RAM image (the clock settings struct) is mirrored to EEPROM starting at address 0. Callers change the image and
+ * mark the changed bytes with EE_Async_Write(), which returns immediately. The EE_READY interrupt then handles one
+ * marked byte per interrupt: it reads the byte back from the EEPROM and only programs it when it differs from the image.
+ *
+ * Bytes are marked in a dirty bitmap, so marking a byte that is already queued merges with the pending write and the
+ * value is taken from the image at the time it gets programmed, i.e. only the latest value ever reaches the EEPROM.
+ * A byte that is changed again while it is being programmed is simply marked again and re-checked on a later pass.
+ *
+ * Note: Once EE_Async_Init() has run, all EEPROM writes must go through this module, as the ISR owns EEAR/EEDR.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include "ee_async.h"
+#include "trace_ids.h"
+
+volatile bool EE_Async_Done = true;
+
+static uint8_t *ee_image;
+static uint8_t ee_size;
+static volatile uint8_t ee_dirty[EE_ASYNC_MAX/8];	// one bit per image byte waiting to be checked/programmed
+static volatile uint8_t ee_pending;					// number of bits set in ee_dirty
+static uint8_t ee_cursor;							// where the ISR continues its scan, keeps the order of the writes
+
+
+// Load the image from EEPROM, this is the only blocking access and is done once at power up
+void
+EE_Async_Init(void *image, uint8_t size)
+{
+	if (size > EE_ASYNC_MAX)
+		size = EE_ASYNC_MAX;
+
+	ee_image = image;
+	ee_size = size;
+	eeprom_read_block(image, 0, size);
+}
+
+
+// Queue the bytes ram[0..len-1] of the image for writing. Returns immediately, EE_Async_Done turns true once
+// the EEPROM holds the image.
+void
+EE_Async_Write(const void *ram, uint8_t len)
+{
+	uint8_t addr = (const uint8_t *)ram - ee_image;
+	uint8_t mask;
+
+	if (addr >= ee_size)
+		return;
+	if (len > ee_size - addr)
+		len = ee_size - addr;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (; len; len--, addr++)
+		{
+			mask = _BV(addr & 7);
+			if ((ee_dirty[addr >> 3] & mask) == 0)
+			{
+				ee_dirty[addr >> 3] |= mask;
+				ee_pending++;
+			}
+		}
+		EE_Async_Done = false;
+		EECR |= _BV(EERIE);		// fires as soon as the EEPROM is not busy
+	}
+}
+
+
+// One dirty byte per interrupt, the interrupt keeps firing while EEPE is clear and EERIE is set
+ISR(EE_READY_vect, ISR_BLOCK)
+{
+	uint8_t addr = ee_cursor;
+	uint8_t mask;
+
+	TRACE_BEGIN(TR_EE_READY);
+	if (ee_pending == 0)
+	{
+		EECR &= ~_BV(EERIE);	// the last write has completed
+		EE_Async_Done = true;
+		TRACE_END(TR_EE_READY);
+		return;
+	}
+
+	for (;;)	// find the next dirty byte, skipping over clean groups of 8 bytes at a time
+	{
+		if (addr >= ee_size)
+			addr = 0;
+
+		if (ee_dirty[addr >> 3] == 0)
+		{
+			addr = (addr | 7) + 1;
+			continue;
+		}
+
+		mask = _BV(addr & 7);
+		if (ee_dirty[addr >> 3] & mask)
+			break;
+		addr++;
+	}
+
+	ee_dirty[addr >> 3] &= ~mask;
+	ee_pending--;
+	ee_cursor = addr + 1;
+
+	EEAR = addr;
+	EECR |= _BV(EERE);
+	if (EEDR != ee_image[addr])		// save an erase/write cycle if the byte is unchanged
+	{
+		EEDR = ee_image[addr];
+		EECR |= _BV(EEMPE);			// EEPE must follow within 4 cycles
+		EECR |= _BV(EEPE);
+	}
+	TRACE_END(TR_EE_READY);
+}
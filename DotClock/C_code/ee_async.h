@@ -0,0 +1,22 @@
+/*
+ * ee_async.h
+ *
+ * Created: 10/19/2026
+ *
+ * Interrupt driven EEPROM writer for the clock settings. See ee_async.c
+ */
+
+#ifndef EE_ASYNC_H_
+#define EE_ASYNC_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define EE_ASYNC_MAX	64		// largest RAM image that can be mirrored, must be a multiple of 8
+
+extern volatile bool EE_Async_Done;		// true once every queued byte has been programmed
+
+void EE_Async_Init(void *image, uint8_t size);
+void EE_Async_Write(const void *ram, uint8_t len);
+
+#endif /* EE_ASYNC_H_ */
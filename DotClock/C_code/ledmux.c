@@ -0,0 +1,105 @@
+/*
+ * ledmux.c
+ *
+ * Created: 10/19/2026
+ *
+ * MUX_LEDS (config.h): the LEDs sit in a matrix of 6 rows and 4 columns, a BCD digit per row, tens and ones of the
+ * hours, the minutes and the seconds, 24 LEDs on 10 pins. The columns are PD0..3 with a resistor each, the rows PB0..5
+ * sink the LEDs of one row at a time:
+ *	row 0	PB0		tens of hours, column 3 is PM on the 12 hour display
+ *	row 1	PB1		ones of hours
+ *	row 2	PB2		tens of minutes
+ *	row 3	PB3		ones of minutes
+ *	row 4	PB4		tens of seconds
+ *	row 5	PB5		ones of seconds
+ * LED1 stays on PD6, PC2..7 are free, PC7 is only the calibration input.
+ *
+ * Timer0 runs from F_CPU/64, every overflow (1.024ms) is a scan step that shows the next row, the whole matrix every
+ * 6.1ms or 163Hz. Within the step the dim and bright levels work as before: the overflow turns all columns off, the
+ * COMPA interrupt turns the bright LEDs of the row on, COMPB all of them. A row gets a 6th of the time, so the LEDs
+ * are a 6th as bright as on direct drive for the same current.
+ *
+ * Mux_Show() works out for every row the PORTB image that selects it, the PORTD bits for the two compare matches and
+ * its own OCR0A and OCR0B, into the frame the interrupts aren't showing, they take it at the next first row. The
+ * interrupts only copy bytes out, no branches on the content, so a scan step takes the same time whatever is lit.
+ *
+ * The row pin carries the current of every LED lit in the row and its output drops with it, about 25 Ohm: with 470
+ * Ohm column resistors and red LEDs 4 lit LEDs get some 13% less current each than a single one. The on-time of a
+ * row is stretched by MUX_DROOP_PCT for every LED lit beyond the first, separately for the bright window (the bright
+ * LEDs) and the dim window (all LEDs of the row), so a digit looks the same whatever its neighbours show.
+ */
+#include "ledmux.h"
+
+#ifdef MUX_LEDS
+
+// The LEDs there are in each row
+static const uint8_t populated[MUX_ROWS] =
+{
+#ifdef MUX_24H
+	0x03,					// 0..2
+#else
+	0x01 | MUX_PM,			// 0..1
+#endif
+	0x0f, 0x07, 0x0f, 0x07, 0x0f
+};
+
+static const uint8_t lit[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };	// LEDs in 4 columns
+
+// On-time added for the LEDs lit in a row, in 1/256, a table so no division runs in the interrupt that calls this
+#define STRETCH(n)		((n) * MUX_DROOP_PCT * 256 / 100)
+static const uint8_t stretch[5] = { 0, 0, STRETCH(1), STRETCH(2), STRETCH(3) };
+
+mux_row_t mux_frame[2][MUX_ROWS];
+const mux_row_t *mux_row = mux_frame[0];		// being shown, for the compare interrupts
+const mux_row_t *mux_next = mux_frame[0];		// shown from the next overflow
+volatile uint8_t mux_shown;						// frame the interrupts go through
+volatile bool mux_new;							// the other frame is newer, take it at the next first row
+
+
+void
+Mux_Init(void)
+{
+	PORTB |= MUX_ROW_PINS;		// all rows off
+	DDRB |= MUX_ROW_PINS;
+	PORTD &= ~MUX_COLS;
+	DDRD |= MUX_COLS;
+}
+
+
+// Compare value of a level for a row with the LEDs of cols on at once, the on-time stretched for the drop of the row
+// pin
+static uint8_t
+Mux_Ocr(uint8_t level, uint8_t cols)
+{
+	uint16_t on = 256 - level;
+
+	on += (on * stretch[lit[cols & MUX_COLS]]) >> 8;
+	if (on > 256 - MUX_OCR_MIN)
+		on = 256 - MUX_OCR_MIN;
+	return 256 - on;
+}
+
+
+// New contents: digits[] are the bright LEDs of each row, bit 0 == column 0, led1 the PORTD bits outside the matrix
+// that are lit bright in every row. The levels are OCR0A and OCR0B as on direct drive
+void
+Mux_Show(const uint8_t digits[MUX_ROWS], uint8_t led1, uint8_t bright_level, uint8_t dim_level)
+{
+	mux_row_t *r;
+	uint8_t i, bright;
+
+	mux_new = false;				// the interrupt stays on the frame it has while this one is written
+	r = mux_frame[mux_shown ^ 1];
+	for (i = 0; i < MUX_ROWS; i++, r++)
+	{
+		bright = digits[i] & populated[i];
+		r->select = MUX_ROW_PINS & ~_BV(i);
+		r->ocr_bright = Mux_Ocr(bright_level, bright);
+		r->ocr_dim = Mux_Ocr(dim_level, populated[i]);
+		r->bright = bright | led1;
+		r->all = populated[i] | led1;
+	}
+	mux_new = true;
+}
+
+#endif // MUX_LEDS
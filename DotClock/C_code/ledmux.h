@@ -0,0 +1,85 @@
+/*
+ * ledmux.h
+ *
+ * Created: 10/19/2026
+ *
+ * Row scanned LED matrix of the MUX_LEDS build of the binary clock. See ledmux.c
+ */
+
+#ifndef LEDMUX_H_
+#define LEDMUX_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include "config.h"
+
+#ifdef MUX_LEDS
+
+#define MUX_ROWS		6			// tens and ones of hours, minutes and seconds, top to bottom
+#define MUX_COLS		0x0f		// PD0..3, the anodes through the column resistors, bit 0 == 1
+#define MUX_ROW_PINS	0x3f		// PB0..5, the cathodes of row 0..5, low == row on
+#define MUX_PM			0x08		// column 3 of the tens of hours, the 12 hour display
+#define MUX_DROOP_PCT	4			// on-time added per LED lit beyond the first in a row, see ledmux.c
+#define MUX_OCR_MIN		2			// the overflow interrupt sets OCR0x before Timer0 gets there
+
+// One step of the scan, worked out by Mux_Show() so the interrupts only copy it out
+typedef struct mux_row
+{
+	uint8_t select;				// PORTB, this row's cathode low
+	uint8_t ocr_bright;			// OCR0A, the bright LEDs go on
+	uint8_t ocr_dim;			// OCR0B, all LEDs of the row go on
+	uint8_t bright;				// PORTD bits of the bright LEDs, LED1 included
+	uint8_t all;				// PORTD bits of every LED of the row
+} mux_row_t;
+
+extern mux_row_t mux_frame[2][MUX_ROWS];
+extern const mux_row_t *mux_row, *mux_next;
+extern volatile uint8_t mux_shown;
+extern volatile bool mux_new;
+
+void Mux_Init(void);
+void Mux_Show(const uint8_t digits[MUX_ROWS], uint8_t led1, uint8_t bright_level, uint8_t dim_level);
+
+// Next row, from the Timer0 overflow before anything else: the columns off first, PORTD keeps the idle bits (the
+// button pull-ups), then the row and its compare values. The new frame is taken at the first row. Inline so the
+// interrupt needs no call, loads and stores only, the same time for every row
+static inline void
+Mux_Step(uint8_t idle_d)
+{
+	const mux_row_t *r = mux_next;
+
+	PORTD = idle_d;
+	PORTB = r->select;
+	OCR0A = r->ocr_bright;
+	OCR0B = r->ocr_dim;
+	mux_row = r++;
+	if (r == &mux_frame[mux_shown][MUX_ROWS])
+	{
+		if (mux_new)
+		{
+			mux_shown ^= 1;
+			mux_new = false;
+		}
+		r = mux_frame[mux_shown];
+	}
+	mux_next = r;
+}
+
+// TIMER0_COMPA_vect
+static inline void
+Mux_Bright(void)
+{
+	PORTD |= mux_row->bright;
+}
+
+// TIMER0_COMPB_vect
+static inline void
+Mux_Dim(void)
+{
+	PORTD |= mux_row->all;
+}
+
+#endif // MUX_LEDS
+
+#endif /* LEDMUX_H_ */
@@ -1,311 +1,757 @@
-/*
- * Program for Binary Clock using atmega32U2 running on 16Mhz xtal.
- * 
- Provides a simple clock that reads out the current time via a series of 12 LEDs indicating in binary notation 
- Hours, 10s of minutes and 1s of minutes. 
- 
- LEDs are pulse with modulated at a ~16ms interval to either be dimly lit to indicate the "off" state, or brightly lit
- to indicate the "on" state. Using 8 bit Timer1 fed by a 64us clock and running in "normal mode" the timer overflow interrupt 
- produces a ~16ms PWM interval with 256 64us steps. Output comapre A and B are used to time the dim and bright LEDs "ON" times.   
- 
- Hardware timer1 is used to generate a 1 HZ interrupt source which then gets used to count up the minutes and hours for
- a 12hour AM/PM display.
- 
- *
- *
- * Created: 4/12/2013 2:42:13 PM
- * Author: Gary Stofer
- */ 
-
-#define F_CPU        16000000 
-#include <avr/io.h>		// include I/O definitions (port names, pin names, etc)
-#include <avr/wdt.h>
-#include <avr/power.h>
-#include <avr/interrupt.h>	// include interrupt support
-#include <avr/eeprom.h>
-#include <stdbool.h>
-#include <util/delay.h>
-
-#define BUTTON1 (1<<7)			// On Port D
-#define BUTTON2 (1<<4)			// on Port D
-#define BUTTON3 (1<<5)			// on Port D
-
-#define LEDS_LED1        (1 << 6) // on portD
-#define LEDS_HOURS		0x0f	// on PORT D
-#define LEDS_1MINS		0xf0	// on Port B
-#define LEDS_10MINS		0xe0	// on Port C
-#define LEDS_AM_PM		0x10	// on Port C
-#define LEDS_Second		0x04	// on Port C
-
-
-#define LED_BRIGHT  100	// 0 == max brightness 
-#define LED_DIMM	253 // 255 == min brightness, i.e OFF
-
-// global vars
-unsigned char Seconds = 0;
-unsigned char Minutes = 0;
-unsigned char Hours = 0;
-unsigned char am_PM	 =0;
-
-struct ee_data 
-{
-	unsigned char dim_level;
-	unsigned char bright_level;
-
-} EE_data;
-
-
-static  void 
-LEDs_Init(void)
-{
-	DDRD |= LEDS_LED1;	// LED on pcb
-	DDRB |= LEDS_1MINS;		// PB4..7
-	DDRD |= LEDS_HOURS;		// PD0..3
-	DDRC |= LEDS_10MINS;	// PC5..7
-	DDRC |= LEDS_AM_PM;		// PC2
-	DDRC |= LEDS_Second;	// PC4
-}
-
-
-static  void 
-TurnOffAllLEDs()
-{
-	PORTD = (BUTTON1 | BUTTON2 | BUTTON3); // maintain the pull-ups for switches
-	PORTB =0;
-	PORTC =0;
-	
-}
-
-static  void 
-Buttons_Init(void)
-{
-	DDRD  &= ~ (BUTTON1 | BUTTON2 | BUTTON3);
-	PORTD = (BUTTON1 | BUTTON2 | BUTTON3); // for pull ups
-}
-
-static bool 
-IsButtonPressed( unsigned char bt )
-{
-	return ((PIND & bt) == 0);
-}
-
-//Function to ripple the change in seconds through minutes and hours
-static void
-ripple( void)
-{
-	if( Seconds >= 60)
-	{
-		Seconds = 0;
-		Minutes++;
-	}	  
-	
-	if (Minutes >=60)
-	{
-		Minutes = 0;
-		Hours++;
-	}
-	
-	if (Hours >=12)
-	{
-		Hours = 0;
-		am_PM++;
-	}
-	
-	if (am_PM >1)
-	{
-		am_PM = 0;
-	}		
-	
-}
-static unsigned mode = 1;		// the operational mode of the clock , 0=running,1=clock-setting,2=dim-setting, 3=bright setting
-  
-unsigned volatile char tmp;
-int main(void)
-{
-
-	unsigned char tmp;
-	
-	wdt_disable();		/* Disable watchdog if enabled by bootloader/fuses */
-	power_usb_disable() ;
-	power_usart1_disable();
-	power_spi_disable();
-	
-	Buttons_Init();
-	LEDs_Init();
-	clock_prescale_set(clock_div_1);	// run at x-tal frequency 16Mhz
-	
-	
-	eeprom_read_block( &EE_data,0,sizeof(EE_data));
-		
-	if (EE_data.bright_level == 0xff && EE_data.dim_level == 0xff)
-	{
-		EE_data.bright_level = LED_BRIGHT;
-		EE_data.dim_level = LED_DIMM;
-		eeprom_write_block(&EE_data,0,sizeof(EE_data));
-		eeprom_busy_wait();
-	}
-	
-	OCR0A = EE_data.bright_level;
-	OCR0B = EE_data.dim_level;
-
-	// Timer 0 setup for simple count mode, used as timebase LED PWM
-	TCCR0A = 0;		// simple count more 		
-	TCCR0B = 4;		// system Clock 16Mhz/256 = 16us per counter tick 
-	//TCCR0B = 3;		// system Clock 16Mhz/64 = 4us per counter tick 
-	//TCCR0B = 5;		// system Clock 16Mhz/1024 = 64us per counter tick 
-	//TCCR0B = 2;		// system Clock 1Mhz/8 = 8us per counter tick 
-	TIMSK0 = 0x7;	// Enable OverFLow , OCR0A and OCR0B interrupt enables
-	
-	MCUSR =0; //MCU status register clear 
-	
-	// Timer 1 setup for  fast PWM mode for servo pulse generation 1 to 2ms 
-
-	TIMSK1 = 0x2;		// Enable OCR1A interrupt 
-	TCCR1A = 0x00;		// No pin toggles on compare -- CTC (normal) mode
-	TCCR1B = 0x0D;		// CTC mode, F_CPU 16mhz/1024 clock ( 64us)
-	//TCCR1B = 0x0B;		// CTC mode, F_CPU 1Mhz/64 clock ( 64us)
-	OCR1A = 15625-1;	// counting 15625 counts of 64 us == 1 second
-
-	sei();
-		
-    while(1)	// for ever
-    {
-		
-		if (IsButtonPressed(BUTTON1) )
-		{
-
-			// de-bounce -- 10 consecutive reads of switch open 
-			for (tmp =0; tmp<=10; tmp++)
-			{
-				_delay_ms(2);
-				if (IsButtonPressed(BUTTON1))
-					tmp = 0;
-			}
-			
-			if ( mode < 3)
-				mode++;
-			else
-			{
-				eeprom_write_block(&EE_data,0,sizeof(EE_data));
-				eeprom_busy_wait();
-				mode = 0; // enter running mode
-			}				
-		
-		}			
-				
-		if (IsButtonPressed(BUTTON2) ) // increases Minutes and decrease brightness 
-		{
-
-			// de-bounce -- 10 consecutive reads of switch open
-			for (tmp =0; tmp<=10; tmp++)
-			{
-				_delay_ms(2);
-				if (IsButtonPressed(BUTTON2))
-				tmp = 0;
-			}
-			
-			switch (mode) 
-			{
-				case 1:
-					Minutes++;
-					ripple();
-					break;
-					
-				case 2:
-					if (OCR0B < 0xff )		// dim level
-					{
-						OCR0B++;
-						EE_data.dim_level = OCR0B;
-					}						
-					break;
-					
-				case 3:						// bright level
-					if (OCR0A < OCR0B-10  )		// make sure that bright is at least 10 counts brighter than dim
-					{
-						OCR0A +=10;				// step in increments of 10
-						EE_data.bright_level =OCR0A;
-					}						
-					break;
-			}			
-			
-		}	
-		
-		if (IsButtonPressed(BUTTON3) )	// Increases Hours and increase brightness
-		{
-
-			// de-bounce -- 10 consecutive reads of switch open
-			for (tmp =0; tmp<=10; tmp++)
-			{
-				_delay_ms(2);
-				if (IsButtonPressed(BUTTON3))
-				tmp = 0;
-			}
-						
-			switch (mode)
-			{
-				case 1:
-					Hours++;
-					ripple();
-					break;
-					
-				case 2:
-					if (OCR0B > OCR0A+10)		// dim level
-					{	
-
-						OCR0B--;
-						EE_data.dim_level = OCR0B;
-					}						
-					break;
-					
-				case 3:						// bright level
-					if (OCR0A > 20)	
-					{
-						OCR0A -=10;		//step in increments of 10
-						EE_data.bright_level =OCR0A;
-					}						
-					break;
-			}
-		}
-				
-    } // end of for-ever
-}
-
-
-ISR(TIMER0_COMPA_vect,ISR_BLOCK)	// Turn on LEDS that should be bright
-{
-	PORTD |= Hours & LEDS_HOURS;
-	PORTB |= ((Minutes %10)<<4) & LEDS_1MINS;	// 1'S OF MINUTES
-	PORTC |= ((Minutes/10)<<5) & LEDS_10MINS ;	// 10's of minutes
-	PORTC |= (am_PM << 4) & LEDS_AM_PM ;	//AM-PM indication
-	PORTC |= ((Seconds%2) << 2) & LEDS_Second;
-	PORTD |= ((Seconds%2) << 6) & LEDS_LED1;	// Green led on PCB
-}
-
-
-ISR(TIMER0_COMPB_vect,ISR_BLOCK)	// Turn on LEDS that should be dim, thats all LEDS 
-{
-	PORTD |= LEDS_HOURS;
-	PORTB |= LEDS_1MINS;	
-	PORTC |= LEDS_10MINS;	
-	PORTC |= LEDS_AM_PM;	
-	PORTC |= LEDS_Second;
-}
-
-
-ISR(TIMER0_OVF_vect, ISR_BLOCK)
-{
-	TurnOffAllLEDs();
-}	
-
-
-
-ISR(TIMER1_COMPA_vect, ISR_BLOCK)
-{
-	if (mode)		// clock is in settings mode, don't increment time
-	{
-		Seconds = 0;
-		return;
-	}	
-	Seconds++;
-	ripple();
+/*
+ * Program for Binary Clock using atmega32U2 running on 16Mhz xtal.
+ * 
+ Provides a simple clock that reads out the current time via a series of 12 LEDs indicating in binary notation 
+ Hours, 10s of minutes and 1s of minutes. 
+ 
+ LEDs are pulse with modulated at a ~16ms interval to either be dimly lit to indicate the "off" state, or brightly lit
+ to indicate the "on" state. Using 8 bit Timer1 fed by a 64us clock and running in "normal mode" the timer overflow interrupt 
+ produces a ~16ms PWM interval with 256 64us steps. Output comapre A and B are used to time the dim and bright LEDs "ON" times.   
+ 
+ Hardware timer1 is used to generate a 1 HZ interrupt source which then gets used to count up the minutes and hours for
+ a 12hour AM/PM display. The 1 Hz is trimmed for the crystal error stored in EEPROM, see timebase.c.
+ 
+ Holding button 1 down at power up enters the crystal calibration mode: a 1 pulse per second reference is connected 
+ to PC7 (ICP1, the MSB of the 10s of minutes LEDs), the seconds LED toggles for every good reference pulse and after
+ TB_CAL_SECONDS pulses the measured drift is stored and the clock enters the clock-setting mode. Button 1 aborts.
+ 
+ USB_CDC (config.h): the clock shows up as a USB serial port. A host can set the time, the new second starts when the
+ packet arrives, and read telemetry: time, uptime, drift, levels, the main loop passes per second, which gives
+ the share of the CPU taken by the interrupts, and the RAM the stack never reached (Common/stack_check.c). See
+ clock_proto.h for the packets and Tools/clocksync for the host side.
+ 
+ HW_PWM_LEDS (config.h): the seconds LED and LED1, the two LEDs that change every second, are driven by the Timer1 
+ output compare pins. Timer1 runs as an 8 bit PWM from the same 16us clock as Timer0 and in step with it, so their
+ on-time is exact and costs no interrupts, the PWM interrupts only handle the LEDs that are left. The 1 Hz moves to
+ the Timer0 overflow, see timebase.c. The board needs rewiring for it:
+	seconds LED		PC2 -> PC5 (OC1B)
+	LED1			PD6 -> PC6 (OC1A), wire the pcb LED over to PC6, PD6 is left an input
+	10s of minutes	PC5..7 -> PB0..2, PC7 (ICP1) is then only the calibration input
+ 
+ MUX_LEDS (config.h): hours, minutes and seconds in BCD on a matrix of 6 rows and 4 columns, PD0..3 and PB0..5, scanned
+ a row per Timer0 period with Timer0 at 4us per tick, see ledmux.c. The dim and bright levels work the same way, the
+ 12 hour display has PM next to the tens of hours, MUX_24H shows 0..23 instead.
+ 
+ The levels follow a schedule of the time of day from the EEPROM, the default dims the LEDs from 21:00 to 23:00 and
+ brings them back from 6:00 to 7:00, see schedule.c. The setting modes show the levels of the menu.
+ 
+ *
+ *
+ * Created: 4/12/2013 2:42:13 PM
+ * Author: Gary Stofer
+ */ 
+
+#define F_CPU        16000000 
+#include <avr/io.h>		// include I/O definitions (port names, pin names, etc)
+#include <avr/wdt.h>
+#include <avr/power.h>
+#include <avr/interrupt.h>	// include interrupt support
+#include <avr/sleep.h>
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include <string.h>
+#include <util/atomic.h>
+#include "config.h"
+#include "ee_async.h"
+#include "timebase.h"
+#include "ledmux.h"
+#include "schedule.h"
+#include "../../Common/timer_wheel.h"
+#include "../../Common/stack_check.h"
+#include "trace_ids.h"
+#ifdef USB_CDC
+#include "usb_cdc.h"
+#include "clock_proto.h"
+#endif
+
+#define BUTTON1 (1<<7)			// On Port D
+#define BUTTON2 (1<<4)			// on Port D
+#define BUTTON3 (1<<5)			// on Port D
+
+#define LEDS_HOURS		0x0f	// on PORT D
+#define LEDS_1MINS		0xf0	// on Port B
+#define LEDS_AM_PM		0x10	// on Port C
+#ifdef HW_PWM_LEDS
+#define LEDS_LED1		(1 << 6) // on Port C, OC1A
+#define LEDS_10MINS		0x07	// on Port B
+#define LEDS_Second		(1 << 5) // on Port C, OC1B
+#else
+#define LEDS_LED1        (1 << 6) // on portD
+#define LEDS_10MINS		0xe0	// on Port C
+#define LEDS_Second		0x04	// on Port C
+#endif
+#define CAL_REF_PIN		0x80	// PC7 == ICP1, input during calibration
+
+
+#define LED_BRIGHT  100	// 0 == max brightness 
+#define LED_DIMM	253 // 255 == min brightness, i.e OFF
+
+// global vars
+unsigned char Seconds = 0;
+unsigned char Minutes = 0;
+unsigned char Hours = 0;
+unsigned char am_PM	 =0;
+
+struct ee_data 
+{
+	unsigned char dim_level;
+	unsigned char bright_level;
+	int16_t drift;				// crystal error in 0.1ppm, see timebase.c
+	sched_point_t sched[SCHED_POINTS];	// levels by the time of day, see schedule.c
+
+} EE_data;
+
+unsigned char bright_shown, dim_shown;	// the levels on the LEDs, see Levels_Update()
+
+
+static  void 
+LEDs_Init(void)
+{
+#ifdef MUX_LEDS
+	Mux_Init();
+	DDRD |= LEDS_LED1;	// LED on pcb
+#else
+	DDRB |= LEDS_1MINS;		// PB4..7
+	DDRD |= LEDS_HOURS;		// PD0..3
+	DDRC |= LEDS_AM_PM;		// PC4
+#ifdef HW_PWM_LEDS
+	DDRB |= LEDS_10MINS;	// PB0..2
+	DDRC |= LEDS_Second | LEDS_LED1;	// the OC1B and OC1A outputs
+#else
+	DDRD |= LEDS_LED1;	// LED on pcb
+	DDRC |= LEDS_10MINS;	// PC5..7
+	DDRC |= LEDS_Second;	// PC2
+#endif
+#endif
+}
+
+
+#ifdef MUX_LEDS
+// The time in BCD, a digit per row of the matrix, LED1 bright on odd seconds. The levels go into the rows of the
+// matrix, each row has its own compare values, see ledmux.c. The main loop calls it every pass, it only works the
+// rows out again when the time or a level changed. Not from the interrupts, Mux_Show() isn't re-entrant
+static void
+LEDs_Update(void)
+{
+	static uint8_t shown[6] = { 0xff };
+	uint8_t now[6];
+	uint8_t digits[MUX_ROWS];
+	uint8_t h;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)	// the time of one second, the timebase interrupt ripples it
+	{
+		now[0] = Seconds;
+		now[1] = Minutes;
+		now[2] = Hours;
+		now[3] = am_PM;
+	}
+	now[4] = bright_shown;
+	now[5] = dim_shown;
+	if (memcmp(now, shown, sizeof(now)) == 0)
+		return;
+	memcpy(shown, now, sizeof(now));
+
+	h = now[2];
+#ifdef MUX_24H
+	if (now[3])
+		h += 12;
+#else
+	if (h == 0)
+		h = 12;
+#endif
+	digits[0] = h / 10;
+#ifndef MUX_24H
+	if (now[3])
+		digits[0] |= MUX_PM;
+#endif
+	digits[1] = h % 10;
+	digits[2] = now[1] / 10;
+	digits[3] = now[1] % 10;
+	digits[4] = now[0] / 10;
+	digits[5] = now[0] % 10;
+	Mux_Show(digits, (now[0] % 2) ? LEDS_LED1 : 0, now[4], now[5]);
+}
+#else
+static volatile unsigned char bright_b, bright_c, bright_d;	// LEDs lit bright, per port
+
+// Works out which LEDs are bright after the time or the levels changed, so the PWM interrupts only copy it out.
+// With HW_PWM_LEDS the seconds LED and LED1 levels go into the Timer1 compare registers, the hardware takes them at
+// the next period. In inverting mode the output goes on at the compare match and off at BOTTOM, the same window as
+// the PWM interrupts, 0xff keeps it off.
+static void
+LEDs_Update(void)
+{
+	unsigned char b, c, d;
+#ifdef HW_PWM_LEDS
+	unsigned char sec, led1;
+#endif
+
+	d = Hours & LEDS_HOURS;
+	b = ((Minutes %10)<<4) & LEDS_1MINS;	// 1'S OF MINUTES
+	c = (am_PM << 4) & LEDS_AM_PM ;			//AM-PM indication
+#ifdef HW_PWM_LEDS
+	b |= (Minutes/10) & LEDS_10MINS ;		// 10's of minutes
+	if (Seconds % 2)
+	{
+		sec = bright_shown;
+		led1 = bright_shown;
+	}
+	else
+	{
+		sec = dim_shown;
+		led1 = 0xff;
+	}
+#else
+	c |= ((Minutes/10)<<5) & LEDS_10MINS ;	// 10's of minutes
+	c |= ((Seconds%2) << 2) & LEDS_Second;
+	d |= ((Seconds%2) << 6) & LEDS_LED1;	// Green led on PCB
+#endif
+
+	OCR0A = bright_shown;		// the levels, the schedule and the buttons change them
+	OCR0B = dim_shown;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		bright_b = b;
+		bright_c = c;
+		bright_d = d;
+#ifdef HW_PWM_LEDS
+		OCR1B = sec;		// shared 16 bit TEMP register, keep it atomic
+		OCR1A = led1;
+#endif
+	}
+}
+
+
+static  void 
+TurnOffAllLEDs()
+{
+	PORTD = (BUTTON1 | BUTTON2 | BUTTON3); // maintain the pull-ups for switches
+	PORTB =0;
+	PORTC =0;
+	
+}
+#endif
+
+static  void 
+Buttons_Init(void)
+{
+	DDRD  &= ~ (BUTTON1 | BUTTON2 | BUTTON3);
+	PORTD = (BUTTON1 | BUTTON2 | BUTTON3); // for pull ups
+}
+
+static bool 
+IsButtonPressed( unsigned char bt )
+{
+	return ((PIND & bt) == 0);
+}
+
+//Function to ripple the change in seconds through minutes and hours
+static void
+ripple( void)
+{
+	if( Seconds >= 60)
+	{
+		Seconds = 0;
+		Minutes++;
+	}	  
+	
+	if (Minutes >=60)
+	{
+		Minutes = 0;
+		Hours++;
+	}
+	
+	if (Hours >=12)
+	{
+		Hours = 0;
+		am_PM++;
+	}
+	
+	if (am_PM >1)
+	{
+		am_PM = 0;
+	}		
+	
+}
+#define BUTTON_SCAN_TICKS	(256 / T0_PRESCALE)	// Timer0 overflows, the tick of the timer wheel, 4.1ms
+#define BUTTON_OPEN_SCANS	6		// 25ms
+
+static uint8_t buttons_down;		// pressed, the release not seen yet
+static uint8_t buttons_ignore;		// held since power up, the release is no press
+static uint8_t buttons_open[3];		// scans a pressed button read open since
+
+static unsigned mode = 1;		// the operational mode of the clock , 0=running,1=clock-setting,2=dim-setting, 3=bright setting
+#define MODE_CALIBRATE 4		// 4=crystal calibration, only entered at power up
+  
+#ifdef USB_CDC
+static volatile bool second_flag;		// set by the timebase interrupt
+static volatile uint32_t uptime;		// seconds since power up
+static uint32_t loop_ref;				// main loop passes per second without interrupts, see Usb_MeasureLoop()
+static uint32_t loop_passes, loop_last;	// passes counted in this and in the last second
+static uint8_t stream_interval, stream_count;
+static proto_rx_t proto_rx;
+
+
+static void
+Usb_SendTelemetry(void)
+{
+	proto_telemetry_t t;
+	uint8_t payload[PROTO_TELEMETRY_LEN];
+	uint8_t frame[PROTO_FRAME_MAX];
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		t.uptime = uptime;
+		t.hours = Hours + (am_PM ? 12 : 0);
+		t.minutes = Minutes;
+		t.seconds = Seconds;
+	}
+	t.mode = mode;
+	t.drift = EE_data.drift;
+	t.loop_passes = loop_last;
+	if (loop_ref == 0 || loop_last >= loop_ref)
+		t.isr_load = 0;
+	else
+		t.isr_load = 1000 - loop_last * 1000 / loop_ref;
+	t.dim_level = dim_shown;
+	t.bright_level = bright_shown;
+	t.stack_free = Stack_Unused();
+
+	Proto_PutTelemetry(payload, &t);
+	CDC_Write(frame, Proto_Frame(frame, PROTO_TELEMETRY, payload, sizeof(payload)));
+}
+
+
+static void
+Usb_SetTime(const uint8_t *p)
+{
+	if (p[0] > 23 || p[1] > 59 || p[2] > 59 || mode == MODE_CALIBRATE)
+		return;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TB_Resync();
+		am_PM = p[0] >= 12;
+		Hours = p[0] % 12;
+		Minutes = p[1];
+		Seconds = p[2];
+		if (mode == 1)		// setting the clock by hand, the host did it
+			mode = 0;
+	}
+	LEDs_Update();
+}
+
+
+// One main loop pass worth of USB, kept short so the buttons stay responsive
+static void
+Usb_Poll(void)
+{
+	uint8_t buf[8], n, i;
+
+	CDC_Task();
+	n = CDC_Read(buf, sizeof(buf));
+	for (i = 0; i < n; i++)
+	{
+		switch (Proto_Rx(&proto_rx, buf[i]))
+		{
+			case PROTO_SET_TIME:
+				if (proto_rx.len == 3)
+				{
+					Usb_SetTime(proto_rx.payload);
+					Usb_SendTelemetry();
+				}
+				break;
+
+			case PROTO_GET:
+				Usb_SendTelemetry();
+				break;
+
+			case PROTO_STREAM:
+				if (proto_rx.len == 1)
+				{
+					stream_interval = proto_rx.payload[0];
+					stream_count = 0;
+				}
+				break;
+		}
+	}
+
+	if (second_flag)
+	{
+		second_flag = false;
+		loop_last = loop_passes;
+		loop_passes = 0;
+		if (stream_interval && ++stream_count >= stream_interval)
+		{
+			stream_count = 0;
+			Usb_SendTelemetry();
+		}
+	}
+}
+
+
+// Counts main loop passes with the interrupts still off, over 16 Timer0 periods (65.536ms, 16.384ms with MUX_LEDS),
+// and scales them to a
+// second. The running clock compares its passes against this to work out the interrupt load. Roughly only: the
+// pass here does no button or calibration work and the USB traffic varies.
+static void
+Usb_MeasureLoop(void)
+{
+	uint32_t passes = 0;
+	uint8_t periods = 0, t, last = 0;
+
+	while (periods <= 16)			// counting starts with the first Timer0 wrap
+	{
+		if (periods)
+			passes++;
+		IsButtonPressed(BUTTON1);
+		IsButtonPressed(BUTTON2);
+		IsButtonPressed(BUTTON3);
+		LEDs_Update();
+		Usb_Poll();
+		t = TCNT0;
+		if (t < last)
+			periods++;
+		last = t;
+	}
+	loop_ref = passes * 15625 / (T0_PRESCALE * 4);	// 1s / 16 periods of 256 Timer0 ticks
+}
+#endif
+
+// The levels for the LEDs: the schedule's for the time of day while the clock runs, the menu's while it is set or
+// without a schedule. Worked out again when the minute, the mode or a menu level changed, the main loop calls it every
+// pass, LEDs_Update() takes them to the compare registers
+static void
+Levels_Update(void)
+{
+	static uint8_t done[5] = { 0xff };
+	uint8_t now[5];
+	uint16_t minute;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now[0] = Minutes;
+		now[1] = Hours;
+		now[2] = am_PM;
+	}
+	now[3] = EE_data.bright_level;
+	now[4] = EE_data.dim_level;
+	if (mode)
+		now[0] = 0xff;			// no minute, the menu levels
+	if (memcmp(now, done, sizeof(now)) == 0)
+		return;
+	memcpy(done, now, sizeof(now));
+
+	minute = ((now[2] ? 12 : 0) + now[1]) * 60 + now[0];
+	if (mode || !Sched_Levels(minute, now[3], now[4], &bright_shown, &dim_shown))
+	{
+		bright_shown = now[3];
+		dim_shown = now[4];
+	}
+}
+
+
+// Button 1 steps through the modes, and ends a calibration
+static void
+Button1_Press(void)
+{
+	if (mode == MODE_CALIBRATE)		// abort the calibration, keep the old drift
+	{
+		TB_StopCalibration();
+		LEDs_Init();			// PC7 back to an output if it drives LEDs
+		mode = 1;
+	}
+	else if ( mode < 3)
+		mode++;
+	else
+	{
+		EE_Async_Write(&EE_data,sizeof(EE_data));	// only the changed bytes get programmed, in the background
+		mode = 0; // enter running mode
+	}				
+}
+
+
+// Button 2 increases Minutes and decreases brightness 
+static void
+Button2_Press(void)
+{
+	switch (mode) 
+	{
+		case 1:
+			Minutes++;
+			ripple();
+			break;
+			
+		case 2:
+			if (EE_data.dim_level < 0xff )		// dim level
+				EE_data.dim_level++;
+			break;
+			
+		case 3:						// bright level
+			if (EE_data.bright_level < EE_data.dim_level-10  )	// make sure that bright is at least 10 counts brighter than dim
+				EE_data.bright_level +=10;				// step in increments of 10
+			break;
+	}			
+}
+
+
+// Button 3 increases Hours and increases brightness
+static void
+Button3_Press(void)
+{
+	switch (mode)
+	{
+		case 1:
+			Hours++;
+			ripple();
+			break;
+			
+		case 2:
+			if (EE_data.dim_level > EE_data.bright_level+10)		// dim level
+				EE_data.dim_level--;
+			break;
+			
+		case 3:						// bright level
+			if (EE_data.bright_level > 20)	
+				EE_data.bright_level -=10;		//step in increments of 10
+			break;
+	}
+}
+
+
+// De-bounce from the timer wheel: a button counts when it was pressed and then read open for BUTTON_OPEN_SCANS
+// scans in a row, the same as the 10 reads 2ms apart it used to wait for, without the wait
+static void
+Buttons_Scan(void)
+{
+	static const uint8_t bt[3] = { BUTTON1, BUTTON2, BUTTON3 };
+	static void (*const press[3])(void) = { Button1_Press, Button2_Press, Button3_Press };
+	uint8_t i;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (IsButtonPressed(bt[i]))
+		{
+			buttons_down |= bt[i];
+			buttons_open[i] = 0;
+		}
+		else if ((buttons_down & bt[i]) && ++buttons_open[i] >= BUTTON_OPEN_SCANS)
+		{
+			buttons_down &= ~bt[i];
+			if (buttons_ignore & bt[i])
+				buttons_ignore &= ~bt[i];
+			else
+			{
+				TRACE_MARK(TR_BUTTON, i + 1);
+				press[i]();
+			}
+		}
+	}
+}
+
+
+int main(void)
+{
+	static tw_timer_t buttons_timer;
+
+	wdt_disable();		/* Disable watchdog if enabled by bootloader/fuses */
+#ifndef USB_CDC
+	power_usb_disable() ;
+#endif
+	power_usart1_disable();
+	power_spi_disable();
+	
+	Buttons_Init();
+	LEDs_Init();
+	clock_prescale_set(clock_div_1);	// run at x-tal frequency 16Mhz
+	
+	
+	EE_Async_Init( &EE_data,sizeof(EE_data));	// EEPROM writes from here on are queued and done by the EE_READY interrupt
+		
+	if (EE_data.bright_level == 0xff && EE_data.dim_level == 0xff)
+	{
+		EE_data.bright_level = LED_BRIGHT;
+		EE_data.dim_level = LED_DIMM;
+		EE_data.drift = 0;
+		EE_Async_Write(&EE_data,sizeof(EE_data));
+	}
+	if (EE_data.drift == -1)		// erased, settings from before the drift was stored
+		EE_data.drift = 0;
+	if (EE_data.sched[0].minute == SCHED_END)	// erased, settings from before the schedule
+	{
+		Sched_Default(EE_data.sched);
+		EE_Async_Write(EE_data.sched, sizeof(EE_data.sched));
+	}
+	Sched_Init(EE_data.sched);
+	Levels_Update();
+	
+#ifdef HW_PWM_LEDS
+	GTCCR = _BV(TSM) | _BV(PSRSYNC);	// hold the prescaler so Timer0 and Timer1 start in step
+#endif
+
+	// Timer 0 setup for simple count mode, used as timebase LED PWM
+	TCCR0A = 0;		// simple count more 		
+#ifdef MUX_LEDS
+	TCCR0B = 3;		// system Clock 16Mhz/64 = 4us per counter tick, a row of the matrix per overflow
+#else
+	TCCR0B = 4;		// system Clock 16Mhz/256 = 16us per counter tick 
+#endif
+	//TCCR0B = 3;		// system Clock 16Mhz/64 = 4us per counter tick 
+	//TCCR0B = 5;		// system Clock 16Mhz/1024 = 64us per counter tick 
+	//TCCR0B = 2;		// system Clock 1Mhz/8 = 8us per counter tick 
+	TIMSK0 = 0x7;	// Enable OverFLow , OCR0A and OCR0B interrupt enables
+	LEDs_Update();
+	
+#ifdef HW_PWM_LEDS
+	// Timer 1 as 8 bit fast PWM from the same 16us clock, OC1A and OC1B in inverting mode
+	TCCR1A = _BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0) | _BV(WGM10);
+	TCCR1B = _BV(WGM12) | 4;
+	TCNT0 = 0;
+	TCNT1 = 0;
+	GTCCR = 0;		// go
+#endif
+
+	MCUSR =0; //MCU status register clear 
+	
+	// Timer 1 setup for the 1 second time base 
+	TB_Init(EE_data.drift);
+	
+	if (IsButtonPressed(BUTTON1))	// calibration requested
+	{
+		buttons_down = BUTTON1;		// its release is no button press
+		buttons_ignore = BUTTON1;
+		DDRC &= ~CAL_REF_PIN;
+		TB_StartCalibration();
+		mode = MODE_CALIBRATE;
+	}
+
+#ifdef USB_CDC
+	CDC_Init();
+	Usb_MeasureLoop();
+#endif
+
+	TW_Start(&buttons_timer, BUTTON_SCAN_TICKS, BUTTON_SCAN_TICKS, Buttons_Scan);
+	TRACE_INIT();
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sei();
+		
+    while(1)	// for ever
+    {
+#ifdef USB_CDC
+		loop_passes++;
+		TRACE_BEGIN(TR_USB_POLL);
+		Usb_Poll();
+		TRACE_END(TR_USB_POLL);
+#endif
+		TW_Poll();				// the buttons, see Buttons_Scan()
+		
+		if (mode == MODE_CALIBRATE)
+		{
+			Seconds = TB_CalibrationEdges();	// seconds LED toggles with every good reference pulse
+			
+			if (TB_CalibrationDone())
+			{
+				int16_t drift;
+				bool good;
+				
+				good = TB_CalibrationResult(&drift);	// read it before the stop, that drops the result
+				TB_StopCalibration();
+				if (good)
+				{
+					EE_data.drift = drift;
+					TB_SetDrift(drift);
+					EE_Async_Write(&EE_data.drift,sizeof(EE_data.drift));
+				}
+				LEDs_Init();
+				mode = 1;
+			}
+		}
+		
+		TRACE_BEGIN(TR_LEDS_UPDATE);
+		Levels_Update();		// once a minute, the schedule
+		LEDs_Update();			// pick up changes from the buttons
+		TRACE_END(TR_LEDS_UPDATE);
+		
+#ifndef USB_CDC
+		cli();					// nothing left to do until the next interrupt, the USB build keeps polling
+		if (!TW_Pending())
+		{
+			sleep_enable();
+			sei();
+			sleep_cpu();		// the Timer0 interrupts wake it every 4ms at the latest
+			sleep_disable();
+		}
+		sei();
+#endif
+    } // end of for-ever
+}
+
+
+ISR(TIMER0_COMPA_vect,ISR_BLOCK)	// Turn on LEDS that should be bright
+{
+	TRACE_BEGIN(TR_TIMER0_COMPA);
+#ifdef MUX_LEDS
+	Mux_Bright();
+#else
+	PORTD |= bright_d;
+	PORTB |= bright_b;
+	PORTC |= bright_c;
+#endif
+	TRACE_END(TR_TIMER0_COMPA);
+}
+
+
+ISR(TIMER0_COMPB_vect,ISR_BLOCK)	// Turn on LEDS that should be dim, thats all LEDS 
+{
+	TRACE_BEGIN(TR_TIMER0_COMPB);
+#ifdef MUX_LEDS
+	Mux_Dim();
+#elif defined(HW_PWM_LEDS)
+	PORTD |= LEDS_HOURS;
+	PORTB |= LEDS_1MINS | LEDS_10MINS;
+	PORTC |= LEDS_AM_PM;				// seconds is on OC1B
+#else
+	PORTD |= LEDS_HOURS;
+	PORTB |= LEDS_1MINS;	
+	PORTC |= LEDS_10MINS;	
+	PORTC |= LEDS_AM_PM;	
+	PORTC |= LEDS_Second;
+#endif
+	TRACE_END(TR_TIMER0_COMPB);
+}
+
+
+ISR(TIMER0_OVF_vect, ISR_BLOCK)
+{
+#ifdef MUX_LEDS
+	Mux_Step(BUTTON1 | BUTTON2 | BUTTON3);	// next row, the pull-ups for the switches kept
+#else
+	TurnOffAllLEDs();
+#endif
+	TW_Tick();				// before the trace, it is the high byte of the trace time
+	TRACE_BEGIN(TR_TIMER0_OVF);
+#ifdef HW_PWM_LEDS
+	TB_PeriodTick();
+#endif
+	TRACE_END(TR_TIMER0_OVF);
+}	
+
+
+
+// Called from the timebase interrupt once per trimmed second. The interrupt wakes the main loop, its LEDs_Update()
+// shows the new time
+void
+Clock_SecondTick(void)
+{
+#ifdef USB_CDC
+	uptime++;
+	second_flag = true;
+#endif
+	if (mode)		// clock is in settings mode, don't increment time
+	{
+		Seconds = 0;
+		return;
+	}	
+	Seconds++;
+	ripple();
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+/*
+ * schedule.c
+ *
+ * Created: 10/19/2026
+ *
+ * The bright and dim levels follow the time of day: a table of up to SCHED_POINTS breakpoints in the EEPROM settings,
+ * each a minute of the day with the levels from there on, and the levels in between move in a straight line from one
+ * breakpoint to the next. The last one runs on past midnight to the first, a table of one breakpoint is a constant.
+ * A breakpoint level of SCHED_MENU stands for the level set with the buttons, so the day keeps what the user chose.
+ *
+ * The clock asks once a minute, Sched_Levels() remembers the segment it found last time and moves on from there, the
+ * minute tick is at most one step, setting the clock at most a lap of the table. The levels go to OCR0A and OCR0B
+ * with LEDs_Update(), the PWM interrupts don't change.
+ *
+ * The default table, written when the schedule in the EEPROM is erased: the levels of the menu from 7:00 to 21:00,
+ * down to NIGHT_BRIGHT and NIGHT_DIM until 23:00, the dim LEDs off, and back up from 6:00. currents.txt has 8.8mA
+ * for a bright LED, at night it gets a 6th of the on-time of the default day level.
+ */
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "schedule.h"
+
+static const sched_point_t default_table[] PROGMEM =
+{
+	{  6 * 60, NIGHT_BRIGHT, NIGHT_DIM },	// night, brightening up from here
+	{  7 * 60, SCHED_MENU, SCHED_MENU },	// day
+	{ 21 * 60, SCHED_MENU, SCHED_MENU },	// dimming down from here
+	{ 23 * 60, NIGHT_BRIGHT, NIGHT_DIM },	// night
+};
+
+static const sched_point_t *sched;
+static uint8_t sched_n;				// breakpoints in the table
+static uint8_t sched_seg;			// segment of the last minute asked for, from breakpoint sched_seg to the next
+
+
+// Fills an erased table with the default schedule
+void
+Sched_Default(sched_point_t table[SCHED_POINTS])
+{
+	memset(table, 0xff, SCHED_POINTS * sizeof(sched_point_t));
+	memcpy_P(table, default_table, sizeof(default_table));
+}
+
+
+// Takes the table, up to the first unused breakpoint or one out of order. Call it again after the table changed
+void
+Sched_Init(const sched_point_t table[SCHED_POINTS])
+{
+	uint8_t n = 0;
+
+	while (n < SCHED_POINTS && table[n].minute < MINUTES_DAY && (n == 0 || table[n].minute > table[n - 1].minute))
+		n++;
+	sched = table;
+	sched_n = n;
+	sched_seg = 0;
+}
+
+
+static uint8_t
+Sched_Next(uint8_t i)
+{
+	return (i + 1 < sched_n) ? i + 1 : 0;
+}
+
+
+// Minutes from a to b, forwards over midnight
+static uint16_t
+Sched_Span(uint16_t a, uint16_t b)
+{
+	return (b >= a) ? b - a : b + MINUTES_DAY - a;
+}
+
+
+static uint8_t
+Sched_Lerp(uint8_t from, uint8_t to, uint16_t pos, uint16_t span)
+{
+	return from + (int16_t)(((int32_t)to - from) * pos / span);
+}
+
+
+// The levels at a minute of the day. false without a schedule, the menu levels stay then
+bool
+Sched_Levels(uint16_t minute, uint8_t menu_bright, uint8_t menu_dim, uint8_t *bright, uint8_t *dim)
+{
+	const sched_point_t *a, *b;
+	uint16_t span, pos;
+	uint8_t i, a_bright, a_dim, b_bright, b_dim;
+
+	if (sched_n == 0)
+		return false;
+
+	// forwards from the last segment until the minute is in it
+	for (i = 0; i < sched_n; i++)
+	{
+		a = &sched[sched_seg];
+		b = &sched[Sched_Next(sched_seg)];
+		span = Sched_Span(a->minute, b->minute);
+		pos = Sched_Span(a->minute, minute);
+		if (span == 0)				// a single breakpoint, all day
+			span = MINUTES_DAY;
+		if (pos < span)
+			break;
+		sched_seg = Sched_Next(sched_seg);
+	}
+
+	a_bright = (a->bright == SCHED_MENU) ? menu_bright : a->bright;
+	a_dim = (a->dim == SCHED_MENU) ? menu_dim : a->dim;
+	b_bright = (b->bright == SCHED_MENU) ? menu_bright : b->bright;
+	b_dim = (b->dim == SCHED_MENU) ? menu_dim : b->dim;
+	*bright = Sched_Lerp(a_bright, b_bright, pos, span);
+	*dim = Sched_Lerp(a_dim, b_dim, pos, span);
+	return true;
+}
@@ -0,0 +1,34 @@
+/*
+ * schedule.h
+ *
+ * Created: 10/19/2026
+ *
+ * Time of day schedule of the LED levels, night dimming for the binary clock. See schedule.c
+ */
+
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define SCHED_POINTS	8			// breakpoints in the EEPROM table
+#define SCHED_END		0xffff		// minute of an unused breakpoint, erased EEPROM, ends the table
+#define SCHED_MENU		0			// level of a breakpoint: the one set from the menu
+#define MINUTES_DAY		(24 * 60)
+
+#define NIGHT_BRIGHT	230			// levels of the default schedule at night, OCR0A and OCR0B
+#define NIGHT_DIM		255
+
+typedef struct sched_point
+{
+	uint16_t minute;			// of the day, 0..1439, ascending
+	uint8_t bright;				// OCR0A from this minute on, or SCHED_MENU
+	uint8_t dim;				// OCR0B
+} sched_point_t;
+
+void Sched_Default(sched_point_t table[SCHED_POINTS]);
+void Sched_Init(const sched_point_t table[SCHED_POINTS]);
+bool Sched_Levels(uint16_t minute, uint8_t menu_bright, uint8_t menu_dim, uint8_t *bright, uint8_t *dim);
+
+#endif /* SCHEDULE_H_ */
@@ -0,0 +1,281 @@
+/*
+ * timebase.c
+ *
+ * Created: 10/19/2026
+ *
+ * Trimmed 1 Hz timebase.
+ * Timer1 runs in CTC mode from F_CPU/1024 and interrupts every TB_TICKS_PER_SEC counts. The crystal error (drift) is
+ * known in units of 0.1ppm and gets added to a phase accumulator once per second. Every time the accumulated error
+ * reaches a full 64us tick the next second is stretched (crystal fast) or shortened (crystal slow) by that tick.
+ * The error left over is always less than one tick, so the clock no longer drifts by the crystal tolerance.
+ *
+ * Calibration:
+ * The drift is measured against an external 1 pulse per second reference (GPS receiver, lab counter, ...) fed into
+ * the Timer1 input capture pin ICP1 (PC7). Every rising edge captures TCNT1, the length of TB_CAL_SECONDS reference
+ * seconds is then counted in timer ticks while the accumulator is disabled, so the raw crystal frequency is measured.
+ * Intervals that are way off one second are taken as glitches and restart the measurement.
+ *
+ * TB_ReferenceEdge() does all the work of the capture interrupt, so a host build can inject a simulated reference
+ * edge by setting up the captured count and calling it directly.
+ *
+ * HW_PWM_LEDS:
+ * Timer1 drives LEDs as an 8 bit PWM, in step with Timer0, and the second is counted in 16us ticks by TB_PeriodTick()
+ * from the Timer0 overflow. A second ends on the first overflow past its length, so each one lands up to a PWM period
+ * (4ms) late but no ticks get lost. The rest of the work is done by the Timer1 compare C interrupt, which is only
+ * enabled for that: OCF1C gets set every PWM period so it runs right after the overflow, and the overflow interrupt
+ * stays free of calls. Trimming and calibration work the same way with a 16us tick, ICR1 then holds the position
+ * inside the current Timer0 period.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "timebase.h"
+#include "trace_ids.h"
+
+#define CAL_IDLE		0
+#define CAL_WAIT_EDGE	1		// waiting for the first reference edge
+#define CAL_MEASURING	2
+#define CAL_DONE		3
+
+static int16_t tb_drift;		// crystal error in 0.1ppm, +ve == crystal runs fast
+static int16_t tb_phase;		// accumulated error not yet corrected, always less than one tick
+
+static volatile uint8_t cal_state = CAL_IDLE;
+static volatile uint8_t cal_edges;
+static volatile uint16_t cal_seconds;		// timer seconds since the first reference edge
+static uint32_t cal_first;					// tick position of the first edge
+static uint32_t cal_last_edge;				// tick count at the previous edge, relative to the first edge
+static volatile uint32_t cal_ticks;			// measured length of TB_CAL_SECONDS reference seconds
+
+#ifdef HW_PWM_LEDS
+uint16_t tb_count;							// ticks into the current second, see TB_PeriodTick()
+uint16_t tb_second = TB_TICKS_PER_SEC;		// length of the current second
+#endif
+
+
+void
+TB_Init(int16_t drift_ppm10)
+{
+	TB_SetDrift(drift_ppm10);
+
+#ifndef HW_PWM_LEDS						// Timer1 is set up by the LED code
+	TIMSK1 = _BV(OCIE1A);	// Enable OCR1A interrupt
+	TCCR1A = 0x00;			// No pin toggles on compare -- CTC (normal) mode
+	TCCR1B = 0x0D;			// CTC mode, F_CPU 16mhz/1024 clock ( 64us)
+	OCR1A = TB_TICKS_PER_SEC-1;	// counting 15625 counts of 64 us == 1 second
+#endif
+}
+
+
+void
+TB_SetDrift(int16_t drift_ppm10)
+{
+	if (drift_ppm10 > TB_DRIFT_MAX || drift_ppm10 < -TB_DRIFT_MAX)
+		drift_ppm10 = 0;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		tb_drift = drift_ppm10;
+		tb_phase = 0;
+	}
+}
+
+
+// Starts a new second from now, for setting the time from an exact source
+void
+TB_Resync(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+#ifdef HW_PWM_LEDS
+		tb_count = 0;			// Timer0 keeps running in step with Timer1, good to a PWM period (4ms)
+		TIMSK1 &= ~_BV(OCIE1C);
+#else
+		TCNT1 = 0;
+		TIFR1 = _BV(OCF1A);
+#endif
+	}
+}
+
+
+void
+TB_StartCalibration(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		cal_state = CAL_WAIT_EDGE;
+		cal_edges = 0;
+		TCCR1B |= _BV(ICNC1) | _BV(ICES1);	// noise canceler on, capture on the rising edge
+		TIFR1 = _BV(ICF1);
+		TIMSK1 |= _BV(ICIE1);
+	}
+}
+
+
+void
+TB_StopCalibration(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TIMSK1 &= ~_BV(ICIE1);
+		cal_state = CAL_IDLE;
+		tb_phase = 0;
+	}
+}
+
+
+uint8_t
+TB_CalibrationEdges(void)	// number of good reference seconds counted so far
+{
+	return cal_edges;
+}
+
+
+bool
+TB_CalibrationDone(void)
+{
+	return cal_state == CAL_DONE;
+}
+
+
+// Converts the measured window into a drift, false if the reference was out of range
+bool
+TB_CalibrationResult(int16_t *drift_ppm10)
+{
+	int32_t diff;
+
+	if (cal_state != CAL_DONE)
+		return false;
+
+	diff = cal_ticks - (uint32_t)TB_CAL_SECONDS * TB_TICKS_PER_SEC;
+	diff = diff * 100000L / (((uint32_t)TB_CAL_SECONDS * TB_TICKS_PER_SEC) / 100);
+
+	if (diff > TB_DRIFT_MAX || diff < -TB_DRIFT_MAX)
+		return false;
+
+	*drift_ppm10 = diff;
+	return true;
+}
+
+
+// Ticks counted since the measurement started, up to the captured count.
+// The capture interrupt has priority over the timebase interrupts, if the timer wrapped just before the edge that
+// period has not been counted yet.
+static uint32_t
+cal_position(uint16_t icr)
+{
+	uint32_t pos;
+
+#ifdef HW_PWM_LEDS
+	pos = (uint32_t)(uint16_t)(cal_seconds + ((TIMSK1 & _BV(OCIE1C)) != 0)) * TB_TICKS_PER_SEC + tb_count + icr;
+	if ((TIFR0 & _BV(TOV0)) && icr < TB_PERIOD/2)
+		pos += TB_PERIOD;
+#else
+	pos = (uint32_t)(uint16_t)(cal_seconds + ((TIFR1 & _BV(OCF1A)) && icr < TB_PERIOD/2)) * TB_TICKS_PER_SEC + icr;
+#endif
+	return pos;
+}
+
+
+static void
+cal_restart(uint16_t icr)
+{
+	cal_seconds = 0;
+	cal_first = cal_position(icr);
+	cal_last_edge = 0;
+	cal_edges = 0;
+	cal_state = CAL_MEASURING;
+}
+
+
+void
+TB_ReferenceEdge(uint16_t icr)
+{
+	uint32_t now, interval;
+
+	if (cal_state != CAL_WAIT_EDGE && cal_state != CAL_MEASURING)
+		return;
+
+	if (cal_state == CAL_WAIT_EDGE)
+	{
+		cal_restart(icr);
+		return;
+	}
+
+	now = cal_position(icr) - cal_first;
+	interval = now - cal_last_edge;
+	cal_last_edge = now;
+
+	if (interval > TB_TICKS_PER_SEC + TB_TICKS_PER_SEC/64 || interval < TB_TICKS_PER_SEC - TB_TICKS_PER_SEC/64)
+	{
+		cal_restart(icr);		// glitch or missing pulse, start over from this edge
+		return;
+	}
+
+	if (++cal_edges >= TB_CAL_SECONDS)
+	{
+		cal_ticks = now;
+		cal_state = CAL_DONE;
+		TIMSK1 &= ~_BV(ICIE1);
+	}
+}
+
+
+ISR(TIMER1_CAPT_vect, ISR_BLOCK)
+{
+	TRACE_BEGIN(TR_TIMER1_CAPT);
+	TB_ReferenceEdge(ICR1);
+	TRACE_END(TR_TIMER1_CAPT);
+}
+
+
+// Length of the next second in timer ticks, longer or shorter by the full ticks of drift accumulated so far
+static uint16_t
+tb_trim(void)
+{
+	uint16_t len = TB_TICKS_PER_SEC;
+
+	if (cal_state != CAL_IDLE)
+		return len;								// measure the raw crystal
+
+	tb_phase += tb_drift;
+	while (tb_phase >= TB_TICK_PPM10)			// crystal fast, stretch the next second
+	{
+		tb_phase -= TB_TICK_PPM10;
+		len++;
+	}
+	while (tb_phase <= -TB_TICK_PPM10)			// crystal slow, shorten it
+	{
+		tb_phase += TB_TICK_PPM10;
+		len--;
+	}
+	return len;
+}
+
+
+#ifdef HW_PWM_LEDS
+ISR(TIMER1_COMPC_vect, ISR_BLOCK)		// one shot, a second has ended
+{
+	TRACE_BEGIN(TR_TIMER1_COMPC);
+	TIMSK1 &= ~_BV(OCIE1C);
+	if (cal_state != CAL_IDLE)
+		cal_seconds++;
+
+	tb_second = tb_trim();
+	Clock_SecondTick();
+	TRACE_END(TR_TIMER1_COMPC);
+}
+
+#else
+
+ISR(TIMER1_COMPA_vect, ISR_BLOCK)
+{
+	TRACE_BEGIN(TR_TIMER1_COMPA);
+	if (cal_state != CAL_IDLE)
+		cal_seconds++;
+
+	OCR1A = tb_trim() - 1;
+	Clock_SecondTick();
+	TRACE_END(TR_TIMER1_COMPA);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+/*
+ * timebase.h
+ *
+ * Created: 10/19/2026
+ *
+ * Trimmed 1 Hz timebase and crystal calibration for the binary clock. See timebase.c
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include "config.h"
+
+#ifdef HW_PWM_LEDS
+#define TB_TICKS_PER_SEC	62500		// Timer0 and Timer1 clocked by F_CPU/256 == 16us per tick
+#define TB_TICK_PPM10		160			// one tick is 16ppm of a second, in units of 0.1ppm
+#define TB_PERIOD			256			// ticks per Timer0 overflow, seconds are counted in these
+#else
+#define TB_TICKS_PER_SEC	15625		// Timer1 clocked by F_CPU/1024 == 64us per tick
+#define TB_TICK_PPM10		640			// one tick is 64ppm of a second, in units of 0.1ppm
+#define TB_PERIOD			TB_TICKS_PER_SEC	// one compare interrupt per second
+#endif
+#define TB_DRIFT_MAX		5000		// +-500ppm, anything larger is a bad crystal or a bad reference
+#define TB_CAL_SECONDS		128			// calibration window, one tick over 128s == 0.5ppm resolution (0.125ppm HW_PWM_LEDS)
+
+void TB_Init(int16_t drift_ppm10);
+void TB_SetDrift(int16_t drift_ppm10);
+void TB_Resync(void);
+
+void TB_StartCalibration(void);
+void TB_StopCalibration(void);
+uint8_t TB_CalibrationEdges(void);
+bool TB_CalibrationDone(void);
+bool TB_CalibrationResult(int16_t *drift_ppm10);
+void TB_ReferenceEdge(uint16_t icr);
+
+void Clock_SecondTick(void);	// provided by the clock, called once per (trimmed) second from the timer interrupt
+
+#ifdef HW_PWM_LEDS
+extern uint16_t tb_count, tb_second;
+
+// Counts the second from the Timer0 overflow interrupt, inline so that interrupt needs no call and no register saves
+static inline void
+TB_PeriodTick(void)
+{
+	tb_count += TB_PERIOD;
+	if (tb_count >= tb_second)
+	{
+		tb_count -= tb_second;
+		TIMSK1 |= _BV(OCIE1C);		// TIMER1_COMPC_vect runs next and does the rest, see timebase.c
+	}
+}
+#endif
+
+#endif /* TIMEBASE_H_ */
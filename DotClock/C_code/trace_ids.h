@@ -0,0 +1,52 @@
+/*
+ * trace_ids.h
+ *
+ * Created: 10/19/2026
+ *
+ * Event ids and timestamp of the TRACE build of the binary clock, see Common/trace.c. The clock has no spare USART
+ * pin, the host simulator drains the ring (HostSim, -b). Tools/tracedec -n reads the names from here.
+ */
+
+#ifndef TRACE_IDS_H_
+#define TRACE_IDS_H_
+
+#include "config.h"
+
+#define TR_TIMER0_OVF		0		// ISRs
+#define TR_TIMER0_COMPA		1
+#define TR_TIMER0_COMPB		2
+#define TR_TIMER1_COMPA		3		// the second
+#define TR_TIMER1_COMPC		4		// the second with HW_PWM_LEDS
+#define TR_TIMER1_CAPT		5
+#define TR_EE_READY			6
+#define TR_LEDS_UPDATE		16		// main loop
+#define TR_USB_POLL			17
+#define TR_BUTTON			18		// mark: the button pressed, 1..3
+
+#ifdef TRACE
+
+#include <avr/io.h>
+#include "../../Common/timer_wheel.h"
+
+#define TRACE_PRESCALE		T0_PRESCALE	// Timer0, 16us, 4us with MUX_LEDS
+
+// Timer0 with the overflows counted by TW_ticks as the high byte, the 16 bit timer is busy with the second. Wraps
+// after 1.05s, 262ms with MUX_LEDS. An overflow the interrupt hasn't counted yet is added here, TIMER0_OVF_vect
+// traces after TW_Tick()
+static inline uint16_t
+Trace_Clock(void)
+{
+	uint8_t lo = TCNT0;
+	uint8_t hi = TW_ticks;
+
+	if ((TIFR0 & _BV(TOV0)) && lo < 0x80)
+		hi++;
+	return (uint16_t)hi << 8 | lo;
+}
+#define TRACE_CLOCK()		Trace_Clock()
+
+#endif
+
+#include "../../Common/trace.h"
+
+#endif /* TRACE_IDS_H_ */
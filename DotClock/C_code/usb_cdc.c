@@ -0,0 +1,350 @@
+/*
+ * usb_cdc.c
+ *
+ * Created: 10/19/2026
+ *
+ * Minimal USB serial port (CDC-ACM) for the ATmega32U2, just enough for the time sync and telemetry of the clock.
+ *
+ * The controller is polled from the main loop, there are no USB interrupts, so the LED PWM interrupts never wait
+ * for it. Every CDC_Task() call handles at most one control packet (8 bytes), one bulk OUT and one bulk IN packet
+ * (CDC_EP_SIZE bytes), that keeps a call below about 600 cycles however busy the host is. Until the next call the
+ * host just gets NAKs; control transfers may take hundreds of milliseconds, far more than a main loop pass.
+ *
+ * Endpoints: 0 control, 1 interrupt IN for CDC notifications (never sent), 2 bulk IN, 3 bulk OUT.
+ * Uses the VID/PID of the LUFA CDC demo (03EB:2044), Linux binds cdc_acm to it and makes it a /dev/ttyACMn.
+ */
+#include "config.h"
+#ifdef USB_CDC
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/power.h>
+#include "usb_cdc.h"
+
+#define EP0_SIZE		8
+#define CDC_NOTIFY_EP	1
+#define CDC_IN_EP		2
+#define CDC_OUT_EP		3
+#define CDC_EP_SIZE		16
+
+// UECFG0X
+#define EP_TYPE_CONTROL		0x00
+#define EP_TYPE_BULK		0x80
+#define EP_TYPE_INTERRUPT	0xC0
+#define EP_DIR_IN			0x01
+// UECFG1X, single bank
+#define EP_SIZE_8			0x00
+#define EP_SIZE_16			0x10
+
+#define CTL_IDLE		0
+#define CTL_IN			1		// sending the data stage
+#define CTL_IN_STATUS	2		// all sent, waiting for the status packet of the host
+#define CTL_LINE_CODING	3		// waiting for the SET_LINE_CODING data
+#define CTL_ADDRESS		4		// the new address gets enabled once the status packet has gone out
+
+static const uint8_t PROGMEM device_desc[] =
+{
+	18, 1,				// device
+	0x00, 0x02,			// USB 2.0
+	0x02, 0x00, 0x00,	// CDC
+	EP0_SIZE,
+	0xEB, 0x03,			// VID
+	0x44, 0x20,			// PID
+	0x00, 0x01,			// release 1.00
+	0, 1, 0,			// no manufacturer, product string, no serial number
+	1					// configurations
+};
+
+static const uint8_t PROGMEM config_desc[] =
+{
+	9, 2, 67, 0, 2, 1, 0, 0x80, 50,				// 67 bytes in total, 2 interfaces, bus powered 100mA
+	9, 4, 0, 0, 1, 0x02, 0x02, 0x01, 0,			// interface 0: CDC ACM, AT commands
+	5, 0x24, 0x00, 0x10, 0x01,					// CDC header 1.10
+	5, 0x24, 0x01, 0x00, 1,						// call management, data on interface 1
+	4, 0x24, 0x02, 0x02,						// ACM, line coding and serial state
+	5, 0x24, 0x06, 0, 1,						// union, interface 0 controls interface 1
+	7, 5, 0x80 | CDC_NOTIFY_EP, 0x03, 8, 0, 0xFF,
+	9, 4, 1, 0, 2, 0x0A, 0, 0, 0,				// interface 1: CDC data
+	7, 5, CDC_OUT_EP, 0x02, CDC_EP_SIZE, 0, 0,
+	7, 5, 0x80 | CDC_IN_EP, 0x02, CDC_EP_SIZE, 0, 0,
+};
+
+static const uint8_t PROGMEM lang_desc[] = { 4, 3, 0x09, 0x04 };	// English (US)
+static const uint8_t PROGMEM product_desc[] = { 18, 3, 'D',0, 'o',0, 't',0, 'C',0, 'l',0, 'o',0, 'c',0, 'k',0 };
+
+static uint8_t usb_config;			// from SET_CONFIGURATION, 0 == not configured
+static bool cdc_dtr;				// the host has the port open
+static uint8_t line_coding[7] = { 0x00, 0xC2, 0x01, 0x00, 0, 0, 8 };	// 115200 8N1, only kept for the host
+
+static uint8_t ctl_state;
+static const uint8_t *ctl_data;
+static uint8_t ctl_left;
+static bool ctl_flash;				// ctl_data points into flash
+static bool ctl_zlp;				// the reply is shorter than asked for, a full last packet needs a zero length one
+static uint8_t ctl_buf[2];			// small replies from RAM
+
+static uint8_t rx_buf[CDC_RX_SIZE];	// rings, the free running indexes are masked on use
+static uint8_t rx_head, rx_tail;
+static uint8_t tx_buf[CDC_TX_SIZE];
+static uint8_t tx_head, tx_tail;
+
+
+static bool
+ep_config(uint8_t ep, uint8_t type, uint8_t size)
+{
+	UENUM = ep;
+	UECONX = _BV(EPEN);
+	UECFG0X = type;
+	UECFG1X = size | _BV(ALLOC);
+	return UESTA0X & _BV(CFGOK);
+}
+
+
+void
+CDC_Init(void)
+{
+	power_usb_enable();
+	USBCON &= ~_BV(USBE);				// reset the controller
+	USBCON |= _BV(USBE) | _BV(FRZCLK);
+	PLLCSR = _BV(PLLP0) | _BV(PLLE);	// 48Mhz from the 16Mhz crystal
+	while (!(PLLCSR & _BV(PLOCK)))
+		;
+	USBCON &= ~_BV(FRZCLK);
+	UDCON &= ~_BV(DETACH);				// attach, the host resets the bus next
+}
+
+
+static void
+ctl_reply(const uint8_t *data, uint8_t len, uint16_t wlength, bool flash)
+{
+	if (len > wlength)
+		len = wlength;
+	ctl_data = data;
+	ctl_left = len;
+	ctl_flash = flash;
+	ctl_zlp = len < wlength && (len % EP0_SIZE) == 0;
+	ctl_state = CTL_IN;
+}
+
+
+static void
+ctl_setup(void)
+{
+	uint8_t type, req, value_lo, value_hi;
+	uint16_t wlength;
+
+	type = UEDATX;
+	req = UEDATX;
+	value_lo = UEDATX;
+	value_hi = UEDATX;
+	(void)UEDATX;					// wIndex, only one interface answers requests
+	(void)UEDATX;
+	wlength = UEDATX;
+	wlength |= UEDATX << 8;
+	UEINTX &= ~_BV(RXSTPI);
+	ctl_state = CTL_IDLE;
+
+	switch (type << 8 | req)
+	{
+		case 0x8006:				// GET_DESCRIPTOR
+			if (value_hi == 1)
+				ctl_reply(device_desc, sizeof(device_desc), wlength, true);
+			else if (value_hi == 2)
+				ctl_reply(config_desc, sizeof(config_desc), wlength, true);
+			else if (value_hi == 3 && value_lo == 0)
+				ctl_reply(lang_desc, sizeof(lang_desc), wlength, true);
+			else if (value_hi == 3 && value_lo == 1)
+				ctl_reply(product_desc, sizeof(product_desc), wlength, true);
+			else
+				UECONX |= _BV(STALLRQ);
+			break;
+
+		case 0x0005:				// SET_ADDRESS
+			UDADDR = value_lo & 0x7f;
+			UEINTX &= ~_BV(TXINI);
+			ctl_state = CTL_ADDRESS;
+			break;
+
+		case 0x0009:				// SET_CONFIGURATION
+			usb_config = value_lo;
+			if (usb_config)
+			{
+				ep_config(CDC_NOTIFY_EP, EP_TYPE_INTERRUPT | EP_DIR_IN, EP_SIZE_8);
+				ep_config(CDC_IN_EP, EP_TYPE_BULK | EP_DIR_IN, EP_SIZE_16);
+				ep_config(CDC_OUT_EP, EP_TYPE_BULK, EP_SIZE_16);
+				UERST = _BV(CDC_NOTIFY_EP) | _BV(CDC_IN_EP) | _BV(CDC_OUT_EP);
+				UERST = 0;
+				UENUM = 0;
+			}
+			UEINTX &= ~_BV(TXINI);
+			break;
+
+		case 0x8008:				// GET_CONFIGURATION
+			ctl_buf[0] = usb_config;
+			ctl_reply(ctl_buf, 1, wlength, false);
+			break;
+
+		case 0x8000:				// GET_STATUS device, interface, endpoint
+		case 0x8100:
+		case 0x8200:
+			ctl_buf[0] = ctl_buf[1] = 0;
+			ctl_reply(ctl_buf, 2, wlength, false);
+			break;
+
+		case 0x0001:				// CLEAR_FEATURE / SET_FEATURE, nothing to do
+		case 0x0003:
+		case 0x0201:
+		case 0x0203:
+			UEINTX &= ~_BV(TXINI);
+			break;
+
+		case 0x2120:				// SET_LINE_CODING
+			ctl_state = CTL_LINE_CODING;
+			break;
+
+		case 0xA121:				// GET_LINE_CODING
+			ctl_reply(line_coding, sizeof(line_coding), wlength, false);
+			break;
+
+		case 0x2122:				// SET_CONTROL_LINE_STATE
+			cdc_dtr = value_lo & 0x01;
+			UEINTX &= ~_BV(TXINI);
+			break;
+
+		default:
+			UECONX |= _BV(STALLRQ);
+			break;
+	}
+}
+
+
+static void
+ctl_in(void)						// next packet of the data stage
+{
+	uint8_t n, i;
+
+	n = ctl_left > EP0_SIZE ? EP0_SIZE : ctl_left;
+	ctl_left -= n;
+	for (i = 0; i < n; i++)
+		UEDATX = ctl_flash ? pgm_read_byte(ctl_data++) : *ctl_data++;
+	UEINTX &= ~_BV(TXINI);
+
+	if (ctl_left == 0 && (n < EP0_SIZE || !ctl_zlp))
+		ctl_state = CTL_IN_STATUS;
+}
+
+
+// Polled from the main loop, one packet per endpoint at the most
+void
+CDC_Task(void)
+{
+	uint8_t n;
+
+	if (UDINT & _BV(EORSTI))		// bus reset, back to address 0 and endpoint 0 only
+	{
+		UDINT &= ~_BV(EORSTI);
+		usb_config = 0;
+		cdc_dtr = false;
+		ctl_state = CTL_IDLE;
+		ep_config(0, EP_TYPE_CONTROL, EP_SIZE_8);
+		return;
+	}
+
+	UENUM = 0;
+	if (UEINTX & _BV(RXSTPI))
+		ctl_setup();
+	else switch (ctl_state)
+	{
+		case CTL_IN:
+			if (UEINTX & _BV(RXOUTI))	// the host has heard enough
+			{
+				UEINTX &= ~_BV(RXOUTI);
+				ctl_state = CTL_IDLE;
+			}
+			else if (UEINTX & _BV(TXINI))
+				ctl_in();
+			break;
+
+		case CTL_IN_STATUS:
+			if (UEINTX & _BV(RXOUTI))
+			{
+				UEINTX &= ~_BV(RXOUTI);
+				ctl_state = CTL_IDLE;
+			}
+			break;
+
+		case CTL_LINE_CODING:
+			if (UEINTX & _BV(RXOUTI))
+			{
+				for (n = 0; n < sizeof(line_coding); n++)
+					line_coding[n] = UEDATX;
+				UEINTX &= ~_BV(RXOUTI);
+				UEINTX &= ~_BV(TXINI);	// zero length status
+				ctl_state = CTL_IDLE;
+			}
+			break;
+
+		case CTL_ADDRESS:
+			if (UEINTX & _BV(TXINI))	// status went out from address 0
+			{
+				UDADDR |= _BV(ADDEN);
+				ctl_state = CTL_IDLE;
+			}
+			break;
+	}
+
+	if (!usb_config)
+		return;
+
+	UENUM = CDC_OUT_EP;
+	if (UEINTX & _BV(RXOUTI))
+	{
+		n = UEBCLX;
+		if (CDC_RX_SIZE - (uint8_t)(rx_head - rx_tail) >= n)	// no room, leave it in the bank and the host waits
+		{
+			while (n--)
+				rx_buf[rx_head++ & (CDC_RX_SIZE-1)] = UEDATX;
+			UEINTX &= ~(_BV(RXOUTI) | _BV(FIFOCON));
+		}
+	}
+
+	UENUM = CDC_IN_EP;
+	if (tx_head != tx_tail && (UEINTX & _BV(TXINI)))
+	{
+		UEINTX &= ~_BV(TXINI);
+		for (n = 0; n < CDC_EP_SIZE && tx_tail != tx_head; n++)
+			UEDATX = tx_buf[tx_tail++ & (CDC_TX_SIZE-1)];
+		UEINTX &= ~_BV(FIFOCON);
+	}
+}
+
+
+bool
+CDC_Connected(void)
+{
+	return usb_config && cdc_dtr;
+}
+
+
+uint8_t
+CDC_Read(uint8_t *buf, uint8_t max)
+{
+	uint8_t n = 0;
+
+	while (n < max && rx_tail != rx_head)
+		buf[n++] = rx_buf[rx_tail++ & (CDC_RX_SIZE-1)];
+	return n;
+}
+
+
+// All of it or nothing, so packets don't get cut. false if the port is closed or the buffer is full
+bool
+CDC_Write(const uint8_t *buf, uint8_t len)
+{
+	if (!CDC_Connected() || CDC_TX_SIZE - (uint8_t)(tx_head - tx_tail) < len)
+		return false;
+	while (len--)
+		tx_buf[tx_head++ & (CDC_TX_SIZE-1)] = *buf++;
+	return true;
+}
+
+#endif /* USB_CDC */
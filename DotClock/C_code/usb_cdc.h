@@ -0,0 +1,24 @@
+/*
+ * usb_cdc.h
+ *
+ * Created: 10/19/2026
+ *
+ * Minimal polled USB serial port (CDC-ACM) for the ATmega32U2. See usb_cdc.c
+ */
+
+#ifndef USB_CDC_H_
+#define USB_CDC_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define CDC_RX_SIZE		32		// bytes buffered from the host
+#define CDC_TX_SIZE		64		// bytes buffered for the host
+
+void CDC_Init(void);
+void CDC_Task(void);
+bool CDC_Connected(void);
+uint8_t CDC_Read(uint8_t *buf, uint8_t max);
+bool CDC_Write(const uint8_t *buf, uint8_t len);
+
+#endif /* USB_CDC_H_ */
@@ -0,0 +1,508 @@
+/*
+ * dotclock_sim.c
+ *
+ * Created: 10/19/2026
+ *
+ * Runs the binary clock firmware (DotClock/C_code) on the virtual ATmega32U2 of sim_avr.c.
+ *
+ * Reports the CPU load and the worst case latency of every ISR, the on-time of every LED pin per PWM period against
+ * the duty cycle the OCR0A/OCR0B levels ask for, and how far the clock has drifted from the simulated real time.
+ * The MUX_LEDS build is judged per scan of the matrix, an LED is on while its column is high and its row low.
+ * Optionally writes a trace of the LED on-times (percent per interval) as a CSV file.
+ *
+ * Usage: dotclock_sim [options]
+ *	-T hours		simulated time, default 1 hour
+ *	-S seconds		simulated time in seconds
+ *	-g				start the clock: press button 1 three times to leave the setting modes
+ *	-p s:b[:ms]		press button b (1..3) at s seconds for ms milliseconds (default 100)
+ *	-x ppm			crystal error, +ve == crystal fast
+ *	-r				1 pulse per second reference on ICP1 (PC7), for the calibration mode
+ *	-e addr=byte	preset an EEPROM byte, the EEPROM is erased (0xff) otherwise
+ *	-c name=cycles	cycle count of an ISR, e.g. -c TIMER0_COMPA_vect=180
+ *	-t file			write the LED trace to file
+ *	-i seconds		trace interval, default 1 second
+ *	-b file			write the event trace of a TRACE build to file, for Tools/tracedec
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <avr/io.h>
+#include "sim_avr.h"
+#ifdef TRACE
+#include "../Common/trace.h"
+#endif
+
+int dotclock_main(void);
+
+extern unsigned char Seconds, Minutes, Hours, am_PM;
+extern unsigned char bright_shown, dim_shown;
+
+#define WEAK __attribute__((weak))
+void TIMER1_CAPT_vect(void) WEAK;
+void TIMER1_COMPA_vect(void) WEAK;
+void TIMER1_COMPB_vect(void) WEAK;
+void TIMER1_COMPC_vect(void) WEAK;
+void TIMER1_OVF_vect(void) WEAK;
+void TIMER0_COMPA_vect(void) WEAK;
+void TIMER0_COMPB_vect(void) WEAK;
+void TIMER0_OVF_vect(void) WEAK;
+void EE_READY_vect(void) WEAK;
+
+static bool ee_ready(void) { return (EECR & (_BV(EERIE) | _BV(EEPE))) == _BV(EERIE); }
+
+// Cycle counts are estimates from the -Os listing, including the ISR prologue and epilogue
+static sim_vector_t vectors[] =
+{
+	{ "TIMER1_CAPT_vect",  TIMER1_CAPT_vect,  420, 0x36, ICF1,  0x6F, ICIE1 },
+	{ "TIMER1_COMPA_vect", TIMER1_COMPA_vect, 330, 0x36, OCF1A, 0x6F, OCIE1A },	// the second, LEDs_Update()
+	{ "TIMER1_COMPB_vect", TIMER1_COMPB_vect,  60, 0x36, OCF1B, 0x6F, OCIE1B },
+	{ "TIMER1_COMPC_vect", TIMER1_COMPC_vect, 330, 0x36, OCF1C, 0x6F, OCIE1C },	// the second with HW_PWM_LEDS
+	{ "TIMER1_OVF_vect",   TIMER1_OVF_vect,   120, 0x36, TOV1,  0x6F, TOIE1 },
+	{ "TIMER0_COMPA_vect", TIMER0_COMPA_vect,  40, 0x35, OCF0A, 0x6E, OCIE0A },
+#if defined(MUX_LEDS)
+	{ "TIMER0_COMPB_vect", TIMER0_COMPB_vect,  40, 0x35, OCF0B, 0x6E, OCIE0B },
+	{ "TIMER0_OVF_vect",   TIMER0_OVF_vect,    72, 0x35, TOV0,  0x6E, TOIE0 },	// the next row
+#elif defined(HW_PWM_LEDS)
+	{ "TIMER0_COMPB_vect", TIMER0_COMPB_vect,  28, 0x35, OCF0B, 0x6E, OCIE0B },
+	{ "TIMER0_OVF_vect",   TIMER0_OVF_vect,    58, 0x35, TOV0,  0x6E, TOIE0 },	// counts the second inline
+#else
+	{ "TIMER0_COMPB_vect", TIMER0_COMPB_vect,  32, 0x35, OCF0B, 0x6E, OCIE0B },
+	{ "TIMER0_OVF_vect",   TIMER0_OVF_vect,    32, 0x35, TOV0,  0x6E, TOIE0 },
+#endif
+	{ "EE_READY_vect",     EE_READY_vect,      90, 0,    0,     0x3F, EERIE, ee_ready },
+};
+
+typedef struct led
+{
+	const char *name;
+	int port, bit;
+	bool mux;						// in the matrix, port and bit are the column
+	int row;						// PORTB bit of the row, low == on
+	bool on;
+	uint64_t since;					// on since
+	uint64_t period_on, trace_on;	// on-time in the current PWM period and trace interval
+	uint64_t n[2];					// periods seen dim and bright
+	double sum[2], min[2], max[2];	// duty per period, dim and bright
+} led_t;
+
+#define MUX_ROWS	6		// ledmux.h
+#define MUX(name, row, col)	{ name, SIM_PORTD, col, true, row }
+
+static led_t leds[] =
+{
+#if defined(MUX_LEDS)
+	MUX("H10", 0, 0),
+#ifdef MUX_24H
+	MUX("H20", 0, 1),
+#else
+	MUX("PM", 0, 3),
+#endif
+	MUX("H1", 1, 0), MUX("H2", 1, 1), MUX("H4", 1, 2), MUX("H8", 1, 3),
+	MUX("T1", 2, 0), MUX("T2", 2, 1), MUX("T4", 2, 2),
+	MUX("M1", 3, 0), MUX("M2", 3, 1), MUX("M4", 3, 2), MUX("M8", 3, 3),
+	MUX("S10", 4, 0), MUX("S20", 4, 1), MUX("S40", 4, 2),
+	MUX("S1", 5, 0), MUX("S2", 5, 1), MUX("S4", 5, 2), MUX("S8", 5, 3),
+	{ "LED1", SIM_PORTD, 6 },
+#elif defined(HW_PWM_LEDS)
+	{ "H1", SIM_PORTD, 0 }, { "H2", SIM_PORTD, 1 }, { "H4", SIM_PORTD, 2 }, { "H8", SIM_PORTD, 3 },
+	{ "T1", SIM_PORTB, 0 }, { "T2", SIM_PORTB, 1 }, { "T4", SIM_PORTB, 2 },
+	{ "M1", SIM_PORTB, 4 }, { "M2", SIM_PORTB, 5 }, { "M4", SIM_PORTB, 6 }, { "M8", SIM_PORTB, 7 },
+	{ "PM", SIM_PORTC, 4 }, { "SEC", SIM_PORTC, 5 }, { "LED1", SIM_PORTC, 6 },
+#else
+	{ "H1", SIM_PORTD, 0 }, { "H2", SIM_PORTD, 1 }, { "H4", SIM_PORTD, 2 }, { "H8", SIM_PORTD, 3 },
+	{ "T1", SIM_PORTC, 5 }, { "T2", SIM_PORTC, 6 }, { "T4", SIM_PORTC, 7 },
+	{ "M1", SIM_PORTB, 4 }, { "M2", SIM_PORTB, 5 }, { "M4", SIM_PORTB, 6 }, { "M8", SIM_PORTB, 7 },
+	{ "PM", SIM_PORTC, 4 }, { "SEC", SIM_PORTC, 2 }, { "LED1", SIM_PORTD, 6 },
+#endif
+};
+#define N_LEDS (sizeof(leds)/sizeof(leds[0]))
+
+#define BUTTON_PIN(b)	((b) == 1 ? 7 : (b) == 2 ? 4 : 5)	// on port D
+#define MAX_PRESSES		64
+
+static struct { double s, ms; int button; uint64_t down, up; } presses[MAX_PRESSES];
+static int n_presses;
+
+static double ppm;						// crystal error
+static bool reference;
+static uint64_t next_ref = UINT64_MAX;
+static double ref_second = 0.5;			// the reference pulse is due at this real time
+static uint64_t input_last;				// inputs up to here have been handled
+static double cycles_per_sec;			// CPU cycles per real second
+
+static uint64_t period_start;
+static FILE *trace;
+static uint64_t trace_interval, trace_start;
+static FILE *events;					// the firmware's event trace
+
+static uint32_t clock_last = UINT32_MAX;	// displayed time in seconds
+static uint32_t clock_ticks;				// seconds counted since the clock was started or set
+static bool clock_running;
+static uint64_t clock_t_first, clock_t_last;
+
+// The dim and bright levels. The matrix has compare values of its own per row, the levels the clock shows are in
+// bright_shown and dim_shown then, the schedule moves them
+static uint8_t
+level(bool bright)
+{
+#ifdef MUX_LEDS
+	return bright ? bright_shown : dim_shown;
+#else
+	return bright ? OCR0A : OCR0B;
+#endif
+}
+
+static uint64_t
+at(double seconds)
+{
+	return (uint64_t)(seconds * cycles_per_sec);
+}
+
+static uint8_t
+pins(int port)
+{
+	uint8_t v = 0xff;
+	int i;
+
+	if (port == SIM_PORTD)
+		for (i = 0; i < n_presses; i++)
+			if (sim_now >= presses[i].down && sim_now < presses[i].up)
+				v &= ~_BV(BUTTON_PIN(presses[i].button));
+	return v;
+}
+
+static uint64_t
+next_input(void)
+{
+	uint64_t t = next_ref;
+	int i;
+
+	for (i = 0; i < n_presses; i++)
+	{
+		if (presses[i].down > input_last && presses[i].down < t)
+			t = presses[i].down;
+		if (presses[i].up > input_last && presses[i].up < t)
+			t = presses[i].up;
+	}
+	return t;
+}
+
+static void
+input(uint64_t t)
+{
+	input_last = t;
+	if (t == next_ref)
+	{
+		sim_capture(1, t);
+		ref_second += 1.0;
+		next_ref = at(ref_second);
+	}
+	// button levels are looked up by pins() when the firmware reads them
+}
+
+static void
+clock_watch(uint64_t t)
+{
+	uint32_t now = ((am_PM * 12 + Hours) * 60 + Minutes) * 60 + Seconds;
+
+	if (now == clock_last)
+		return;
+	if (clock_last != UINT32_MAX && (now + 86400 - clock_last) % 86400 == 1)
+	{
+		if (clock_running)
+			clock_ticks++;
+		else					// first tick, count from here
+		{
+			clock_running = true;
+			clock_ticks = 0;
+			clock_t_first = t;
+		}
+	}
+	else						// not running yet, or being set
+		clock_running = false;
+	clock_last = now;
+	clock_t_last = t;
+}
+
+// Drains the firmware's trace ring as the USART of a real board would, only without its speed limit
+static void
+events_drain(void)
+{
+#ifdef TRACE
+	uint8_t c;
+
+	while (Trace_Byte(&c))
+		fputc(c, events);
+#endif
+}
+
+static void
+ports(uint64_t t)
+{
+	uint8_t out[SIM_NPORTS];
+	led_t *l;
+	bool on;
+	int p;
+	unsigned i;
+
+	if (events)
+		events_drain();
+
+	for (p = 0; p < SIM_NPORTS; p++)
+		out[p] = sim_port_out(p);
+
+	for (i = 0; i < N_LEDS; i++)
+	{
+		l = &leds[i];
+		on = out[l->port] & _BV(l->bit);
+		if (l->mux && (out[SIM_PORTB] & _BV(l->row)))
+			on = false;
+		if (on == l->on)
+			continue;
+		if (l->on)
+		{
+			l->period_on += t - (l->since > period_start ? l->since : period_start);
+			l->trace_on += t - (l->since > trace_start ? l->since : trace_start);
+		}
+		l->on = on;
+		l->since = t;
+	}
+	clock_watch(t);
+
+	if (trace && t - trace_start >= trace_interval)
+	{
+		fprintf(trace, "%.3f", trace_start / cycles_per_sec);
+		for (i = 0; i < N_LEDS; i++)
+		{
+			l = &leds[i];
+			if (l->on)
+				l->trace_on += t - (l->since > trace_start ? l->since : trace_start);
+			fprintf(trace, ",%.2f", 100.0 * l->trace_on / (t - trace_start));
+			l->trace_on = 0;
+		}
+		fprintf(trace, "\n");
+		trace_start = t;
+	}
+}
+
+// Timer0 reached TOP, one LED PWM period is complete, with MUX_LEDS a scan of the matrix every MUX_ROWS of them
+static void
+timer_top(int timer, uint64_t t)
+{
+	double duty, mid;
+	led_t *l;
+	unsigned i;
+	int c;
+#ifdef MUX_LEDS
+	static int step;
+#endif
+
+	if (timer != 0)
+		return;
+#ifdef MUX_LEDS
+	if (period_start && ++step < MUX_ROWS)
+		return;
+	step = 0;
+#endif
+	if (period_start)
+	{
+		mid = ((256 - level(true)) + (256 - level(false))) / 512.0;	// half way between the dim and the bright duty
+#ifdef MUX_LEDS
+		mid /= MUX_ROWS;
+#endif
+		for (i = 0; i < N_LEDS; i++)
+		{
+			l = &leds[i];
+			if (l->on)
+				l->period_on += t - (l->since > period_start ? l->since : period_start);
+			duty = (double)l->period_on / (t - period_start);
+			c = duty > mid;
+			if (l->n[c] == 0 || duty < l->min[c])
+				l->min[c] = duty;
+			if (l->n[c] == 0 || duty > l->max[c])
+				l->max[c] = duty;
+			l->sum[c] += duty;
+			l->n[c]++;
+			l->period_on = 0;
+		}
+	}
+	period_start = t;
+}
+
+static void
+finish(void)
+{
+	double secs = sim_now / cycles_per_sec, run, err;
+	uint32_t n = 0, worst = 0;
+	led_t *l;
+	unsigned i;
+	int c;
+
+	printf("DotClock: %.1f s simulated, crystal %+.2f ppm, %.2f s host time\n", secs, ppm,
+		(double)clock() / CLOCKS_PER_SEC);
+
+	if (clock_running && clock_t_last > clock_t_first)
+	{
+		run = (clock_t_last - clock_t_first) / cycles_per_sec;
+		err = clock_ticks - run;
+		printf("clock: shows %02u:%02u:%02u %s, ran %.1f s, error %+.3f s (%+.2f ppm)\n", Hours, Minutes, Seconds,
+			am_PM ? "PM" : "AM", run, err, err * 1e6 / run);
+	}
+	printf("\n");
+	sim_report_isrs();
+
+#ifdef MUX_LEDS
+	printf("\nLED on-time per scan, expected dim %.2f%% bright %.2f%% before the row compensation\n",
+		100.0 * (255 - level(false)) / 256 / MUX_ROWS, 100.0 * (255 - level(true)) / 256 / MUX_ROWS);
+#else
+	printf("\nLED on-time per PWM period, expected dim %.2f%% bright %.2f%%\n",
+		100.0 * (255 - level(false)) / 256, 100.0 * (255 - level(true)) / 256);	// the flag is set leaving OCR0x
+#endif
+	printf("%-5s %10s %8s %8s %8s %10s %8s %8s %8s\n", "LED", "dim n", "avg%", "min%", "max%",
+		"bright n", "avg%", "min%", "max%");
+	for (i = 0; i < N_LEDS; i++)
+	{
+		l = &leds[i];
+		printf("%-5s", l->name);
+		for (c = 0; c < 2; c++)
+			printf(" %10" PRIu64 " %8.2f %8.2f %8.2f", l->n[c], l->n[c] ? 100.0 * l->sum[c] / l->n[c] : 0.0,
+				100.0 * l->min[c], 100.0 * l->max[c]);
+		printf("\n");
+	}
+
+	for (i = 0; i < SIM_EE_SIZE; i++)
+	{
+		n += sim_ee_writes[i];
+		if (sim_ee_writes[i] > worst)
+			worst = sim_ee_writes[i];
+	}
+	printf("\nEEPROM: %u byte writes, at most %u to one byte, drift setting %+.1f ppm\n", n, worst,
+		(int16_t)(sim_eeprom[2] | sim_eeprom[3] << 8) / 10.0);	// struct ee_data at address 0
+
+	if (trace)
+		fclose(trace);
+	if (events)
+	{
+		events_drain();
+		fclose(events);
+	}
+}
+
+static sim_target_t target =
+{
+	vectors, sizeof(vectors)/sizeof(vectors[0]), 65536,
+	pins, next_input, input, ports, timer_top, finish
+};
+
+static void
+press(double s, int button, double ms)
+{
+	if (n_presses == MAX_PRESSES || button < 1 || button > 3)
+		return;
+	presses[n_presses].s = s;
+	presses[n_presses].ms = ms;
+	presses[n_presses].button = button;
+	n_presses++;
+}
+
+int
+main(int argc, char **argv)
+{
+	double hours = 1, seconds = 0, interval = 1;
+	const char *trace_file = NULL, *events_file = NULL;
+	bool go = false;
+	sim_vector_t *v;
+	char name[40];
+	unsigned a, b;
+	double s, ms;
+	int i, opt;
+
+	sim_init(&target);
+
+	for (i = 1; i < argc; i++)
+	{
+		opt = argv[i][0] == '-' ? argv[i][1] : 0;
+		if ((opt == 'T' || opt == 'S' || opt == 'p' || opt == 'x' || opt == 'e' || opt == 'c' || opt == 't'
+			|| opt == 'i' || opt == 'b') && i + 1 >= argc)
+			opt = 0;
+
+		switch (opt)
+		{
+			case 'T': hours = atof(argv[++i]); break;
+			case 'S': seconds = atof(argv[++i]); break;
+			case 'g': go = true; break;
+			case 'x': ppm = atof(argv[++i]); break;
+			case 'r': reference = true; break;
+			case 't': trace_file = argv[++i]; break;
+			case 'i': interval = atof(argv[++i]); break;
+			case 'b': events_file = argv[++i]; break;
+			case 'p':
+				ms = 100;
+				if (sscanf(argv[++i], "%lf:%u:%lf", &s, &b, &ms) < 2)
+					goto usage;
+				press(s, b, ms);
+				break;
+			case 'e':
+				if (sscanf(argv[++i], "%i=%i", &a, &b) != 2 || a >= SIM_EE_SIZE)
+					goto usage;
+				sim_eeprom[a] = b;
+				break;
+			case 'c':
+				if (sscanf(argv[++i], "%39[^=]=%u", name, &a) != 2 || (v = sim_vector(name)) == NULL)
+					goto usage;
+				v->cycles = a;
+				break;
+			default:
+usage:
+				fprintf(stderr, "usage: %s [-T hours] [-S seconds] [-g] [-p s:button[:ms]] [-x ppm] [-r]"
+					" [-e addr=byte] [-c isr=cycles] [-t trace.csv] [-i seconds] [-b events.bin]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	cycles_per_sec = SIM_F_CPU * (1.0 + ppm / 1e6);
+	sim_hz = cycles_per_sec;
+	if (go)
+		for (i = 0; i < 3; i++)
+			press(0.5 + 0.5 * i, 1, 100);
+	for (i = 0; i < n_presses; i++)		// in real time, the CPU clock depends on the crystal
+	{
+		presses[i].down = at(presses[i].s);
+		presses[i].up = at(presses[i].s + presses[i].ms / 1000.0);
+	}
+
+	sim_end = at(seconds ? seconds : hours * 3600);
+	if (reference)
+		next_ref = at(ref_second);
+
+	if (trace_file)
+	{
+		if ((trace = fopen(trace_file, "w")) == NULL)
+		{
+			perror(trace_file);
+			return 1;
+		}
+		trace_interval = at(interval);
+		fprintf(trace, "time");
+		for (a = 0; a < N_LEDS; a++)
+			fprintf(trace, ",%s", leds[a].name);
+		fprintf(trace, "\n");
+	}
+
+	if (events_file)
+	{
+#ifndef TRACE
+		fprintf(stderr, "%s: -b needs the firmware built with -DTRACE\n", argv[0]);
+		return 1;
+#endif
+		if ((events = fopen(events_file, "wb")) == NULL)
+		{
+			perror(events_file);
+			return 1;
+		}
+	}
+
+	dotclock_main();	// never returns, the simulation ends from within sim_idle()
+	return 0;
+}
@@ -0,0 +1,21 @@
+/*
+ * avr/eeprom.h -- host simulator stand-in, the EEPROM lives in sim_eeprom[]
+ */
+#ifndef SIM_AVR_EEPROM_H_
+#define SIM_AVR_EEPROM_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define EEMEM	__attribute__((section("sim_eeprom")))
+
+#define eeprom_busy_wait()	do {} while (0)
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+void eeprom_write_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+void eeprom_read_block(void *dst, const void *addr, size_t n);
+void eeprom_write_block(const void *src, void *addr, size_t n);
+void eeprom_update_block(const void *src, void *addr, size_t n);
+
+#endif /* SIM_AVR_EEPROM_H_ */
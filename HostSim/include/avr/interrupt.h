@@ -0,0 +1,20 @@
+/*
+ * avr/interrupt.h -- host simulator stand-in
+ *
+ * An ISR becomes a plain function named after its vector, sim_avr.c calls it when the virtual hardware raises the
+ * interrupt and the global interrupt flag in SREG is set.
+ */
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define ISR(vector, ...)	void vector(void); void vector(void)
+
+#define sei()	(SREG |= 0x80)
+#define cli()	(SREG &= ~0x80)
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
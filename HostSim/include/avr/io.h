@@ -0,0 +1,182 @@
+/*
+ * avr/io.h -- host simulator stand-in
+ *
+ * I/O registers of the ATmega32U2 as a plain byte array at their data space addresses. The registers that have side
+ * effects when they are read (input pins, timer counters, EEPROM data) go through sim_avr.c so the simulator can bring
+ * the virtual hardware up to date first, as do the timer flag registers, where writing a 1 clears a flag.
+ */
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <inttypes.h>
+
+extern volatile uint8_t sim_io[0x100];
+volatile uint8_t *sim_reg_read(uint8_t addr);
+
+#define _SFR_MEM8(a)	(sim_io[a])
+#define _SFR_MEM16(a)	(*(volatile uint16_t *)&sim_io[a])
+#define _SFR_HOOK8(a)	(*sim_reg_read(a))
+#define _SFR_HOOK16(a)	(*(volatile uint16_t *)sim_reg_read(a))
+#define _BV(b)			(1 << (b))
+
+#define PINB	_SFR_HOOK8(0x23)
+#define DDRB	_SFR_MEM8(0x24)
+#define PORTB	_SFR_MEM8(0x25)
+#define PINC	_SFR_HOOK8(0x26)
+#define DDRC	_SFR_MEM8(0x27)
+#define PORTC	_SFR_MEM8(0x28)
+#define PIND	_SFR_HOOK8(0x29)
+#define DDRD	_SFR_MEM8(0x2A)
+#define PORTD	_SFR_MEM8(0x2B)
+#define TIFR0	_SFR_HOOK8(0x35)
+#define TIFR1	_SFR_HOOK8(0x36)
+#define PCIFR	_SFR_MEM8(0x3B)
+#define EIFR	_SFR_MEM8(0x3C)
+#define EIMSK	_SFR_MEM8(0x3D)
+#define GPIOR0	_SFR_MEM8(0x3E)
+#define EECR	_SFR_MEM8(0x3F)
+#define EEDR	_SFR_HOOK8(0x40)
+#define EEAR	_SFR_MEM16(0x41)
+#define GTCCR	_SFR_MEM8(0x43)
+#define TCCR0A	_SFR_MEM8(0x44)
+#define TCCR0B	_SFR_MEM8(0x45)
+#define TCNT0	_SFR_HOOK8(0x46)
+#define OCR0A	_SFR_MEM8(0x47)
+#define OCR0B	_SFR_MEM8(0x48)
+#define PLLCSR	_SFR_MEM8(0x49)
+#define ACSR	_SFR_MEM8(0x50)
+#define SMCR	_SFR_MEM8(0x53)
+#define MCUSR	_SFR_MEM8(0x54)
+#define MCUCR	_SFR_MEM8(0x55)
+#define SPL		_SFR_MEM8(0x5D)
+#define SPH		_SFR_MEM8(0x5E)
+#define SREG	_SFR_MEM8(0x5F)
+#define WDTCSR	_SFR_MEM8(0x60)
+#define CLKPR	_SFR_MEM8(0x61)
+#define PRR0	_SFR_MEM8(0x64)
+#define PRR1	_SFR_MEM8(0x65)
+#define PCICR	_SFR_MEM8(0x68)
+#define EICRA	_SFR_MEM8(0x69)
+#define EICRB	_SFR_MEM8(0x6A)
+#define PCMSK0	_SFR_MEM8(0x6B)
+#define TIMSK0	_SFR_MEM8(0x6E)
+#define TIMSK1	_SFR_MEM8(0x6F)
+#define TCCR1A	_SFR_MEM8(0x80)
+#define TCCR1B	_SFR_MEM8(0x81)
+#define TCCR1C	_SFR_MEM8(0x82)
+#define TCNT1	_SFR_HOOK16(0x84)
+#define ICR1	_SFR_MEM16(0x86)
+#define OCR1A	_SFR_MEM16(0x88)
+#define OCR1B	_SFR_MEM16(0x8A)
+#define OCR1C	_SFR_MEM16(0x8C)
+#define UCSR1A	_SFR_MEM8(0xC8)
+#define UCSR1B	_SFR_MEM8(0xC9)
+#define UCSR1C	_SFR_MEM8(0xCA)
+#define UBRR1	_SFR_MEM16(0xCC)
+#define UDR1	_SFR_MEM8(0xCE)
+
+/* EECR */
+#define EERE	0
+#define EEPE	1
+#define EEMPE	2
+#define EERIE	3
+#define EEPM0	4
+#define EEPM1	5
+
+/* TIMSK0, TIFR0 */
+#define TOIE0	0
+#define OCIE0A	1
+#define OCIE0B	2
+#define TOV0	0
+#define OCF0A	1
+#define OCF0B	2
+
+/* TIMSK1, TIFR1 */
+#define TOIE1	0
+#define OCIE1A	1
+#define OCIE1B	2
+#define OCIE1C	3
+#define ICIE1	5
+#define TOV1	0
+#define OCF1A	1
+#define OCF1B	2
+#define OCF1C	3
+#define ICF1	5
+
+/* TCCR0A, TCCR0B */
+#define PSRSYNC	0		// GTCCR
+#define TSM		7
+
+#define WGM00	0
+#define WGM01	1
+#define COM0B0	4
+#define COM0B1	5
+#define COM0A0	6
+#define COM0A1	7
+#define CS00	0
+#define CS01	1
+#define CS02	2
+#define WGM02	3
+
+/* TCCR1A, TCCR1B */
+#define WGM10	0
+#define WGM11	1
+#define COM1C0	2
+#define COM1C1	3
+#define COM1B0	4
+#define COM1B1	5
+#define COM1A0	6
+#define COM1A1	7
+#define CS10	0
+#define CS11	1
+#define CS12	2
+#define WGM12	3
+#define WGM13	4
+#define ICES1	6
+#define ICNC1	7
+
+/* UCSR1A..C */
+#define TXC1	6
+#define UDRE1	5
+#define RXC1	7
+#define U2X1	1
+#define TXEN1	3
+#define RXEN1	4
+#define UCSZ10	1
+#define UCSZ11	2
+
+/* EIMSK, EIFR, EICRB */
+#define INT4	4
+#define INT7	7
+#define INTF4	4
+#define INTF7	7
+#define ISC40	0
+#define ISC41	1
+#define ISC70	6
+#define ISC71	7
+
+/* ACSR */
+#define ACD		7
+
+/* SMCR */
+#define SE		0
+#define SM0		1
+#define SM1		2
+#define SM2		3
+
+/* port pins */
+#define PINB0	0
+#define PINB7	7
+#define PINC7	7
+#define PIND0	0
+#define PORTB0	0
+#define PORTB4	4
+#define PORTB7	7
+#define PORTC2	2
+#define PORTC5	5
+#define PORTC6	6
+#define PORTC7	7
+#define PORTD0	0
+#define PORTD6	6
+
+#endif /* SIM_AVR_IO_H_ */
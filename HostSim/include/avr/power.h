@@ -0,0 +1,20 @@
+/* avr/power.h -- host simulator stand-in, the power reduction bits are kept in PRR0/PRR1 */
+#ifndef SIM_AVR_POWER_H_
+#define SIM_AVR_POWER_H_
+
+#include <avr/io.h>
+
+#define power_usb_disable()		(PRR1 |= 0x80)
+#define power_usb_enable()		(PRR1 &= ~0x80)
+#define power_usart1_disable()	(PRR1 |= 0x01)
+#define power_usart1_enable()	(PRR1 &= ~0x01)
+#define power_spi_disable()		(PRR0 |= 0x04)
+#define power_timer0_disable()	(PRR0 |= 0x20)
+#define power_timer0_enable()	(PRR0 &= ~0x20)
+#define power_timer1_disable()	(PRR0 |= 0x08)
+#define power_timer1_enable()	(PRR0 &= ~0x08)
+
+#define clock_div_1				0
+#define clock_prescale_set(x)	(CLKPR = (x))
+
+#endif /* SIM_AVR_POWER_H_ */
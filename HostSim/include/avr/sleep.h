@@ -0,0 +1,21 @@
+/*
+ * avr/sleep.h -- host simulator stand-in
+ *
+ * Sleeping lets the virtual time run on to the next event, as a main loop polling a pin does.
+ */
+#ifndef SIM_AVR_SLEEP_H_
+#define SIM_AVR_SLEEP_H_
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE			0
+#define SLEEP_MODE_PWR_DOWN		(1 << SM1)
+
+void sim_idle(void);
+
+#define set_sleep_mode(mode)	(SMCR = (SMCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode))
+#define sleep_enable()			(SMCR |= (1 << SE))
+#define sleep_disable()			(SMCR &= ~(1 << SE))
+#define sleep_cpu()				sim_idle()
+
+#endif /* SIM_AVR_SLEEP_H_ */
@@ -0,0 +1,8 @@
+/* avr/wdt.h -- host simulator stand-in, there is no watchdog */
+#ifndef SIM_AVR_WDT_H_
+#define SIM_AVR_WDT_H_
+
+#define wdt_disable()	do {} while (0)
+#define wdt_reset()		do {} while (0)
+
+#endif /* SIM_AVR_WDT_H_ */
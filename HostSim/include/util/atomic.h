@@ -0,0 +1,14 @@
+/* util/atomic.h -- host simulator stand-in */
+#ifndef SIM_UTIL_ATOMIC_H_
+#define SIM_UTIL_ATOMIC_H_
+
+#include <avr/io.h>
+
+#define ATOMIC_RESTORESTATE	0
+#define ATOMIC_FORCEON		1
+
+#define ATOMIC_BLOCK(type) \
+	for (uint8_t sim_sreg_save = SREG, sim_once = (SREG &= ~0x80, 1); sim_once; \
+		 SREG = (type) ? (SREG | 0x80) : sim_sreg_save, sim_once = 0)
+
+#endif /* SIM_UTIL_ATOMIC_H_ */
@@ -0,0 +1,10 @@
+/* util/delay.h -- host simulator stand-in, busy waits advance the virtual clock */
+#ifndef SIM_UTIL_DELAY_H_
+#define SIM_UTIL_DELAY_H_
+
+void sim_delay_us(double us);
+
+#define _delay_ms(ms)	sim_delay_us((ms) * 1000.0)
+#define _delay_us(us)	sim_delay_us(us)
+
+#endif /* SIM_UTIL_DELAY_H_ */
@@ -0,0 +1,289 @@
+/*
+ * ledsync_sim.c
+ *
+ * Created: 10/19/2026
+ *
+ * Runs several LED boards (Attiny_LEDS) on one sync line and reports how far their frames are apart over time.
+ *
+ * Every board has a Timer0 of its own from an RC oscillator that is off by a random amount, and starts at a random
+ * moment. Board 0 is the leader, it pulses the line when its TW_ticks turns over and marks the turn before its sequence
+ * starts with a longer pulse. The followers take the pulse after a random interrupt latency and run it through the
+ * loop filter of the firmware, Attiny_LEDS/frame_sync.c, which sets their OCR0A from tick to tick, and look for the
+ * mark. Every board starts its sequence at the turn Sync_StartTurn() says. Only Timer0 and the sync line are
+ * modelled, that is all the frames hang on: the sequence is stepped from the ticks since its start.
+ *
+ * The frame error of a follower is the time into its sequence, ticks since the start with the fraction of the tick
+ * running, minus the leader's, in us. It isn't taken modulo anything, a board that started on another turn is off by
+ * that many turns. Nothing is counted until both have started.
+ *
+ * Usage: ledsync_sim [options]
+ *	-n boards		boards on the line, the leader included, default 4
+ *	-T minutes		simulated time, default 10 minutes
+ *	-x percent		oscillator error, uniform within +-percent, default 2
+ *	-d ms			power up spread, the boards start within this, default 300
+ *	-l us			interrupt latency of a follower at most, default 10
+ *	-s seed			random seed, default 1
+ *	-f				free running, no sync, to see the boards drift apart
+ *	-t file			write the phase errors as a CSV file
+ *	-i seconds		interval of the CSV lines, default 1 second
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "../Attiny_LEDS/frame_sync.h"
+
+#define MAX_BOARDS		32
+#define F_NOMINAL		8e6
+#define T0_PRESCALE		64
+#define LOCK_US			100.0		// a follower is in step within this of the leader
+
+typedef struct board
+{
+	double f;					// oscillator, Hz
+	double start;				// power up, s
+	double t_tick;				// last compare match
+	double t_next;				// next compare match
+	double t_edge;				// sync pulse arrives, or HUGE_VAL
+	uint8_t ocr;
+	uint8_t ticks;				// TW_ticks
+	uint32_t total;				// ticks since power up
+	uint32_t start_total;		// total at the start of the sequence
+	double t_start;				// the sequence started, s, or HUGE_VAL
+	sync_pll_t pll;
+	double err_max, err_sum2;	// since in step
+	uint64_t err_n;
+	double unlocked;			// last time the error was above LOCK_US
+} board_t;
+
+static board_t boards[MAX_BOARDS];
+static int n_boards = 4;
+static bool free_run;
+static double latency = 10e-6;
+static bool line;				// the sync line, as the leader drives it
+
+static double
+uniform(double lo, double hi)
+{
+	return lo + (hi - lo) * rand() / ((double)RAND_MAX + 1);
+}
+
+// Timer0 counts at t, within the tick running
+static double
+counts(const board_t *b, double t)
+{
+	return (t - b->t_tick) * b->f / T0_PRESCALE;
+}
+
+// Time into the sequence at t, ticks since its start and the fraction of the tick running, in ticks
+static double
+frame(const board_t *b, double t)
+{
+	return (double)(b->total - b->start_total) + counts(b, t) / (b->ocr + 1);
+}
+
+// Frame error of board i against the leader at t in us, +ve == ahead, false while one hasn't started
+static bool
+error_us(int i, double t, double *e)
+{
+	if (t < boards[i].t_start || t < boards[0].t_start)
+		return false;
+	*e = (frame(&boards[i], t) - frame(&boards[0], t)) * 1000.0;		// a tick is 1ms
+	return true;
+}
+
+static void
+tick(int i)
+{
+	board_t *b = &boards[i];
+
+	b->t_tick = b->t_next;
+	b->ticks++;
+	b->total++;
+	Sync_Tick(&b->pll, b->ticks, line);
+	if (i == 0)
+	{
+		if (b->ticks == 0)			// the leader's pulse, its ISR sets the pin after the match
+		{
+			int j;
+
+			line = true;
+			for (j = 1; j < n_boards; j++)
+				if (boards[j].t_edge == HUGE_VAL && b->t_tick >= boards[j].start)
+					boards[j].t_edge = b->t_tick + uniform(0, latency);
+		}
+		else if (b->ticks == Sync_PulseTicks(&b->pll))
+			line = false;
+	}
+	else if (!free_run)
+		b->ocr = Sync_TickOcr(&b->pll);
+	b->t_next = b->t_tick + (b->ocr + 1) * (double)T0_PRESCALE / b->f;
+
+	if (b->ticks == 0 && Sync_StartTurn(&b->pll))		// the wheel timer at the turn, Sync_Turn()
+	{
+		b->start_total = b->total;
+		b->t_start = b->t_tick;
+	}
+}
+
+static void
+edge(int i)
+{
+	board_t *b = &boards[i];
+	double c = counts(b, b->t_edge);
+
+	if (!free_run)
+		Sync_Edge(&b->pll, b->pll.turns, b->ticks, (uint8_t)c, b->ocr);
+	b->t_edge = HUGE_VAL;
+}
+
+int
+main(int argc, char **argv)
+{
+	double minutes = 10, spread = 2, start_spread = 0.3, interval = 1;
+	const char *trace_file = NULL;
+	FILE *trace = NULL;
+	double t, end, next_report, e;
+	unsigned seed = 1;
+	int i, opt;
+
+	for (i = 1; i < argc; i++)
+	{
+		opt = argv[i][0] == '-' ? argv[i][1] : 0;
+		if (opt && opt != 'f' && i + 1 >= argc)
+			opt = 0;
+		switch (opt)
+		{
+			case 'n': n_boards = atoi(argv[++i]); break;
+			case 'T': minutes = atof(argv[++i]); break;
+			case 'x': spread = atof(argv[++i]); break;
+			case 'd': start_spread = atof(argv[++i]) / 1000; break;
+			case 'l': latency = atof(argv[++i]) / 1e6; break;
+			case 's': seed = atoi(argv[++i]); break;
+			case 'f': free_run = true; break;
+			case 't': trace_file = argv[++i]; break;
+			case 'i': interval = atof(argv[++i]); break;
+			default:
+				fprintf(stderr, "usage: %s [-n boards] [-T minutes] [-x percent] [-d ms] [-l us] [-s seed] [-f]"
+					" [-t trace.csv] [-i seconds]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (n_boards < 2 || n_boards > MAX_BOARDS || interval <= 0)
+	{
+		fprintf(stderr, "2 to %d boards\n", MAX_BOARDS);
+		return 1;
+	}
+
+	srand(seed);
+	for (i = 0; i < n_boards; i++)
+	{
+		board_t *b = &boards[i];
+
+		b->f = F_NOMINAL * (1 + uniform(-spread, spread) / 100);
+		b->start = uniform(0, start_spread);
+		b->t_tick = b->start;
+		b->ocr = SYNC_TICK_COUNTS - 1;
+		b->t_next = b->start + (b->ocr + 1) * (double)T0_PRESCALE / b->f;
+		b->t_edge = HUGE_VAL;
+		b->t_start = HUGE_VAL;
+	}
+	boards[0].pll.start_turn = SYNC_MARK_TURN + 1;		// Sync_Init() of the leader
+
+	if (trace_file && (trace = fopen(trace_file, "w")) == NULL)
+	{
+		perror(trace_file);
+		return 1;
+	}
+	if (trace)
+	{
+		fprintf(trace, "time");
+		for (i = 1; i < n_boards; i++)
+			fprintf(trace, ",board%d_us", i);
+		fprintf(trace, "\n");
+	}
+
+	end = minutes * 60;
+	next_report = interval;
+	for (;;)
+	{
+		// the next event of all boards, a compare match or a sync pulse arriving. A tick at the same time goes first
+		t = boards[0].t_next;
+		for (i = 0; i < n_boards; i++)
+		{
+			if (boards[i].t_next < t)
+				t = boards[i].t_next;
+			if (boards[i].t_edge < t)
+				t = boards[i].t_edge;
+		}
+
+		while (next_report <= t && next_report <= end)
+		{
+			if (trace)
+				fprintf(trace, "%.3f", next_report);
+			for (i = 1; i < n_boards; i++)
+			{
+				board_t *b = &boards[i];
+
+				if (!error_us(i, next_report, &e))
+				{
+					if (trace)
+						fprintf(trace, ",");
+					b->unlocked = next_report;
+					continue;
+				}
+				if (trace)
+					fprintf(trace, ",%.1f", e);
+				if (fabs(e) > LOCK_US)
+				{
+					b->unlocked = next_report;
+					b->err_max = b->err_sum2 = 0;
+					b->err_n = 0;
+				}
+				else
+				{
+					if (fabs(e) > b->err_max)
+						b->err_max = fabs(e);
+					b->err_sum2 += e * e;
+					b->err_n++;
+				}
+			}
+			if (trace)
+				fprintf(trace, "\n");
+			next_report += interval;
+		}
+		if (t > end)
+			break;
+
+		for (i = 0; i < n_boards; i++)
+		{
+			if (boards[i].t_next == t)
+				tick(i);
+			else if (boards[i].t_edge == t)
+				edge(i);
+		}
+	}
+
+	printf("LED boards: %d, %.1f minutes simulated, oscillators within +-%.1f%%, latency up to %.0fus%s\n\n",
+		n_boards, minutes, spread, latency * 1e6, free_run ? ", free running" : "");
+	printf("%-6s %10s %10s %12s %12s %10s %10s %14s\n", "board", "osc %", "start s", "in step at s", "max us",
+		"rms us", "trim", "frame error us");
+	printf("%-6s %+10.3f %10.3f %12s %12s %10s %10s %14s\n", "0", (boards[0].f / F_NOMINAL - 1) * 100,
+		boards[0].t_start, "leader", "", "", "", "");
+	for (i = 1; i < n_boards; i++)
+	{
+		board_t *b = &boards[i];
+		char locked[16] = "never", now[16] = "-";
+
+		if (b->err_n)
+			snprintf(locked, sizeof(locked), "%.0f", b->unlocked);
+		if (error_us(i, end, &e))
+			snprintf(now, sizeof(now), "%.1f", e);
+		printf("%-6d %+10.3f %10.3f %12s %12.1f %10.1f %10d %14s\n", i, (b->f / F_NOMINAL - 1) * 100, b->t_start,
+			locked, b->err_max, b->err_n ? sqrt(b->err_sum2 / b->err_n) : 0.0, b->pll.trim, now);
+	}
+
+	if (trace)
+		fclose(trace);
+	return 0;
+}
@@ -0,0 +1,731 @@
+/*
+ * sim_avr.c
+ *
+ * Created: 10/19/2026
+ *
+ * Virtual ATmega32U2 for running the firmware on a Linux box.
+ *
+ * The firmware is compiled against the stand-in headers in include/, its I/O registers are the byte array sim_io[] and
+ * its ISRs are plain functions. Time is counted in CPU cycles and advances event by event: Timer0 and Timer1 are
+ * modelled by the counter values at which something happens (compare matches, TOP, BOTTOM), so the simulator jumps
+ * from one event to the next instead of stepping every clock. That replays hours of clock time in seconds.
+ *
+ * When an interrupt flag is set and enabled it is taken as soon as the CPU is free, in vector priority order. Each ISR
+ * runs instantly on the host but occupies the virtual CPU for the number of cycles given in its vector entry, flags
+ * raised in the meantime wait. That gives the latency of every interrupt and the CPU load, the cycle counts are a
+ * model and have to come from the listing or a cycle counter.
+ *
+ * The main loop is idle from the simulator's point of view: reading an input port from the main loop, or a busy wait
+ * via _delay_ms(), is where virtual time passes.
+ *
+ * Modelled: Timer0 and Timer1 in normal, CTC and fast PWM modes with the OCnx pin outputs and the OCR double buffer,
+ * Timer1 input capture (through sim_capture()), EEPROM read and interrupt driven write with its 3.4ms write time.
+ *
+ * TIFR0/TIFR1 hand the firmware a copy of the flags with the unused bit 7 set. A write leaves that bit clear, which
+ * is how the simulator tells it from a read, and the bits written clear their flags as in the hardware.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include "sim_avr.h"
+
+volatile uint8_t sim_io[0x100];
+
+uint64_t sim_now;
+uint64_t sim_end = UINT64_MAX;
+double sim_hz = SIM_F_CPU;				// CPU cycles per real second, the crystal error included
+bool sim_in_isr;
+uint8_t sim_eeprom[SIM_EE_SIZE];
+uint32_t sim_ee_writes[SIM_EE_SIZE];	// erase/write cycles per byte
+uint64_t sim_isr_busy;					// total cycles in ISRs
+uint64_t sim_window_max;				// most ISR cycles seen in one load window
+
+static sim_target_t *tgt;
+static void process_events(uint64_t t);
+static uint64_t isr_extra;				// busy waits inside an ISR
+static sim_vector_t *isr_vector;		// the ISR running
+static uint64_t window_start, window_busy;
+
+static uint8_t flag_copy[2];			// TIFR0/TIFR1 as the firmware last got them, see flags_commit()
+
+static uint64_t ee_done = UINT64_MAX;	// EEPROM write in progress until then
+static uint16_t ee_addr;
+static uint8_t ee_data;
+
+#define ADDR_PIN(p)	(0x23 + 3*(p))
+#define ADDR_DDR(p)	(0x24 + 3*(p))
+#define ADDR_PORT(p) (0x25 + 3*(p))
+
+typedef struct timer
+{
+	uint8_t wide;
+	uint8_t tccra, tccrb, tcnt, tifr, nch;
+	uint8_t ocr[3];
+	uint8_t oc_port[3], oc_bit[3];		// output compare pins
+	uint16_t cnt;						// counter value reached at cycle tref
+	uint16_t synced;					// what the firmware last saw in TCNTn, to notice writes
+	uint64_t tref;
+	uint16_t presc;
+	uint16_t ocr_act[3];				// double buffered compare values in PWM modes
+	uint8_t oc_out[3];
+} sim_timer_t;
+
+static sim_timer_t timers[2] =
+{
+	// Timer0: OC0A = PB7, OC0B = PD0
+	{ 0, 0x44, 0x45, 0x46, 0x35, 2, {0x47, 0x48, 0}, {SIM_PORTB, SIM_PORTD, 0}, {7, 0, 0} },
+	// Timer1: OC1A = PC6, OC1B = PC5, OC1C = PB7
+	{ 1, 0x80, 0x81, 0x84, 0x36, 3, {0x88, 0x8A, 0x8C}, {SIM_PORTC, SIM_PORTC, SIM_PORTB}, {6, 5, 7} },
+};
+
+static const uint16_t prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+static uint16_t
+reg16(uint8_t addr)
+{
+	return sim_io[addr] | (sim_io[addr+1] << 8);
+}
+
+static uint16_t
+timer_reg(sim_timer_t *tm, uint8_t addr)
+{
+	return tm->wide ? reg16(addr) : sim_io[addr];
+}
+
+static void
+timer_reg_set(sim_timer_t *tm, uint8_t addr, uint16_t v)
+{
+	sim_io[addr] = v;
+	if (tm->wide)
+		sim_io[addr+1] = v >> 8;
+}
+
+// waveform generation mode: TOP, and whether it is a PWM mode
+static uint16_t
+timer_top(sim_timer_t *tm, bool *pwm)
+{
+	uint8_t wgm;
+
+	*pwm = false;
+	if (!tm->wide)
+	{
+		wgm = (sim_io[tm->tccra] & 3) | ((sim_io[tm->tccrb] >> 1) & 4);
+		switch (wgm)
+		{
+			case 2:	return sim_io[0x47];
+			case 3:	*pwm = true; return 0xff;
+			case 7:	*pwm = true; return sim_io[0x47];
+			default: return 0xff;
+		}
+	}
+	wgm = (sim_io[tm->tccra] & 3) | ((sim_io[tm->tccrb] >> 1) & 0xc);
+	switch (wgm)
+	{
+		case 4:	 return reg16(0x88);
+		case 5:	 *pwm = true; return 0x00ff;
+		case 6:	 *pwm = true; return 0x01ff;
+		case 7:	 *pwm = true; return 0x03ff;
+		case 12: return reg16(0x86);
+		case 14: *pwm = true; return reg16(0x86);
+		case 15: *pwm = true; return reg16(0x88);
+		default: return 0xffff;
+	}
+}
+
+static uint16_t
+timer_compare(sim_timer_t *tm, int ch, bool pwm)
+{
+	return pwm ? tm->ocr_act[ch] : timer_reg(tm, tm->ocr[ch]);
+}
+
+static uint8_t
+timer_com(sim_timer_t *tm, int ch)
+{
+	static const uint8_t shift[3] = { 6, 4, 2 };
+	return (sim_io[tm->tccra] >> shift[ch]) & 3;
+}
+
+// ticks from the current count to value v, counting 0..top
+static uint32_t
+timer_distance(sim_timer_t *tm, uint16_t v, uint16_t top)
+{
+	uint32_t d;
+
+	if (v > top)
+		return UINT32_MAX;
+	d = ((uint32_t)v + top + 1 - tm->cnt) % ((uint32_t)top + 1);
+	return d ? d : (uint32_t)top + 1;
+}
+
+// Ticks to the next counter step with an action. Like the hardware, compare matches and TOP take effect on the
+// timer clock that leaves the matching value, so the flag goes up together with the clear in CTC mode.
+static uint32_t
+timer_next(sim_timer_t *tm)
+{
+	bool pwm;
+	uint16_t top = timer_top(tm, &pwm);
+	uint32_t d = timer_distance(tm, 0, top);
+	uint32_t dv;
+	uint16_t cmp;
+	int ch;
+
+	for (ch = 0; ch < tm->nch; ch++)
+	{
+		cmp = timer_compare(tm, ch, pwm);
+		if (cmp < top && (dv = timer_distance(tm, cmp + 1, top)) < d)
+			d = dv;
+	}
+	return d;
+}
+
+// Count up to time t, but never across a value with an action, and pick up register writes done by the firmware
+static void
+timer_sync(sim_timer_t *tm, uint64_t t)
+{
+	uint16_t presc = (sim_io[0x43] & _BV(TSM)) ? 0 : prescalers[sim_io[tm->tccrb] & 7];	// GTCCR halts them all
+	uint16_t reg = timer_reg(tm, tm->tcnt);
+	uint64_t ticks, next;
+	bool pwm;
+	uint16_t top;
+
+	if (tm->presc && t > tm->tref)
+	{
+		top = timer_top(tm, &pwm);
+		ticks = (t - tm->tref) / tm->presc;
+		if (ticks && ticks >= (next = timer_next(tm)))
+			ticks = next - 1;
+		tm->cnt = (tm->cnt + ticks) % ((uint32_t)top + 1);
+		tm->tref += ticks * tm->presc;
+	}
+	if (reg != tm->synced)				// TCNTn was written
+	{
+		tm->cnt = reg;
+		tm->tref = t;
+	}
+	if (presc != tm->presc)
+	{
+		if (tm->presc == 0)
+			tm->tref = t;				// started
+		tm->presc = presc;
+	}
+	timer_reg_set(tm, tm->tcnt, tm->cnt);
+	tm->synced = tm->cnt;
+}
+
+// Writes of 1s to TIFR0/TIFR1 since the firmware last got them clear those flags
+static void
+flags_commit(void)
+{
+	int n;
+
+	for (n = 0; n < 2; n++)
+	{
+		if (!(flag_copy[n] & 0x80))
+			sim_io[timers[n].tifr] &= ~flag_copy[n];
+		flag_copy[n] = 0x80;
+	}
+}
+
+static uint64_t
+timer_event_time(sim_timer_t *tm)
+{
+	if (tm->presc == 0)
+		return UINT64_MAX;
+	return tm->tref + (uint64_t)timer_next(tm) * tm->presc;
+}
+
+static void
+oc_set(sim_timer_t *tm, int ch, uint8_t v)
+{
+	tm->oc_out[ch] = v;
+}
+
+// The counter reaches the next action value at time t
+static void
+timer_fire(int n, uint64_t t)
+{
+	sim_timer_t *tm = &timers[n];
+	bool pwm;
+	uint16_t top = timer_top(tm, &pwm);
+	uint32_t d = timer_next(tm);
+	uint16_t cmp, left;
+	uint8_t com;
+	int ch;
+
+	tm->cnt = (tm->cnt + d) % ((uint32_t)top + 1);
+	tm->tref = t;
+	left = tm->cnt ? tm->cnt - 1 : top;
+
+	for (ch = 0; ch < tm->nch; ch++)
+	{
+		cmp = timer_compare(tm, ch, pwm);
+		if (cmp != left)
+			continue;
+		sim_io[tm->tifr] |= _BV(ch + 1);
+		com = timer_com(tm, ch);
+		if (pwm && com >= 2 && cmp != top)
+			oc_set(tm, ch, com == 3);
+		else if (!pwm && com == 1)
+			oc_set(tm, ch, !tm->oc_out[ch]);
+	}
+	if (tm->cnt == 0)					// TOP -> BOTTOM
+	{
+		if (pwm)
+		{
+			sim_io[tm->tifr] |= _BV(0);	// TOV in fast PWM
+			for (ch = 0; ch < tm->nch; ch++)
+			{
+				tm->ocr_act[ch] = timer_reg(tm, tm->ocr[ch]);
+				com = timer_com(tm, ch);
+				if (com >= 2)
+					oc_set(tm, ch, com == 2);	// OCR == TOP keeps it there for the whole period
+			}
+		}
+		else if (top == (tm->wide ? 0xffff : 0xff))
+			sim_io[tm->tifr] |= _BV(0);	// overflow in normal mode
+		if (tgt->timer_top)
+			tgt->timer_top(n, t);
+	}
+	timer_reg_set(tm, tm->tcnt, tm->cnt);
+	tm->synced = tm->cnt;
+}
+
+uint16_t
+sim_timer_count(int timer)
+{
+	timer_sync(&timers[timer], sim_now);
+	return timers[timer].cnt;
+}
+
+// Input capture of Timer1 at time t
+void
+sim_capture(int timer, uint64_t t)
+{
+	sim_timer_t *tm = &timers[timer];
+
+	if (timer != 1)
+		return;
+	timer_sync(tm, t);
+	sim_io[0x86] = tm->cnt;
+	sim_io[0x87] = tm->cnt >> 8;
+	sim_io[0x36] |= _BV(ICF1);
+}
+
+// Output level of a port, the PORTx bits of output pins with the OCnx outputs in place where they are enabled
+uint8_t
+sim_port_out(int port)
+{
+	uint8_t v = sim_io[ADDR_PORT(port)];
+	sim_timer_t *tm;
+	int n, ch;
+
+	for (n = 0; n < 2; n++)
+	{
+		tm = &timers[n];
+		for (ch = 0; ch < tm->nch; ch++)
+		{
+			if (tm->oc_port[ch] != port || timer_com(tm, ch) == 0)
+				continue;
+			if (tm->oc_out[ch])
+				v |= _BV(tm->oc_bit[ch]);
+			else
+				v &= ~_BV(tm->oc_bit[ch]);
+		}
+	}
+	return v & sim_io[ADDR_DDR(port)];
+}
+
+
+/* EEPROM */
+
+static uint16_t
+ee_offset(const void *addr)
+{
+	extern uint8_t __start_sim_eeprom[] __attribute__((weak));
+
+	if ((uintptr_t)addr < SIM_EE_SIZE)
+		return (uintptr_t)addr;
+	return ((const uint8_t *)addr - __start_sim_eeprom) % SIM_EE_SIZE;	// an EEMEM variable
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr) { return sim_eeprom[ee_offset(addr)]; }
+
+void
+eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+	uint16_t a = ee_offset(addr);
+	sim_eeprom[a] = value;
+	sim_ee_writes[a]++;
+}
+
+void
+eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+	if (eeprom_read_byte(addr) != value)
+		eeprom_write_byte(addr, value);
+}
+
+void
+eeprom_read_block(void *dst, const void *addr, size_t n)
+{
+	uint16_t a = ee_offset(addr);
+	memcpy(dst, &sim_eeprom[a], n);
+}
+
+void
+eeprom_write_block(const void *src, void *addr, size_t n)
+{
+	uint16_t a = ee_offset(addr);
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		eeprom_write_byte((uint8_t *)(uintptr_t)(a + i), ((const uint8_t *)src)[i]);
+}
+
+void
+eeprom_update_block(const void *src, void *addr, size_t n)
+{
+	uint16_t a = ee_offset(addr);
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		eeprom_update_byte((uint8_t *)(uintptr_t)(a + i), ((const uint8_t *)src)[i]);
+}
+
+// A write started by the firmware through EECR
+static void
+ee_poll(void)
+{
+	if ((sim_io[0x3F] & _BV(EEPE)) && ee_done == UINT64_MAX)
+	{
+		ee_addr = reg16(0x41) % SIM_EE_SIZE;
+		ee_data = sim_io[0x40];
+		ee_done = sim_now + SIM_EE_WRITE;
+		sim_io[0x3F] &= ~_BV(EEMPE);
+	}
+}
+
+static void
+ee_finish(void)
+{
+	sim_eeprom[ee_addr] = ee_data;
+	sim_ee_writes[ee_addr]++;
+	sim_io[0x3F] &= ~_BV(EEPE);
+	ee_done = UINT64_MAX;
+}
+
+
+/* registers with side effects */
+
+volatile uint8_t *
+sim_reg_read(uint8_t addr)
+{
+	int p;
+
+	flags_commit();
+	switch (addr)
+	{
+		case 0x35: case 0x36:				// TIFRn, the firmware works on a copy
+			process_events(sim_now);
+			p = addr - 0x35;
+			flag_copy[p] = sim_io[addr] | 0x80;
+			return &flag_copy[p];
+
+		case 0x23: case 0x26: case 0x29:	// PINx
+			p = (addr - 0x23) / 3;
+			if (!sim_in_isr)
+				sim_idle();					// polling loop, the main loop has nothing else to do
+			else
+				process_events(sim_now);
+			sim_io[addr] = tgt->pins ? tgt->pins(p) : sim_io[ADDR_PORT(p)];
+			break;
+
+		case 0x46:
+			timer_sync(&timers[0], sim_now);
+			break;
+
+		case 0x84:
+			timer_sync(&timers[1], sim_now);
+			break;
+
+		case 0x40:							// EEDR
+			if (sim_io[0x3F] & _BV(EERE))
+			{
+				sim_io[0x40] = sim_eeprom[reg16(0x41) % SIM_EE_SIZE];
+				sim_io[0x3F] &= ~_BV(EERE);
+			}
+			break;
+	}
+	return &sim_io[addr];
+}
+
+
+/* event loop */
+
+static bool
+vector_pending(sim_vector_t *v)
+{
+	if (v->isr == NULL)
+		return false;
+	if (v->flag_reg == 0)
+		return v->level && v->level() && (!v->en_reg || (sim_io[v->en_reg] & _BV(v->en_bit)));
+	return (sim_io[v->flag_reg] & _BV(v->flag_bit)) && (sim_io[v->en_reg] & _BV(v->en_bit));
+}
+
+static void
+note_flags(uint64_t t)		// remember when flags went up, for the latency
+{
+	sim_vector_t *v;
+	int i;
+
+	for (i = 0; i < tgt->n_vectors; i++)
+	{
+		v = &tgt->vectors[i];
+		if (!vector_pending(v))
+			v->flag_time = UINT64_MAX;
+		else if (v->flag_time == UINT64_MAX)
+			v->flag_time = t;
+	}
+}
+
+static uint64_t
+next_event(void)
+{
+	uint64_t t = UINT64_MAX, e;
+	int n;
+
+	for (n = 0; n < 2; n++)
+		if ((e = timer_event_time(&timers[n])) < t)
+			t = e;
+	if (ee_done < t)
+		t = ee_done;
+	if (tgt->next_input && (e = tgt->next_input()) < t)
+		t = e;
+	return t;
+}
+
+// Hardware events up to and including time t
+static void
+process_events(uint64_t t)
+{
+	uint64_t e;
+	int n;
+
+	flags_commit();
+	for (;;)
+	{
+		for (n = 0; n < 2; n++)
+			timer_sync(&timers[n], t);
+
+		e = next_event();
+		if (e > t)
+			break;
+
+		for (n = 0; n < 2; n++)
+			if (timer_event_time(&timers[n]) == e)
+				timer_fire(n, e);
+		if (ee_done == e)
+			ee_finish();
+		if (tgt->next_input && tgt->next_input() == e)
+			tgt->input(e);
+		note_flags(e);
+		if (tgt->ports)
+			tgt->ports(e);
+	}
+}
+
+static void
+account(uint64_t start, uint64_t cycles)
+{
+	sim_isr_busy += cycles;
+	if (tgt->window)
+	{
+		if (start - window_start >= tgt->window)
+		{
+			if (window_busy > sim_window_max)
+				sim_window_max = window_busy;
+			window_start = start - (start - window_start) % tgt->window;
+			window_busy = 0;
+		}
+		window_busy += cycles;
+	}
+}
+
+// Take the highest priority pending interrupt, if any
+static bool
+dispatch(void)
+{
+	sim_vector_t *v;
+	uint64_t lat, cycles;
+	int i;
+
+	if ((sim_io[0x5F] & 0x80) == 0)
+		return false;
+
+	for (i = 0; i < tgt->n_vectors; i++)
+	{
+		v = &tgt->vectors[i];
+		if (!vector_pending(v))
+			continue;
+		if (v->flag_reg)
+			sim_io[v->flag_reg] &= ~_BV(v->flag_bit);	// cleared by the hardware when the vector is taken
+
+		lat = v->flag_time == UINT64_MAX ? 0 : sim_now - v->flag_time;
+		v->flag_time = UINT64_MAX;
+
+		sim_in_isr = true;
+		isr_extra = 0;
+		isr_vector = v;
+		sim_io[0x5F] &= ~0x80;
+		v->isr();
+		flags_commit();
+		sim_io[0x5F] |= 0x80;
+		sim_in_isr = false;
+
+		cycles = v->cycles + isr_extra;
+		v->count++;
+		v->busy += cycles;
+		v->lat_sum += lat;
+		if (lat > v->lat_max)
+			v->lat_max = lat;
+		account(sim_now, cycles);
+
+		sim_now += cycles;		// the ISR's port writes take effect when it is done
+		ee_poll();
+		if (tgt->ports)
+			tgt->ports(sim_now);
+		note_flags(sim_now);
+		return true;
+	}
+	return false;
+}
+
+// Main loop context: let time pass until t, running the interrupts that come due
+void
+sim_run_until(uint64_t t)
+{
+	uint64_t e;
+
+	ee_poll();
+	if (tgt->ports)
+		tgt->ports(sim_now);
+	note_flags(sim_now);
+
+	for (;;)
+	{
+		process_events(sim_now);
+		if (dispatch())
+			continue;
+
+		if (sim_now >= sim_end)
+		{
+			if (tgt->finish)
+				tgt->finish();
+			exit(0);
+		}
+
+		e = next_event();
+		if (e > t)
+		{
+			if (t > sim_now)
+				sim_now = t;
+			break;
+		}
+		sim_now = e;
+	}
+	process_events(sim_now);
+}
+
+// The main loop is waiting, skip ahead to whatever happens next. With the interrupts disabled the firmware is
+// still starting up or in a critical section, only a few cycles pass then.
+void
+sim_idle(void)
+{
+	uint64_t e;
+
+	process_events(sim_now);
+	if ((sim_io[0x5F] & 0x80) == 0)
+	{
+		sim_run_until(sim_now + 4);
+		return;
+	}
+	e = next_event();
+
+	if (e > sim_end)
+		e = sim_end;
+	if (e < sim_now)
+		e = sim_now;
+	sim_run_until(e);
+}
+
+void
+sim_delay_us(double us)
+{
+	uint64_t cycles = (uint64_t)(us * (SIM_F_CPU / 1000000.0));
+
+	if (sim_in_isr)
+		isr_extra += cycles;
+	else
+		sim_run_until(sim_now + cycles);
+}
+
+// Timestamp of the TRACE build (Common/trace.h) in timer ticks of prescale cycles. The ISR runs at once on the host,
+// its end is stamped where its modelled cycles end
+uint16_t
+sim_trace_clock(uint16_t prescale, bool end)
+{
+	uint64_t t = sim_now;
+
+	if (end && sim_in_isr)
+		t += isr_vector->cycles + isr_extra;
+	return (uint16_t)(t / prescale);
+}
+
+sim_vector_t *
+sim_vector(const char *name)
+{
+	int i;
+
+	for (i = 0; i < tgt->n_vectors; i++)
+		if (strcmp(tgt->vectors[i].name, name) == 0)
+			return &tgt->vectors[i];
+	return NULL;
+}
+
+void
+sim_init(sim_target_t *target)
+{
+	int i;
+
+	tgt = target;
+	flag_copy[0] = flag_copy[1] = 0x80;
+	memset(sim_eeprom, 0xff, sizeof(sim_eeprom));
+	for (i = 0; i < tgt->n_vectors; i++)
+		tgt->vectors[i].flag_time = UINT64_MAX;
+}
+
+void
+sim_report_isrs(void)
+{
+	sim_vector_t *v;
+	int i;
+
+	printf("%-20s %8s %12s %8s %12s %12s\n", "ISR", "cycles", "count", "load%", "lat max us", "lat avg us");
+	for (i = 0; i < tgt->n_vectors; i++)
+	{
+		v = &tgt->vectors[i];
+		if (!v->isr)
+			continue;
+		printf("%-20s %8" PRIu32 " %12" PRIu64 " %8.3f %12.2f %12.2f\n", v->name, v->cycles, v->count,
+			sim_now ? 100.0 * v->busy / sim_now : 0.0,
+			v->lat_max * 1e6 / SIM_F_CPU,
+			v->count ? v->lat_sum * 1e6 / SIM_F_CPU / v->count : 0.0);
+	}
+	printf("total ISR load %.3f%%", sim_now ? 100.0 * sim_isr_busy / sim_now : 0.0);
+	if (tgt->window)
+		printf(", worst window %" PRIu64 " of %" PRIu64 " cycles (%.2f%%)", sim_window_max, tgt->window,
+			100.0 * sim_window_max / tgt->window);
+	printf("\n");
+}
@@ -0,0 +1,73 @@
+/*
+ * sim_avr.h
+ *
+ * Created: 10/19/2026
+ *
+ * Virtual ATmega32U2 for running the firmware on a Linux box. See sim_avr.c
+ */
+
+#ifndef SIM_AVR_H_
+#define SIM_AVR_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define SIM_F_CPU		16000000UL
+#define SIM_EE_SIZE		1024
+#define SIM_EE_WRITE	54400UL		// 3.4ms erase and write at 16Mhz
+
+#define SIM_PORTB		0
+#define SIM_PORTC		1
+#define SIM_PORTD		2
+#define SIM_NPORTS		3
+
+typedef struct sim_vector
+{
+	const char *name;
+	void (*isr)(void);				// NULL when the firmware does not use the vector
+	uint32_t cycles;				// modelled execution time including entry and exit
+	uint8_t flag_reg, flag_bit;		// interrupt flag, flag_reg == 0 for level triggered sources
+	uint8_t en_reg, en_bit;			// interrupt enable
+	bool (*level)(void);			// pending condition of a level triggered source
+
+	// statistics
+	uint64_t flag_time;				// when the flag got set
+	uint64_t count;
+	uint64_t busy;					// cycles spent in the ISR
+	uint64_t lat_max, lat_sum;		// flag to ISR start
+} sim_vector_t;
+
+typedef struct sim_target
+{
+	sim_vector_t *vectors;			// in hardware priority order
+	int n_vectors;
+	uint64_t window;				// cycles per load window, e.g. one PWM period
+
+	uint8_t (*pins)(int port);				// level on the input pins
+	uint64_t (*next_input)(void);			// time of the next external input event, UINT64_MAX for none
+	void (*input)(uint64_t t);				// handle the external input event due at t
+	void (*ports)(uint64_t t);				// outputs may have changed at t
+	void (*timer_top)(int timer, uint64_t t);	// timer reached TOP (PWM period boundary)
+	void (*finish)(void);					// end of the simulation, print the report
+} sim_target_t;
+
+extern uint64_t sim_now;			// virtual time in CPU cycles
+extern uint64_t sim_end;
+extern double sim_hz;
+extern bool sim_in_isr;
+extern uint8_t sim_eeprom[SIM_EE_SIZE];
+extern uint32_t sim_ee_writes[SIM_EE_SIZE];
+extern uint64_t sim_isr_busy;
+extern uint64_t sim_window_max;
+
+void sim_init(sim_target_t *target);
+void sim_run_until(uint64_t t);
+void sim_idle(void);
+void sim_capture(int timer, uint64_t t);
+uint8_t sim_port_out(int port);
+uint16_t sim_timer_count(int timer);
+uint16_t sim_trace_clock(uint16_t prescale, bool end);
+sim_vector_t *sim_vector(const char *name);
+void sim_report_isrs(void);
+
+#endif /* SIM_AVR_H_ */
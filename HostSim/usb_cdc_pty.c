@@ -0,0 +1,97 @@
+/*
+ * usb_cdc_pty.c
+ *
+ * Created: 10/19/2026
+ *
+ * Stand-in for DotClock's usb_cdc.c in the host simulator. The USB serial port becomes a pseudo terminal, host tools
+ * open the /dev/pts/N printed at start up as they would open the clock's /dev/ttyACMn. The port counts as connected
+ * while the other side has it open, like DTR on the real one.
+ *
+ * Virtual time is held back to the wall clock from CDC_Init() on, so a host sees the clock tick in real time and
+ * time sync and telemetry behave as on the bench. Build with -DUSB_CDC and link this file instead of usb_cdc.c.
+ */
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim_avr.h"
+#include "usb_cdc.h"
+
+static int pty = -1;
+static struct timespec wall_start;
+static uint64_t sim_start;
+
+
+void
+CDC_Init(void)
+{
+	struct termios tio;
+
+	pty = posix_openpt(O_RDWR | O_NOCTTY);
+	if (pty < 0 || grantpt(pty) || unlockpt(pty))
+	{
+		perror("pty");
+		exit(1);
+	}
+	tcgetattr(pty, &tio);
+	cfmakeraw(&tio);					// binary packets, no line discipline
+	tcsetattr(pty, TCSANOW, &tio);
+	fcntl(pty, F_SETFL, O_NONBLOCK);
+	fprintf(stderr, "USB serial port: %s\n", ptsname(pty));
+
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+	sim_start = sim_now;
+}
+
+
+// Sleeps while the virtual time is ahead of the wall clock. The main loop polls it, virtual time passes here as it
+// does at a pin read
+void
+CDC_Task(void)
+{
+	struct timespec now, d;
+	double ahead;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ahead = (sim_now - sim_start) / sim_hz
+		- ((now.tv_sec - wall_start.tv_sec) + (now.tv_nsec - wall_start.tv_nsec) / 1e9);
+	if (ahead > 0.001)
+	{
+		d.tv_sec = (time_t)ahead;
+		d.tv_nsec = (long)((ahead - d.tv_sec) * 1e9);
+		nanosleep(&d, NULL);
+	}
+	sim_idle();
+}
+
+
+bool
+CDC_Connected(void)
+{
+	struct pollfd p = { pty, POLLOUT, 0 };
+
+	return pty >= 0 && poll(&p, 1, 0) >= 0 && !(p.revents & POLLHUP);
+}
+
+
+uint8_t
+CDC_Read(uint8_t *buf, uint8_t max)
+{
+	ssize_t n = read(pty, buf, max);
+
+	return n > 0 ? n : 0;		// EIO while nobody has the port open
+}
+
+
+bool
+CDC_Write(const uint8_t *buf, uint8_t len)
+{
+	if (!CDC_Connected())
+		return false;
+	return write(pty, buf, len) == len;
+}
@@ -0,0 +1,1188 @@
+/*
+ * avrcycles.c
+ *
+ * Created: 10/19/2026
+ *
+ * Counts the clock cycles of the firmware's functions and interrupt handlers on a Linux box. Loads the ELF file
+ * avr-gcc (Atmel Studio) built for one of the boards, sets up the RAM as the start-up code would and runs the code on
+ * an interpreter of the AVR instruction set, counting cycles as the instruction set summary of the datasheets does.
+ * An interrupt handler is entered through its vector with the 4 cycles of the interrupt response, its count is the
+ * time from the interrupt to the end of RETI.
+ *
+ * The I/O registers are plain memory, the code reads what it wrote. A polling loop needs a register read fixed to a
+ * value (@addr=value). The USI of the ATtiny4313 counts and shifts like the real one, so SPI_Xfer runs unchanged.
+ *
+ * Usage: avrcycles [-m device] [-f MHz] [-l cycles] file.elf name [setting ...]
+ *        avrcycles [-f MHz] [-l cycles] -b bench.txt
+ *	-m device		tiny4313, 32u2 or 32u4, by default from the architecture in the ELF file
+ *	-f MHz			clock for the microseconds column, default 16, 8 for the tiny4313
+ *	-l cycles		a run taking longer is stopped, it most likely spins on a register, default 10000000
+ *	-b bench.txt	runs the list in the file, see Tools/avrcycles/bench.txt
+ *	name			a function, or an interrupt as TIMER0_COMPA_vect or __vector_19
+ *	setting			before the first run, in order:
+ *		aN=value		argument N (0..3) of the function, 16 bits in r25:r24, r23:r22, ...
+ *		rN=value		register N
+ *		@addr=value		reads of the I/O register at data address addr always give value
+ *		symbol=v[,v..]	bytes of a variable from its first one on, symbol+offset=... from further in. A single value
+ *						fills a 2 or 4 byte variable whole
+ *		symbol*n=value	n bytes of the variable, from its start, all set to value
+ *		xN				run it N times in a row, the RAM is kept from one run to the next, the registers not
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EM_AVR			83
+#define SHT_SYMTAB		2
+#define SHT_NOBITS		8
+#define SHF_ALLOC		2
+#define STT_FUNC		2
+#define DATA_OFFSET		0x800000UL	// data addresses in the ELF file, 0x810000 on is the EEPROM
+
+#define FLASH_MAX		0x10000UL	// bytes, the PC has 16 bits on all three
+#define MAX_SYMBOLS		4096
+#define MAX_SETTINGS	64
+#define RET_SENTINEL	0xffff		// return address of the code run, no instruction there
+
+// data addresses of the core registers, the same on all three
+#define SPL				0x5d
+#define SPH				0x5e
+#define SREG			0x5f
+
+// SREG bits
+#define F_C				0x01
+#define F_Z				0x02
+#define F_N				0x04
+#define F_V				0x08
+#define F_S				0x10
+#define F_H				0x20
+#define F_T				0x40
+#define F_I				0x80
+
+// ATtiny4313 USI, data addresses
+#define USICR			0x2d
+#define USISR			0x2e
+#define USIDR			0x2f
+
+typedef struct device
+{
+	const char *name;
+	uint8_t arch;				// avr-gcc architecture, in e_flags of the ELF header
+	uint16_t sram;				// first SRAM address, the I/O registers are below
+	uint16_t ramend;
+	uint8_t vector_size;		// bytes
+	bool usi;
+	bool mul;					// has the multiplier, not the avr25 core of the ATtiny
+	double mhz;					// the board's clock
+	const char *const *vectors;	// names by vector number, without _vect
+	int n_vectors;
+} device_t;
+
+static const char *const vectors_tiny4313[] =
+{
+	"RESET", "INT0", "INT1", "TIMER1_CAPT", "TIMER1_COMPA", "TIMER1_OVF", "TIMER0_OVF", "USART0_RX", "USART0_UDRE",
+	"USART0_TX", "ANA_COMP", "PCINT_B", "TIMER1_COMPB", "TIMER0_COMPA", "TIMER0_COMPB", "USI_START", "USI_OVERFLOW",
+	"EE_READY", "WDT_OVERFLOW", "PCINT_A", "PCINT_D"
+};
+
+static const char *const vectors_32u2[] =
+{
+	"RESET", "INT0", "INT1", "INT2", "INT3", "INT4", "INT5", "INT6", "INT7", "PCINT0", "PCINT1", "USB_GEN", "USB_COM",
+	"WDT", "TIMER1_CAPT", "TIMER1_COMPA", "TIMER1_COMPB", "TIMER1_COMPC", "TIMER1_OVF", "TIMER0_COMPA",
+	"TIMER0_COMPB", "TIMER0_OVF", "SPI_STC", "USART1_RX", "USART1_UDRE", "USART1_TX", "ANALOG_COMP", "EE_READY",
+	"SPM_READY"
+};
+
+static const char *const vectors_32u4[] =
+{
+	"RESET", "INT0", "INT1", "INT2", "INT3", "", "", "INT6", "", "PCINT0", "USB_GEN", "USB_COM", "WDT", "", "", "",
+	"TIMER1_CAPT", "TIMER1_COMPA", "TIMER1_COMPB", "TIMER1_COMPC", "TIMER1_OVF", "TIMER0_COMPA", "TIMER0_COMPB",
+	"TIMER0_OVF", "SPI_STC", "USART1_RX", "USART1_UDRE", "USART1_TX", "ANALOG_COMP", "EE_READY", "TIMER3_CAPT",
+	"TIMER3_COMPA", "TIMER3_COMPB", "TIMER3_COMPC", "TIMER3_OVF", "TWI", "SPM_READY", "TIMER4_COMPA",
+	"TIMER4_COMPB", "TIMER4_COMPD", "TIMER4_OVF", "TIMER4_FPF"
+};
+
+#define N_OF(a)	(int)(sizeof(a) / sizeof((a)[0]))
+
+static const device_t devices[] =
+{
+	{ "tiny4313", 25, 0x060, 0x15f, 2, true, false, 8, vectors_tiny4313, N_OF(vectors_tiny4313) },
+	{ "32u2", 35, 0x100, 0x4ff, 4, false, true, 16, vectors_32u2, N_OF(vectors_32u2) },
+	{ "32u4", 5, 0x100, 0xaff, 4, false, true, 16, vectors_32u4, N_OF(vectors_32u4) },
+};
+
+typedef struct symbol
+{
+	char *name;
+	uint32_t value;
+	uint32_t size;
+	bool func;
+} symbol_t;
+
+typedef struct result
+{
+	uint32_t cycles;
+	uint32_t instructions;
+	uint16_t stack;				// bytes, return address included
+	bool ok;
+} result_t;
+
+static const device_t *dev;
+static uint8_t flash[FLASH_MAX];
+static uint8_t data[0x10000];		// r0..r31, I/O, SRAM
+static uint8_t data_init[0x10000];	// as the start-up code leaves it
+static symbol_t symbols[MAX_SYMBOLS];
+static int n_symbols;
+static int16_t io_fixed[0x100];		// -1: reads give what was written
+static double mhz;
+static uint32_t cycle_limit = 10000000;
+static char elf_name[256];
+
+static uint16_t pc;					// in words
+static uint32_t cycles;
+static uint16_t sp_min;
+
+
+/*
+ * ELF file
+ */
+
+static uint32_t
+get32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+
+static uint16_t
+get16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+
+// Flash, initial RAM and the symbols of a 32 bit little endian AVR ELF file
+static bool
+load_elf(const char *name, const char *device)
+{
+	FILE *f = fopen(name, "rb");
+	uint8_t *img;
+	long len;
+	uint32_t shoff, i, j;
+	uint16_t shentsize, shnum;
+	int d;
+
+	if (!f)
+	{
+		perror(name);
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	img = malloc(len);
+	if (!img || fread(img, 1, len, f) != (size_t)len)
+	{
+		fprintf(stderr, "%s: can't read\n", name);
+		fclose(f);
+		free(img);
+		return false;
+	}
+	fclose(f);
+	if (len < 52 || memcmp(img, "\177ELF", 4) || img[4] != 1 || img[5] != 1 || get16(img + 18) != EM_AVR)
+	{
+		fprintf(stderr, "%s: not a 32 bit AVR ELF file\n", name);
+		free(img);
+		return false;
+	}
+
+	dev = NULL;
+	for (d = 0; d < N_OF(devices); d++)
+		if (device ? !strcmp(device, devices[d].name) : (get32(img + 36) & 0x7f) == devices[d].arch)
+			dev = &devices[d];
+	if (!dev)
+	{
+		fprintf(stderr, "%s: unknown device, use -m\n", name);
+		free(img);
+		return false;
+	}
+
+	memset(flash, 0xff, sizeof(flash));
+	memset(data_init, 0, sizeof(data_init));
+	for (i = 0; i < (uint32_t)n_symbols; i++)
+		free(symbols[i].name);
+	n_symbols = 0;
+
+	shoff = get32(img + 32);
+	shentsize = get16(img + 46);
+	shnum = get16(img + 48);
+	for (i = 0; i < shnum && shoff + (i + 1) * shentsize <= (uint32_t)len; i++)
+	{
+		const uint8_t *sh = img + shoff + i * shentsize;
+		uint32_t type = get32(sh + 4), flags = get32(sh + 8), addr = get32(sh + 12);
+		uint32_t off = get32(sh + 16), size = get32(sh + 20);
+
+		if (type != SHT_NOBITS && off + size > (uint32_t)len)
+			continue;
+		if ((flags & SHF_ALLOC) && type != SHT_NOBITS)
+		{
+			if (addr < FLASH_MAX && addr + size <= FLASH_MAX)			// .text, .progmem and such
+				memcpy(flash + addr, img + off, size);
+			else if (addr >= DATA_OFFSET && addr + size <= DATA_OFFSET + 0x10000)	// .data, .bss is 0 already
+				memcpy(data_init + addr - DATA_OFFSET, img + off, size);
+		}
+		else if (type == SHT_SYMTAB)
+		{
+			const uint8_t *strsh = img + shoff + get32(sh + 24) * shentsize;	// sh_link
+			const char *str = (const char *)img + get32(strsh + 16);
+
+			for (j = 1; j < size / 16 && n_symbols < MAX_SYMBOLS; j++)
+			{
+				const uint8_t *st = img + off + j * 16;
+				const char *s = str + get32(st);
+
+				if (!*s || get16(st + 14) == 0)		// no name, undefined
+					continue;
+				symbols[n_symbols].name = strdup(s);
+				symbols[n_symbols].value = get32(st + 4);
+				symbols[n_symbols].size = get32(st + 8);
+				symbols[n_symbols].func = (st[12] & 0x0f) == STT_FUNC;
+				n_symbols++;
+			}
+		}
+	}
+	free(img);
+	snprintf(elf_name, sizeof(elf_name), "%s", name);
+	return true;
+}
+
+
+static symbol_t *
+find_symbol(const char *name)
+{
+	int i;
+
+	for (i = 0; i < n_symbols; i++)
+		if (!strcmp(symbols[i].name, name))
+			return &symbols[i];
+	return NULL;
+}
+
+
+// Interrupt number of TIMER0_COMPA_vect or __vector_19, -1 if it isn't one
+static int
+vector_number(const char *name)
+{
+	size_t n = strlen(name);
+	int i;
+
+	if (!strncmp(name, "__vector_", 9))
+		return atoi(name + 9);
+	if (n > 5 && !strcmp(name + n - 5, "_vect"))
+		for (i = 1; i < dev->n_vectors; i++)
+			if (strlen(dev->vectors[i]) == n - 5 && !strncmp(name, dev->vectors[i], n - 5))
+				return i;
+	return -1;
+}
+
+
+/*
+ * Data space
+ */
+
+static uint8_t
+read_data(uint16_t a)
+{
+	if (a < 0x100 && io_fixed[a] >= 0)
+		return io_fixed[a];
+	return data[a];
+}
+
+
+// Writing USITC with USICS1 and USICLK set clocks the 4 bit counter, the data shifts on every other count
+static void
+usi_strobe(void)
+{
+	uint8_t cnt = (data[USISR] + 1) & 0x0f;
+
+	if (cnt & 1)
+		data[USIDR] <<= 1;
+	if (cnt == 0)
+		data[USISR] |= 0x40;		// USIOIF
+	data[USISR] = (data[USISR] & 0xf0) | cnt;
+}
+
+
+static void
+write_data(uint16_t a, uint8_t v)
+{
+	if (dev->usi && a == USISR)
+	{
+		data[a] = ((data[a] & ~v) & 0xe0) | (v & 0x0f);	// flags clear by writing a 1, the counter is written
+		return;
+	}
+	data[a] = v;
+	if (dev->usi && a == USICR && (v & 0x0b) == 0x0b)	// USICS1, USICLK, USITC
+		usi_strobe();
+}
+
+
+static uint16_t
+get_sp(void)
+{
+	return data[SPL] | data[SPH] << 8;
+}
+
+
+static void
+set_sp(uint16_t sp)
+{
+	data[SPL] = sp;
+	data[SPH] = sp >> 8;
+	if (sp < sp_min)
+		sp_min = sp;
+}
+
+
+static void
+push(uint8_t v)
+{
+	uint16_t sp = get_sp();
+
+	data[sp] = v;
+	set_sp(sp - 1);
+}
+
+
+static uint8_t
+pop(void)
+{
+	uint16_t sp = get_sp() + 1;
+
+	set_sp(sp);
+	return data[sp];
+}
+
+
+// Return addresses go high byte first on the stack, they are popped low byte first
+static void
+push_pc(uint16_t a)
+{
+	push(a);
+	push(a >> 8);
+}
+
+
+static uint16_t
+pop_pc(void)
+{
+	uint16_t a = pop() << 8;
+
+	return a | pop();
+}
+
+
+/*
+ * Instructions
+ */
+
+static uint16_t
+fetch(uint16_t w)
+{
+	return flash[(uint32_t)w * 2 % FLASH_MAX] | flash[((uint32_t)w * 2 + 1) % FLASH_MAX] << 8;
+}
+
+
+// LDS, STS, JMP and CALL take two words
+static bool
+is_two_words(uint16_t op)
+{
+	return (op & 0xfc0f) == 0x9000 || (op & 0xfe0c) == 0x940c;
+}
+
+
+static void
+set_flags(uint8_t mask, uint8_t flags)
+{
+	data[SREG] = (data[SREG] & ~mask) | (flags & mask);
+}
+
+
+// N, Z and S from a result, V as given
+static uint8_t
+nzs(uint8_t r, uint8_t v)
+{
+	uint8_t f = v;
+
+	if (r & 0x80)
+		f |= F_N;
+	if (r == 0)
+		f |= F_Z;
+	if (!(f & F_N) != !(f & F_V))
+		f |= F_S;
+	return f;
+}
+
+
+static uint8_t
+add(uint8_t d, uint8_t s, uint8_t c)
+{
+	uint8_t r = d + s + c, f = 0;
+
+	if (d + s + c > 0xff)
+		f |= F_C;
+	if ((d & 0x0f) + (s & 0x0f) + c > 0x0f)
+		f |= F_H;
+	if (~(d ^ s) & (d ^ r) & 0x80)
+		f |= F_V;
+	set_flags(F_C | F_Z | F_N | F_V | F_S | F_H, nzs(r, f));
+	return r;
+}
+
+
+// keep_z for SBC, SBCI and CPC, Z only stays set if the result is 0
+static uint8_t
+sub(uint8_t d, uint8_t s, uint8_t c, bool keep_z)
+{
+	uint8_t r = d - s - c, f = 0, z = data[SREG] & F_Z;
+
+	if (d < s + c)
+		f |= F_C;
+	if ((d & 0x0f) < (s & 0x0f) + c)
+		f |= F_H;
+	if ((d ^ s) & (d ^ r) & 0x80)
+		f |= F_V;
+	f = nzs(r, f);
+	if (keep_z && !z)
+		f &= ~F_Z;
+	set_flags(F_C | F_Z | F_N | F_V | F_S | F_H, f);
+	return r;
+}
+
+
+static uint8_t
+logic(uint8_t r)
+{
+	set_flags(F_Z | F_N | F_V | F_S, nzs(r, 0));
+	return r;
+}
+
+
+// Shifts right, c the bit shifted out
+static uint8_t
+shift_right(uint8_t r, uint8_t c)
+{
+	set_flags(F_C | F_Z | F_N | F_V | F_S, nzs(r, (r & 0x80) ? (c ? 0 : F_V) : (c ? F_V : 0)) | (c ? F_C : 0));
+	return r;
+}
+
+
+static void
+mul(uint16_t r, bool carry)
+{
+	data[0] = r;
+	data[1] = r >> 8;
+	set_flags(F_C | F_Z, (carry ? F_C : 0) | (r == 0 ? F_Z : 0));
+}
+
+
+// Runs one instruction, false for one the interpreter doesn't know
+static bool
+step(void)
+{
+	uint16_t op = fetch(pc), k;
+	uint8_t d = (op >> 4) & 0x1f, r = (op & 0x0f) | ((op >> 5) & 0x10);
+	uint8_t *R = data, rd = R[d], rr = R[r], c = data[SREG] & F_C, v;
+	uint16_t a, w;
+	int16_t rel;
+
+	pc++;
+	cycles++;
+	switch (op >> 12)
+	{
+		case 0x0:
+			switch ((op >> 10) & 3)
+			{
+				case 0:
+					if (op == 0)								// NOP
+						break;
+					if ((op & 0xff00) == 0x0100)				// MOVW
+					{
+						d = (op >> 3) & 0x1e;
+						r = (op << 1) & 0x1e;
+						R[d] = R[r];
+						R[d + 1] = R[r + 1];
+						break;
+					}
+					if (!dev->mul)
+						return false;
+					cycles++;
+					if ((op & 0xff00) == 0x0200)				// MULS
+					{
+						w = (int8_t)R[16 + ((op >> 4) & 15)] * (int8_t)R[16 + (op & 15)];
+						mul(w, w & 0x8000);
+						break;
+					}
+					d = 16 + ((op >> 4) & 7);
+					r = 16 + (op & 7);
+					switch (op & 0x88)
+					{
+						case 0x00:								// MULSU
+							w = (int8_t)R[d] * R[r];
+							mul(w, w & 0x8000);
+							break;
+						case 0x08:								// FMUL
+							w = R[d] * R[r];
+							mul(w << 1, w & 0x8000);
+							break;
+						case 0x80:								// FMULS
+							w = (int8_t)R[d] * (int8_t)R[r];
+							mul(w << 1, w & 0x8000);
+							break;
+						default:								// FMULSU
+							w = (int8_t)R[d] * R[r];
+							mul(w << 1, w & 0x8000);
+							break;
+					}
+					break;
+				case 1:											// CPC
+					sub(rd, rr, c, true);
+					break;
+				case 2:											// SBC
+					R[d] = sub(rd, rr, c, true);
+					break;
+				default:										// ADD
+					R[d] = add(rd, rr, 0);
+					break;
+			}
+			break;
+
+		case 0x1:
+			switch ((op >> 10) & 3)
+			{
+				case 0:											// CPSE
+					if (rd == rr)
+					{
+						k = is_two_words(fetch(pc)) ? 2 : 1;
+						pc += k;
+						cycles += k;
+					}
+					break;
+				case 1:											// CP
+					sub(rd, rr, 0, false);
+					break;
+				case 2:											// SUB
+					R[d] = sub(rd, rr, 0, false);
+					break;
+				default:										// ADC
+					R[d] = add(rd, rr, c);
+					break;
+			}
+			break;
+
+		case 0x2:
+			switch ((op >> 10) & 3)
+			{
+				case 0:											// AND
+					R[d] = logic(rd & rr);
+					break;
+				case 1:											// EOR
+					R[d] = logic(rd ^ rr);
+					break;
+				case 2:											// OR
+					R[d] = logic(rd | rr);
+					break;
+				default:										// MOV
+					R[d] = rr;
+					break;
+			}
+			break;
+
+		case 0x3: case 0x4: case 0x5: case 0x6: case 0x7: case 0xe:
+			d = 16 + ((op >> 4) & 15);
+			v = ((op >> 4) & 0xf0) | (op & 0x0f);
+			rd = R[d];
+			switch (op >> 12)
+			{
+				case 0x3:										// CPI
+					sub(rd, v, 0, false);
+					break;
+				case 0x4:										// SBCI
+					R[d] = sub(rd, v, c, true);
+					break;
+				case 0x5:										// SUBI
+					R[d] = sub(rd, v, 0, false);
+					break;
+				case 0x6:										// ORI
+					R[d] = logic(rd | v);
+					break;
+				case 0x7:										// ANDI
+					R[d] = logic(rd & v);
+					break;
+				default:										// LDI
+					R[d] = v;
+					break;
+			}
+			break;
+
+		case 0x8: case 0xa:										// LDD, STD with Y or Z + q
+			a = (op & 0x08) ? (R[28] | R[29] << 8) : (R[30] | R[31] << 8);
+			a += (op & 7) | ((op >> 7) & 0x18) | ((op >> 8) & 0x20);
+			cycles++;
+			if (op & 0x0200)
+				write_data(a, rd);
+			else
+				R[d] = read_data(a);
+			break;
+
+		case 0x9:
+			if ((op & 0xfc00) == 0x9000)						// loads and stores, PUSH, POP, LPM
+			{
+				bool store = op & 0x0200;
+				uint8_t p = 26, mode = op & 15;
+
+				cycles++;
+				switch (mode)
+				{
+					case 0x0:									// LDS, STS
+						a = fetch(pc++);
+						if (store)
+							write_data(a, rd);
+						else
+							R[d] = read_data(a);
+						return true;
+					case 0x4: case 0x5: case 0x6: case 0x7:		// LPM, ELPM Rd, Z(+), RAMPZ is always 0 here
+						if (store)
+							return false;
+						a = R[30] | R[31] << 8;
+						R[d] = flash[a];
+						cycles++;
+						if (mode & 1)
+						{
+							a++;
+							R[30] = a;
+							R[31] = a >> 8;
+						}
+						return true;
+					case 0xf:									// PUSH, POP
+						if (store)
+							push(rd);
+						else
+							R[d] = pop();
+						return true;
+					case 0x1: case 0x2:
+						p = 30;
+						break;
+					case 0x9: case 0xa:
+						p = 28;
+						break;
+					case 0xc: case 0xd: case 0xe:
+						break;
+					default:
+						return false;
+				}
+				a = R[p] | R[p + 1] << 8;
+				if ((mode & 3) == 2)							// -X, -Y, -Z
+				{
+					a--;
+					if (!store)
+						cycles++;								// LD with pre-decrement takes 3
+				}
+				if (store)
+					write_data(a, rd);
+				else
+					R[d] = read_data(a);
+				if ((mode & 3) == 1)							// X+, Y+, Z+
+					a++;
+				if ((mode & 3) != 0)
+				{
+					R[p] = a;
+					R[p + 1] = a >> 8;
+				}
+				return true;
+			}
+			if ((op & 0xfe0c) == 0x940c)						// JMP, CALL
+			{
+				k = fetch(pc++);
+				cycles += 2;
+				if (op & 2)
+				{
+					push_pc(pc);
+					cycles++;
+				}
+				pc = k;
+				return true;
+			}
+			if ((op & 0xfe08) == 0x9400 && (op & 0x0f) != 4)	// one operand
+			{
+				switch (op & 0x0f)
+				{
+					case 0x0:									// COM
+						R[d] = ~rd;
+						set_flags(F_C | F_Z | F_N | F_V | F_S, nzs(R[d], 0) | F_C);
+						break;
+					case 0x1:									// NEG
+						v = -rd;
+						R[d] = v;
+						set_flags(F_C | F_Z | F_N | F_V | F_S | F_H,
+							nzs(v, v == 0x80 ? F_V : 0) | (v ? F_C : 0) | ((rd | v) & 0x08 ? F_H : 0));
+						break;
+					case 0x2:									// SWAP
+						R[d] = (rd << 4) | (rd >> 4);
+						break;
+					case 0x3:									// INC
+						R[d] = rd + 1;
+						set_flags(F_Z | F_N | F_V | F_S, nzs(R[d], R[d] == 0x80 ? F_V : 0));
+						break;
+					case 0x5:									// ASR
+						R[d] = shift_right((rd >> 1) | (rd & 0x80), rd & 1);
+						break;
+					case 0x6:									// LSR
+						R[d] = shift_right(rd >> 1, rd & 1);
+						break;
+					case 0x7:									// ROR
+						R[d] = shift_right((rd >> 1) | (c << 7), rd & 1);
+						break;
+					default:
+						return false;
+				}
+				return true;
+			}
+			if ((op & 0xfe0f) == 0x940a)						// DEC
+			{
+				R[d] = rd - 1;
+				set_flags(F_Z | F_N | F_V | F_S, nzs(R[d], R[d] == 0x7f ? F_V : 0));
+				return true;
+			}
+			if ((op & 0xff0f) == 0x9408)						// BSET, BCLR
+			{
+				set_flags(1 << ((op >> 4) & 7), (op & 0x80) ? 0 : 0xff);
+				return true;
+			}
+			switch (op)
+			{
+				case 0x9508:									// RET
+				case 0x9518:									// RETI
+					pc = pop_pc();
+					cycles += 3;
+					if (op == 0x9518)
+						data[SREG] |= F_I;
+					return true;
+				case 0x9409:									// IJMP
+				case 0x9419:									// EIJMP, EIND is always 0 here
+					pc = R[30] | R[31] << 8;
+					cycles++;
+					return true;
+				case 0x9509:									// ICALL
+				case 0x9519:									// EICALL
+					push_pc(pc);
+					pc = R[30] | R[31] << 8;
+					cycles += op == 0x9509 ? 2 : 3;
+					return true;
+				case 0x9588:									// SLEEP, nothing wakes it here
+				case 0x9598:									// BREAK
+				case 0x95a8:									// WDR
+					return true;
+				case 0x95c8:									// LPM, ELPM
+				case 0x95d8:
+					R[0] = flash[R[30] | R[31] << 8];
+					cycles += 2;
+					return true;
+			}
+			if ((op & 0xfe00) == 0x9600)						// ADIW, SBIW
+			{
+				d = 24 + ((op >> 3) & 6);
+				k = ((op >> 2) & 0x30) | (op & 0x0f);
+				w = R[d] | R[d + 1] << 8;
+				a = (op & 0x0100) ? w - k : w + k;
+				R[d] = a;
+				R[d + 1] = a >> 8;
+				v = 0;
+				if (op & 0x0100)
+					v = ((a & ~w & 0x8000) ? F_C : 0) | ((w & ~a & 0x8000) ? F_V : 0);
+				else
+					v = ((~a & w & 0x8000) ? F_C : 0) | ((a & ~w & 0x8000) ? F_V : 0);
+				v = nzs(a >> 8, v);
+				if (a & 0xff)
+					v &= ~F_Z;
+				set_flags(F_C | F_Z | F_N | F_V | F_S, v);
+				cycles++;
+				return true;
+			}
+			if ((op & 0xfc00) == 0x9800)						// CBI, SBIC, SBI, SBIS
+			{
+				a = 0x20 + ((op >> 3) & 0x1f);
+				v = 1 << (op & 7);
+				switch ((op >> 8) & 3)
+				{
+					case 0:
+						write_data(a, read_data(a) & ~v);
+						cycles++;
+						break;
+					case 2:
+						write_data(a, read_data(a) | v);
+						cycles++;
+						break;
+					default:
+						if (!(read_data(a) & v) == !((op >> 8) & 2))
+						{
+							k = is_two_words(fetch(pc)) ? 2 : 1;
+							pc += k;
+							cycles += k;
+						}
+						break;
+				}
+				return true;
+			}
+			if ((op & 0xfc00) == 0x9c00 && dev->mul)			// MUL
+			{
+				w = rd * rr;
+				mul(w, w & 0x8000);
+				cycles++;
+				return true;
+			}
+			return false;
+
+		case 0xb:												// IN, OUT
+			a = 0x20 + ((op & 0x0f) | ((op >> 5) & 0x30));
+			if (op & 0x0800)
+				write_data(a, rd);
+			else
+				R[d] = read_data(a);
+			break;
+
+		case 0xc:												// RJMP
+		case 0xd:												// RCALL
+			rel = (int16_t)(op << 4) >> 4;
+			if (op & 0x1000)
+			{
+				push_pc(pc);
+				cycles++;
+			}
+			pc += rel;
+			cycles++;
+			break;
+
+		case 0xf:
+			v = 1 << (op & 7);
+			if (!(op & 0x0800))									// BRBS, BRBC
+			{
+				if (!(data[SREG] & v) == !!(op & 0x0400))
+				{
+					rel = (int16_t)(op << 6) >> 9;
+					pc += rel;
+					cycles++;
+				}
+			}
+			else if (op & 8)
+				return false;
+			else if ((op & 0x0e00) == 0x0800)					// BLD
+				R[d] = (data[SREG] & F_T) ? (rd | v) : (rd & ~v);
+			else if ((op & 0x0e00) == 0x0a00)					// BST
+				set_flags(F_T, (rd & v) ? F_T : 0);
+			else if (!(rd & v) == !(op & 0x0200))				// SBRC, SBRS
+			{
+				k = is_two_words(fetch(pc)) ? 2 : 1;
+				pc += k;
+				cycles += k;
+			}
+			break;
+
+		default:
+			return false;
+	}
+	return true;
+}
+
+
+/*
+ * Runs
+ */
+
+static bool
+parse_value(const char *s, long *v)
+{
+	char *end;
+
+	*v = strtol(s, &end, 0);
+	return end != s && *end == '\0';
+}
+
+
+// One setting of the command line or the bench file, see the top. *runs gets xN
+static bool
+apply_setting(const char *s, int *runs)
+{
+	char name[128], *eq, *star, *plus;
+	long v, n, off = 0;
+	symbol_t *sym;
+	uint32_t a;
+	const char *p;
+
+	if (s[0] == 'x' && parse_value(s + 1, &v) && v > 0)
+	{
+		*runs = v;
+		return true;
+	}
+	if (!(eq = strchr(s, '=')) || eq - s >= (long)sizeof(name))
+		return false;
+	memcpy(name, s, eq - s);
+	name[eq - s] = '\0';
+
+	if (name[0] == '@')
+	{
+		if (!parse_value(name + 1, &n) || n < 0x20 || n > 0xff || !parse_value(eq + 1, &v))
+			return false;
+		io_fixed[n] = v & 0xff;
+		return true;
+	}
+	if ((name[0] == 'a' || name[0] == 'r') && parse_value(name + 1, &n) && parse_value(eq + 1, &v))
+	{
+		if (name[0] == 'a' && n >= 0 && n < 4)
+		{
+			data[24 - 2 * n] = v;
+			data[25 - 2 * n] = v >> 8;
+			return true;
+		}
+		if (name[0] == 'r' && n >= 0 && n < 32)
+		{
+			data[n] = v;
+			return true;
+		}
+		return false;
+	}
+
+	n = 0;
+	if ((star = strchr(name, '*')))
+	{
+		*star = '\0';
+		if (!parse_value(star + 1, &n))
+			return false;
+	}
+	if ((plus = strchr(name, '+')))
+	{
+		*plus = '\0';
+		if (!parse_value(plus + 1, &off))
+			return false;
+	}
+	if (!(sym = find_symbol(name)) || sym->value < DATA_OFFSET)
+	{
+		fprintf(stderr, "%s: no variable %s\n", elf_name, name);
+		return false;
+	}
+	a = sym->value - DATA_OFFSET + off;
+	if (n)
+	{
+		if (!parse_value(eq + 1, &v))
+			return false;
+		while (n--)
+			data[(a++) & 0xffff] = v;
+		return true;
+	}
+	if (!strchr(eq + 1, ',') && parse_value(eq + 1, &v) && off == 0 && (sym->size == 2 || sym->size == 4))
+	{
+		for (n = 0; n < (long)sym->size; n++, v >>= 8)
+			data[(a + n) & 0xffff] = v;
+		return true;
+	}
+	for (p = eq + 1; *p; )
+	{
+		v = strtol(p, (char **)&p, 0);
+		data[(a++) & 0xffff] = v;
+		if (*p == ',')
+			p++;
+		else if (*p)
+			return false;
+	}
+	return true;
+}
+
+
+// One call of the function or interrupt at the word address entry, the registers as in regs
+static result_t
+run_once(uint16_t entry, bool isr, const uint8_t *regs)
+{
+	result_t res = { 0, 0, 0, false };
+	uint16_t sp0 = dev->ramend;
+
+	memcpy(data, regs, 32);
+	data[1] = 0;							// __zero_reg__, always 0 outside of a multiplication
+	set_sp(sp0);
+	sp_min = sp0;
+	push_pc(RET_SENTINEL);
+	cycles = 0;
+	if (isr)
+	{
+		data[SREG] &= ~F_I;
+		cycles = 4;							// interrupt response, PC pushed, the vector's jump comes on top
+	}
+	else
+		data[SREG] |= F_I;
+	pc = entry;
+
+	while (pc != RET_SENTINEL)
+	{
+		if (!step())
+		{
+			fprintf(stderr, "%s: unknown instruction %04x at 0x%04x, or none the %s has\n", elf_name, fetch(pc - 1),
+				(pc - 1) * 2, dev->name);
+			return res;
+		}
+		res.instructions++;
+		if (cycles > cycle_limit)
+		{
+			fprintf(stderr, "%s: still running after %u cycles, at 0x%04x. Waiting for a register? Fix it with @addr=value\n",
+				elf_name, cycles, pc * 2);
+			return res;
+		}
+	}
+	res.cycles = cycles;
+	res.stack = sp0 - sp_min;
+	res.ok = get_sp() == sp0;
+	if (!res.ok)
+		fprintf(stderr, "%s: returned with the stack off by %d\n", elf_name, get_sp() - sp0);
+	return res;
+}
+
+
+// Runs name with the settings, prints one line of the table
+static bool
+bench(const char *name, int n_settings, char **settings)
+{
+	uint8_t regs[32];
+	symbol_t *sym;
+	result_t res;
+	int vec, runs = 1, i;
+	uint32_t min = UINT32_MAX, max = 0, instr_max = 0;
+	uint16_t stack_max = 0, entry;
+	double sum = 0;
+
+	memcpy(data, data_init, sizeof(data));
+	memset(io_fixed, 0xff, sizeof(io_fixed));
+	for (i = 0; i < n_settings; i++)
+	{
+		if (!apply_setting(settings[i], &runs))
+		{
+			fprintf(stderr, "%s: bad setting %s\n", elf_name, settings[i]);
+			return false;
+		}
+	}
+	memcpy(regs, data, sizeof(regs));
+
+	if ((vec = vector_number(name)) > 0)
+		entry = vec * dev->vector_size / 2;
+	else if ((sym = find_symbol(name)) && sym->value < FLASH_MAX)
+		entry = sym->value / 2;
+	else
+	{
+		fprintf(stderr, "%s: no function %s, static ones may have been inlined\n", elf_name, name);
+		return false;
+	}
+
+	for (i = 0; i < runs; i++)
+	{
+		res = run_once(entry, vec > 0, regs);
+		if (!res.ok)
+			return false;
+		if (res.cycles < min)
+			min = res.cycles;
+		if (res.cycles > max)
+			max = res.cycles;
+		if (res.instructions > instr_max)
+			instr_max = res.instructions;
+		if (res.stack > stack_max)
+			stack_max = res.stack;
+		sum += res.cycles;
+	}
+	printf("%-24s %5d %8u %8.0f %8u %9.2f %7u %6u\n", name, runs, min, sum / runs, max, max / mhz, instr_max,
+		stack_max);
+	return true;
+}
+
+
+static void
+header(void)
+{
+	printf("%s, %s at %g MHz\n", elf_name, dev->name, mhz);
+	printf("%-24s %5s %8s %8s %8s %9s %7s %6s\n", "", "runs", "min", "avg", "max", "max us", "instr", "stack");
+}
+
+
+// The bench file: "elf file [device] [MHz]" lines pick the firmware, the others are "name [setting ...]"
+static int
+bench_file(const char *file, double mhz_arg)
+{
+	FILE *f = fopen(file, "r");
+	char line[512], *argv[MAX_SETTINGS + 1], *tok;
+	int argc, err = 0;
+	bool loaded = false;
+
+	if (!f)
+	{
+		perror(file);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), f))
+	{
+		argc = 0;
+		for (tok = strtok(line, " \t\r\n"); tok && *tok != '#' && argc <= MAX_SETTINGS; tok = strtok(NULL, " \t\r\n"))
+			argv[argc++] = tok;
+		if (argc == 0)
+			continue;
+		if (!strcmp(argv[0], "elf") && argc >= 2)
+		{
+			if (loaded)
+				printf("\n");
+			loaded = load_elf(argv[1], argc >= 3 ? argv[2] : NULL);
+			if (loaded)
+			{
+				mhz = mhz_arg ? mhz_arg : argc >= 4 ? atof(argv[3]) : dev->mhz;
+				header();
+			}
+			else
+				err = 1;
+		}
+		else if (loaded && !bench(argv[0], argc - 1, argv + 1))
+			err = 1;
+	}
+	fclose(f);
+	return err;
+}
+
+
+int
+main(int argc, char **argv)
+{
+	const char *device = NULL, *bench_name = NULL;
+	double mhz_arg = 0;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; i++)
+	{
+		if (!strcmp(argv[i], "-m") && i + 1 < argc)
+			device = argv[++i];
+		else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+			mhz_arg = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+			cycle_limit = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+			bench_name = argv[++i];
+		else
+			break;
+	}
+	if (bench_name)
+		return bench_file(bench_name, mhz_arg);
+	if (argc - i < 2)
+	{
+		fprintf(stderr, "usage: %s [-m device] [-f MHz] [-l cycles] file.elf name [setting ...]\n"
+			"       %s [-f MHz] [-l cycles] -b bench.txt\n", argv[0], argv[0]);
+		return 1;
+	}
+	if (!load_elf(argv[i], device))
+		return 1;
+	mhz = mhz_arg ? mhz_arg : dev->mhz;
+	header();
+	return bench(argv[i + 1], argc - i - 2, argv + i + 2) ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+/*
+ * clocksync.c
+ *
+ * Created: 10/19/2026
+ *
+ * Sets every DotClock on the USB serial ports to the local time of this host in one pass and prints their telemetry.
+ * The ports are opened first, then the time packet goes out to all of them right at the start of a wall clock second,
+ * the clocks start their second when it arrives. Needs the clock firmware built with USB_CDC, see DotClock/C_code.
+ *
+ * Usage: clocksync [-q] [-w seconds] [port ...]
+ *	-q				query only, don't set the time
+ *	-w seconds		how long to wait for the replies, default 2
+ *	port			serial ports, default all of /dev/ttyACM*
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "clock_proto.h"
+
+#define MAX_PORTS	64
+
+typedef struct port
+{
+	const char *name;
+	int fd;
+	proto_rx_t rx;
+	bool answered;
+	proto_telemetry_t t;
+	double at;				// host time of the reply
+} port_t;
+
+static port_t ports[MAX_PORTS];
+static int n_ports;
+
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void
+add_port(const char *name)
+{
+	struct termios tio;
+	int fd, dtr = TIOCM_DTR;
+
+	if (n_ports == MAX_PORTS)
+		return;
+	if ((fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK)) < 0)
+	{
+		perror(name);
+		return;
+	}
+	if (tcgetattr(fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	ioctl(fd, TIOCMBIS, &dtr);		// the clock only talks with DTR set, fails harmlessly on a pty
+	tcflush(fd, TCIOFLUSH);
+
+	ports[n_ports].name = name;
+	ports[n_ports].fd = fd;
+	n_ports++;
+}
+
+
+static void
+send_all(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+	uint8_t frame[PROTO_FRAME_MAX];
+	uint8_t n = Proto_Frame(frame, type, payload, len);
+	int i;
+
+	for (i = 0; i < n_ports; i++)
+		if (write(ports[i].fd, frame, n) != n)
+			fprintf(stderr, "%s: %s\n", ports[i].name, strerror(errno));
+}
+
+
+// Collects the telemetry replies until all ports answered or the time is up
+static void
+receive_all(double wait)
+{
+	struct pollfd pfd[MAX_PORTS];
+	double end = now() + wait;
+	uint8_t buf[64];
+	int i, j, left = n_ports;
+	ssize_t n;
+
+	while (left && now() < end)
+	{
+		for (i = 0; i < n_ports; i++)
+		{
+			pfd[i].fd = ports[i].answered ? -1 : ports[i].fd;
+			pfd[i].events = POLLIN;
+		}
+		if (poll(pfd, n_ports, (int)((end - now()) * 1000) + 1) <= 0)
+			continue;
+
+		for (i = 0; i < n_ports; i++)
+		{
+			if (!(pfd[i].revents & POLLIN) || (n = read(ports[i].fd, buf, sizeof(buf))) <= 0)
+				continue;
+			for (j = 0; j < n && !ports[i].answered; j++)
+			{
+				if (Proto_Rx(&ports[i].rx, buf[j]) == PROTO_TELEMETRY && (ports[i].rx.len == PROTO_TELEMETRY_LEN
+					|| ports[i].rx.len == PROTO_TELEMETRY_OLD))
+				{
+					memset(ports[i].rx.payload + ports[i].rx.len, 0, PROTO_TELEMETRY_LEN - ports[i].rx.len);
+					Proto_GetTelemetry(&ports[i].t, ports[i].rx.payload);
+					ports[i].at = now();
+					ports[i].answered = true;
+					left--;
+				}
+			}
+		}
+	}
+}
+
+
+// Whole seconds the clock is ahead of this host's local time, within +-12 hours
+static int
+offset(const port_t *p)
+{
+	time_t t = (time_t)p->at;
+	struct tm tm;
+	int host, clock, d;
+
+	localtime_r(&t, &tm);
+	host = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+	clock = p->t.hours * 3600 + p->t.minutes * 60 + p->t.seconds;
+	d = clock - host;
+	if (d > 43200)
+		d -= 86400;
+	if (d < -43200)
+		d += 86400;
+	return d;
+}
+
+
+int
+main(int argc, char **argv)
+{
+	bool query = false;
+	double wait = 2, t;
+	glob_t g;
+	struct timespec ts;
+	struct tm tm;
+	time_t second;
+	uint8_t payload[3];
+	size_t k;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-q"))
+			query = true;
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+			wait = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-q] [-w seconds] [port ...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (i < argc)
+		for (; i < argc; i++)
+			add_port(argv[i]);
+	else if (glob("/dev/ttyACM*", 0, NULL, &g) == 0)
+		for (k = 0; k < g.gl_pathc; k++)
+			add_port(g.gl_pathv[k]);
+
+	if (n_ports == 0)
+	{
+		fprintf(stderr, "no clocks found\n");
+		return 1;
+	}
+
+	if (query)
+		send_all(PROTO_GET, NULL, 0);
+	else
+	{
+		t = now();
+		second = (time_t)t + 1;				// sleep to the next second boundary, then send it
+		ts.tv_sec = 0;
+		ts.tv_nsec = (long)((second - t) * 1e9);
+		nanosleep(&ts, NULL);
+		localtime_r(&second, &tm);
+		payload[0] = tm.tm_hour;
+		payload[1] = tm.tm_min;
+		payload[2] = tm.tm_sec;
+		send_all(PROTO_SET_TIME, payload, sizeof(payload));
+	}
+
+	receive_all(wait);
+
+	printf("%-16s %8s %6s %4s %9s %8s %9s %7s %9s %5s\n",
+		"port", "time", "offset", "mode", "drift ppm", "ISR load", "passes/s", "dim/brt", "uptime s", "stack");
+	for (i = 0; i < n_ports; i++)
+	{
+		port_t *p = &ports[i];
+
+		if (!p->answered)
+		{
+			printf("%-16s no answer\n", p->name);
+			continue;
+		}
+		printf("%-16s %02u:%02u:%02u %+6d %4u %9.1f %7.1f%% %9lu %3u/%-3u %9lu %5u\n",
+			p->name, p->t.hours, p->t.minutes, p->t.seconds, offset(p), p->t.mode, p->t.drift / 10.0,
+			p->t.isr_load / 10.0, (unsigned long)p->t.loop_passes, p->t.dim_level, p->t.bright_level,
+			(unsigned long)p->t.uptime, p->t.stack_free);
+	}
+	return 0;
+}
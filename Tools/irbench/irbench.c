@@ -0,0 +1,710 @@
+/*
+ * irbench.c
+ *
+ * Created: 10/19/2026
+ *
+ * Replays IR edge traces into the decoder of the antenna switch (Vizio_IR_ANT_SW/IR_Ant_SW/ir_decode.c) on a PC.
+ * The entries go through the same capture queue (ir_ring.h) as on the AVR, only the capture interrupt is left out:
+ * since it timestamps in hardware the decoder sees nothing but the low and high times, which is what a trace holds.
+ *
+ * Without files it synthesizes traces of every protocol, clean, with timing jitter, with noise, truncated and held
+ * buttons, NEC frames with a bad inverse byte as well, and checks what the decoder makes of them. A held button next
+ * to a switch that relays it (IR_RELAY) runs on a model of the receiver that sees the remote and the switch's own LED
+ * at once. Then it measures how fast the decoder is.
+ *
+ * Usage: irbench [-n frames] [-j percent] [-s seed] [-w file] [trace ...]
+ *	-n frames		synthesized frames per protocol and kind, default 200
+ *	-j percent		timing jitter of the jittered traces, default 15
+ *	-s seed			random seed
+ *	-w file			also write the synthesized traces to file
+ *	trace			replay trace files instead, as written by the IR_CAPTURE build or -w, "-" for stdin
+ *
+ * Trace format, one sequence per line, the pause after it is implied by the line end, # starts a comment:
+ *	L9000 H4500 L560 H560 L560 H1690 ... L560
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "ir_ring.h"
+#include "ir_decode.h"
+#include "ir_send.h"
+
+#define MAX_ENTRIES		256				// per sequence
+#define RELAY_STEP_US	5				// time step of the relay model
+#define RELAY_STEPS		(2500000 / RELAY_STEP_US)	// a press with up to 20 repeats and the time after it
+#define RELAY_LEAD_US	20				// IR_TX_LEAD of ir_send.c
+#define NEC_REPEAT_US	108000L			// from one repeat frame of a held button to the next
+
+typedef struct expect
+{
+	bool frame;							// a frame should come out of this sequence
+	ir_frame_t f;
+} expect_t;
+
+typedef struct seq
+{
+	uint16_t e[MAX_ENTRIES];
+	int n;
+	expect_t x;
+} seq_t;
+
+typedef struct tally
+{
+	unsigned seqs, expected, correct, wrong, missed, spurious;
+} tally_t;
+
+static const char *protocol_names[IR_N_PROTOCOLS] = { "NEC", "SIRC12", "SIRC15", "SIRC20", "RC5" };
+static const char *kinds[] = { "clean", "jitter", "glitch", "truncated", "bad inverse" };
+#define N_KINDS			5
+#define KIND_INVERSE	4				// NEC only, the others have no inverse bytes
+static double jitter;					// fraction
+static FILE *trace_out;
+static bool remote_on[RELAY_STEPS];		// carrier of the remote and of the switch's LED, per RELAY_STEP_US
+static bool relay_on[RELAY_STEPS];
+
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static double
+rnd(void)
+{
+	return rand() / (RAND_MAX + 1.0);
+}
+
+
+// Appends one low or high part, merged with the one before if it has the same level
+static void
+put(seq_t *s, bool high, double us)
+{
+	uint32_t t;
+
+	us *= 1 + jitter * (2 * rnd() - 1);
+	t = (uint32_t)(us * IR_TICKS_PER_US + 0.5);
+	if (t >= IR_TIME)
+		t = IR_TIME - 1;
+	if (s->n && (s->e[s->n - 1] & IR_HIGH) == (high ? IR_HIGH : 0))
+	{
+		t += s->e[s->n - 1] & IR_TIME;
+		s->e[s->n - 1] = (t >= IR_TIME ? IR_TIME - 1 : t) | (high ? IR_HIGH : 0);
+	}
+	else if (s->n < MAX_ENTRIES)
+		s->e[s->n++] = t | (high ? IR_HIGH : 0);
+}
+
+
+static void
+lo(seq_t *s, double us)
+{
+	put(s, false, us);
+}
+
+
+static void
+hi(seq_t *s, double us)
+{
+	put(s, true, us);
+}
+
+
+static void
+make_nec(seq_t *s, uint32_t code)
+{
+	int i;
+
+	lo(s, 9000);
+	hi(s, 4500);
+	for (i = 0; i < 32; i++)
+	{
+		lo(s, 560);
+		hi(s, (code >> i) & 1 ? 1690 : 560);
+	}
+	lo(s, 560);
+}
+
+
+static void
+make_nec_repeat(seq_t *s)
+{
+	lo(s, 9000);
+	hi(s, 2250);
+	lo(s, 560);
+}
+
+
+static void
+make_sirc(seq_t *s, uint32_t code, int bits)
+{
+	int i;
+
+	lo(s, 2400);
+	for (i = 0; i < bits; i++)
+	{
+		hi(s, 600);
+		lo(s, (code >> i) & 1 ? 1200 : 600);
+	}
+}
+
+
+// 14 bits MSB first, a 1 is high then low. The high half of the first start bit is in the pause before
+static void
+make_rc5(seq_t *s, uint32_t code)
+{
+	int i;
+
+	for (i = 13; i >= 0; i--)
+	{
+		bool one = (code >> i) & 1;
+
+		if (i != 13)
+			put(s, one, 889);
+		put(s, !one, 889);
+	}
+	if (s->e[s->n - 1] & IR_HIGH)		// a last 0 ends high, that is the pause
+		s->n--;
+}
+
+
+static uint32_t
+random_code(int protocol)
+{
+	uint8_t a = rand(), c = rand();
+
+	switch (protocol)
+	{
+		case IR_NEC:
+			return a | (uint32_t)(uint8_t)~a << 8 | (uint32_t)c << 16 | (uint32_t)(uint8_t)~c << 24;
+		case IR_SIRC12:
+			return rand() & 0xfff;
+		case IR_SIRC15:
+			return rand() & 0x7fff;
+		case IR_SIRC20:
+			return rand() & 0xfffff;
+		default:
+			return 0x3000 | (rand() & 0xfff);		// both start bits set
+	}
+}
+
+
+static void
+make_frame(seq_t *s, int protocol, uint32_t code)
+{
+	static const int sirc_bits[] = { [IR_SIRC12] = 12, [IR_SIRC15] = 15, [IR_SIRC20] = 20 };
+
+	s->n = 0;
+	switch (protocol)
+	{
+		case IR_NEC:
+			make_nec(s, code);
+			break;
+		case IR_RC5:
+			make_rc5(s, code);
+			break;
+		default:
+			make_sirc(s, code, sirc_bits[protocol]);
+			break;
+	}
+	s->x.frame = true;
+	s->x.f.protocol = protocol;
+	s->x.f.bits = protocol == IR_NEC ? 32 : protocol == IR_RC5 ? 14 : sirc_bits[protocol];
+	s->x.f.code = code;
+	s->x.f.repeat = false;
+}
+
+
+static void
+write_seq(FILE *f, const seq_t *s)
+{
+	int i;
+
+	for (i = 0; i < s->n; i++)
+		fprintf(f, "%c%u%c", s->e[i] & IR_HIGH ? 'H' : 'L', (s->e[i] & IR_TIME) / IR_TICKS_PER_US,
+			i + 1 < s->n ? ' ' : '\n');
+}
+
+
+// Feeds one sequence and the pause after it through the queue, true if a frame came out
+static bool
+run_seq(const seq_t *s, ir_frame_t *f)
+{
+	uint16_t e;
+	bool got = false;
+	int i;
+
+	for (i = 0; i <= s->n; i++)
+	{
+		IR_Push(i < s->n ? s->e[i] : IR_TIME | IR_HIGH);
+		while (IR_Pop(&e))
+			if (IR_Decode(e, f))
+				got = true;
+	}
+	return got;
+}
+
+
+static void
+check(tally_t *t, const seq_t *s)
+{
+	ir_frame_t f;
+	bool got;
+
+	if (trace_out)
+		write_seq(trace_out, s);
+	got = run_seq(s, &f);
+	t->seqs++;
+	if (s->x.frame)
+	{
+		t->expected++;
+		if (!got)
+			t->missed++;
+		else if (f.protocol == s->x.f.protocol && f.code == s->x.f.code && f.repeat == s->x.f.repeat)
+			t->correct++;
+		else
+			t->wrong++;
+	}
+	else if (got)
+		t->spurious++;
+}
+
+
+static void
+reset_decoder(void)
+{
+	IR_DecodeReset();
+	IR_Decode(IR_TIME | IR_HIGH, NULL);		// as after a pause, RC5 has no header to start on
+	IR_malformed = IR_accepted = IR_rejected = IR_repeats = 0;
+}
+
+
+static void
+print_tally(const char *name, const tally_t *t)
+{
+	printf("%-24s %6u %8u %8u %6u %6u %8u %9u %8u\n", name, t->seqs, t->expected, t->correct, t->wrong, t->missed,
+		t->spurious, IR_malformed, IR_rejected);
+}
+
+
+// A short high inside one of the low parts, as from a reflection or a fluorescent lamp
+static void
+add_glitch(seq_t *s)
+{
+	int i, k;
+	uint16_t len;
+
+	for (k = 0; k < 8; k++)
+	{
+		i = rand() % s->n;
+		len = s->e[i] & IR_TIME;
+		if (!(s->e[i] & IR_HIGH) && len > IR_TICKS_US(300) && s->n + 2 <= MAX_ENTRIES)
+		{
+			memmove(&s->e[i + 2], &s->e[i], (s->n - i) * sizeof(s->e[0]));
+			s->e[i] = len / 2;
+			s->e[i + 1] = IR_TICKS_US(80) | IR_HIGH;
+			s->e[i + 2] = len - len / 2 - IR_TICKS_US(80);
+			s->n += 2;
+			return;
+		}
+	}
+}
+
+
+// One bit of a NEC inverse byte, the command's or, where the decoder checks it, the address's
+static uint32_t
+inverse_bit(void)
+{
+#ifdef IR_NEC_EXTENDED
+	return 1UL << (24 + rand() % 8);
+#else
+	return 1UL << ((rand() & 1 ? 24 : 8) + rand() % 8);
+#endif
+}
+
+
+// The marks of s into a timeline from step t on, returns the step after its end
+static long
+paint(bool *line, long t, const seq_t *s)
+{
+	long n, k;
+	int i;
+
+	for (i = 0; i < s->n; i++)
+	{
+		n = (s->e[i] & IR_TIME) / IR_TICKS_PER_US / RELAY_STEP_US;
+		if (!(s->e[i] & IR_HIGH))
+			for (k = 0; k < n && t + k < RELAY_STEPS; k++)
+				line[t + k] = true;
+		t += n;
+	}
+	return t;
+}
+
+
+typedef struct relay
+{
+	long tx_end, echo_end;				// steps, IR_SendBusy() and IR_SendEcho() until then
+	unsigned frames, correct, repeats, relayed;
+	uint32_t code;
+} relay_t;
+
+// IR_SendNEC() of the switch, false while busy
+static bool
+relay_send(relay_t *r, long t, bool repeat)
+{
+	seq_t s;
+
+	if (t < r->tx_end)
+		return false;
+	s.n = 0;
+	if (repeat)
+		make_nec_repeat(&s);
+	else
+		make_nec(&s, r->code);
+	r->tx_end = paint(relay_on, t + RELAY_LEAD_US / RELAY_STEP_US, &s);
+	r->echo_end = r->tx_end + IR_TX_ECHO / IR_TICKS_PER_US / RELAY_STEP_US;
+	return true;
+}
+
+// One entry of the capture queue through the main loop of main.c in the IR_RELAY build
+static void
+relay_entry(relay_t *r, long t, uint16_t e)
+{
+	ir_frame_t f;
+	uint16_t repeats = IR_repeats;
+
+	if (t < r->echo_end)
+	{
+		IR_DecodeDrop(e);
+		return;
+	}
+	if (IR_Decode(e, &f) && !f.repeat)
+	{
+		r->frames++;
+		if (f.protocol == IR_NEC && f.code == r->code)
+		{
+			r->correct++;
+			relay_send(r, t, false);
+		}
+	}
+	if (IR_repeats != repeats)
+	{
+		r->repeats++;
+		r->relayed += relay_send(r, t, true);
+	}
+}
+
+// A NEC button held for 1..20 repeat frames next to the relaying switch. The receiver output is low while either
+// carrier is on, its edges and timeouts become entries as the capture and timeout interrupts queue them. The relayed
+// frame goes out over the remote's first repeat, that one is lost, every repeat after it should be recognised and
+// relayed, and nothing count as malformed
+static void
+relay_held(int presses)
+{
+	relay_t r = { 0 };
+	seq_t s;
+	unsigned sent = 0, expected = 0, malformed = 0;
+	uint16_t e;
+	long t, edge, end = 0;
+	bool low, line_low, active;
+	int i, k, repeats;
+
+	for (i = 0; i < presses; i++)
+	{
+		memset(remote_on, 0, sizeof(remote_on));
+		memset(relay_on, 0, sizeof(relay_on));
+		reset_decoder();
+		r.tx_end = r.echo_end = 0;
+		r.code = random_code(IR_NEC);
+		repeats = 1 + rand() % 20;
+		s.n = 0;
+		make_nec(&s, r.code);
+		paint(remote_on, 0, &s);
+		for (k = 1; k <= repeats; k++)
+		{
+			s.n = 0;
+			make_nec_repeat(&s);
+			end = paint(remote_on, k * NEC_REPEAT_US / RELAY_STEP_US, &s);
+		}
+		sent += repeats;
+		expected += repeats - 1;
+		end += 2 * NEC_REPEAT_US / RELAY_STEP_US;
+
+		line_low = active = false;
+		edge = 0;
+		for (t = 0; t < end; t++)
+		{
+			low = remote_on[t] || relay_on[t];
+			if (low != line_low)
+			{
+				e = (t - edge) * RELAY_STEP_US * IR_TICKS_PER_US;
+				if (active)			// the first edge after a pause, the timeout queued the pause
+					relay_entry(&r, t, (e >= IR_TIME ? IR_TIME - 1 : e) | (line_low ? 0 : IR_HIGH));
+				active = true;
+				line_low = low;
+				edge = t;
+			}
+			else if (active && !low && (t - edge) * RELAY_STEP_US * IR_TICKS_PER_US >= IR_TIMEOUT)
+			{
+				relay_entry(&r, t, IR_TIME | IR_HIGH);
+				active = false;
+			}
+		}
+		malformed += IR_malformed;
+	}
+
+	printf("%-24s %6u %8u %8u %6u %6u %8u %9u %8s\n", "NEC relayed", presses, presses, r.correct, r.frames - r.correct,
+		presses - r.correct, 0, malformed, "");
+	printf("%-24s %u of %u repeat frames recognised, %u relayed\n", "", r.repeats, sent, r.relayed);
+	if (r.repeats != expected || r.relayed != expected)
+		printf("%-24s expected %u, all but the first of each press\n", "", expected);
+}
+
+
+static void
+synthesize(int frames, double jitter_percent)
+{
+	tally_t all = { 0 }, t;
+	seq_t s;
+	char name[32];
+	int p, k, i, r;
+
+	printf("%-24s %6s %8s %8s %6s %6s %8s %9s %8s\n",
+		"traces", "seqs", "expected", "correct", "wrong", "missed", "spurious", "malformed", "rejected");
+	for (p = 0; p < IR_N_PROTOCOLS; p++)
+	{
+		for (k = 0; k < N_KINDS; k++)
+		{
+			if (k == KIND_INVERSE && p != IR_NEC)
+				continue;
+			memset(&t, 0, sizeof(t));
+			reset_decoder();
+			jitter = k == 1 ? jitter_percent / 100 : 0;
+			for (i = 0; i < frames; i++)
+			{
+				make_frame(&s, p, random_code(p));
+				if (k == 2)
+				{
+					add_glitch(&s);
+					s.x.frame = false;			// a glitch breaks the frame, anything decoded would be wrong
+				}
+				else if (k == 3)
+				{
+					s.n = 1 + rand() % (s.n - 1);
+					s.x.frame = false;
+				}
+				else if (k == KIND_INVERSE)
+				{
+					make_frame(&s, p, random_code(p) ^ inverse_bit());
+					s.x.frame = false;			// every one of them rejected
+				}
+				check(&t, &s);
+			}
+			snprintf(name, sizeof(name), "%s %s", protocol_names[p], kinds[k]);
+			print_tally(name, &t);
+			if (k == KIND_INVERSE && IR_rejected != t.seqs)
+				printf("%-24s only %u of %u rejected\n", "", IR_rejected, t.seqs);
+			all.seqs += t.seqs;
+			all.expected += t.expected;
+			all.correct += t.correct;
+			all.wrong += t.wrong;
+			all.missed += t.missed;
+			all.spurious += t.spurious;
+		}
+	}
+
+	// held NEC buttons: a frame and 1..20 repeat frames, reported as the hold policy in ir_decode.h says
+	memset(&t, 0, sizeof(t));
+	reset_decoder();
+	jitter = jitter_percent / 200;
+	for (i = 0; i < frames / 4; i++)
+	{
+		uint32_t code = random_code(IR_NEC);
+		int repeats = 1 + rand() % 20;
+
+		make_frame(&s, IR_NEC, code);
+		check(&t, &s);
+		for (r = 1; r <= repeats; r++)
+		{
+			s.n = 0;
+			make_nec_repeat(&s);
+			s.x.frame = IR_HOLD_REPEAT && r >= IR_HOLD_DELAY && (r - IR_HOLD_DELAY) % IR_HOLD_EVERY == 0;
+			s.x.f.repeat = true;
+			check(&t, &s);
+		}
+	}
+	print_tally("NEC held", &t);
+	printf("%-24s %u repeat frames recognised\n", "", IR_repeats);
+
+	relay_held(frames / 4);
+
+	// random noise, nothing in it should decode
+	memset(&t, 0, sizeof(t));
+	reset_decoder();
+	jitter = 0;
+	for (i = 0; i < frames * 4; i++)
+	{
+		s.n = 0;
+		for (r = rand() % 80; r >= 0; r--)
+			put(&s, r & 1, 50 + rnd() * (rand() & 1 ? 10000 : 2000));
+		s.x.frame = false;
+		check(&t, &s);
+	}
+	print_tally("noise", &t);
+
+	all.seqs += t.seqs;
+	all.spurious += t.spurious;
+	printf("\nframe accuracy %.2f%%, %u wrong and %u spurious frames\n",
+		all.expected ? 100.0 * all.correct / all.expected : 0, all.wrong, all.spurious);
+}
+
+
+// Decoder throughput over a mix of clean frames of all protocols
+static void
+benchmark(void)
+{
+	static seq_t set[250];
+	ir_frame_t f;
+	unsigned long entries = 0, frames = 0, loops = 0;
+	double start, t;
+	int i;
+
+	jitter = 0.05;
+	for (i = 0; i < 250; i++)
+	{
+		make_frame(&set[i], i % IR_N_PROTOCOLS, random_code(i % IR_N_PROTOCOLS));
+		entries += set[i].n + 1;
+	}
+	reset_decoder();
+	start = now();
+	do
+	{
+		for (i = 0; i < 250; i++)
+			frames += run_seq(&set[i], &f);
+		loops++;
+	} while ((t = now() - start) < 1);
+
+	printf("decoder: %.2f M entries/s, %.0f k frames/s, %.0f ns per entry on this host\n",
+		entries * loops / t / 1e6, frames / t / 1e3, t * 1e9 / (entries * loops));
+}
+
+
+// One line of a trace file into s, false at the end of the file
+static bool
+read_seq(FILE *f, seq_t *s, int *line)
+{
+	char buf[4096], *p, *end;
+	unsigned long us;
+
+	while (fgets(buf, sizeof(buf), f))
+	{
+		(*line)++;
+		s->n = 0;
+		for (p = buf; *p && *p != '#'; )
+		{
+			if (isspace((unsigned char)*p))
+			{
+				p++;
+				continue;
+			}
+			if ((*p != 'L' && *p != 'H') || ((us = strtoul(p + 1, &end, 10)), end == p + 1))
+			{
+				fprintf(stderr, "line %d: can't read '%.10s'\n", *line, p);
+				break;
+			}
+			put(s, *p == 'H', us);
+			p = end;
+		}
+		if (s->n)
+			return true;
+	}
+	return false;
+}
+
+
+static int
+replay(const char *name)
+{
+	FILE *f = strcmp(name, "-") ? fopen(name, "r") : stdin;
+	ir_frame_t fr;
+	seq_t s;
+	int line = 0;
+	unsigned seqs = 0, frames = 0;
+
+	if (!f)
+	{
+		perror(name);
+		return 1;
+	}
+	reset_decoder();
+	jitter = 0;
+	while (read_seq(f, &s, &line))
+	{
+		seqs++;
+		if (run_seq(&s, &fr))
+		{
+			frames++;
+			printf("%s:%d %-6s %2u bits %08lx%s\n", name, line, protocol_names[fr.protocol], fr.bits,
+				(unsigned long)fr.code, fr.repeat ? " repeat" : "");
+		}
+	}
+	printf("%s: %u sequences, %u frames, %u repeats, %u malformed, %u rejected\n",
+		name, seqs, frames, IR_repeats, IR_malformed, IR_rejected);
+	if (f != stdin)
+		fclose(f);
+	return 0;
+}
+
+
+int
+main(int argc, char **argv)
+{
+	int frames = 200, i, err = 0;
+	double jitter_percent = 15;
+	unsigned seed = time(NULL);
+
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			jitter_percent = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			seed = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+		{
+			if (!(trace_out = fopen(argv[++i], "w")))
+			{
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-n frames] [-j percent] [-s seed] [-w file] [trace ...]\n", argv[0]);
+			return 1;
+		}
+	}
+	srand(seed);
+
+	if (i < argc)
+	{
+		for (; i < argc; i++)
+			err |= replay(argv[i]);
+		return err;
+	}
+
+	printf("seed %u, %d frames per protocol and kind, %.0f%% jitter\n\n", seed, frames, jitter_percent);
+	synthesize(frames, jitter_percent);
+	if (trace_out)
+		fclose(trace_out);
+	benchmark();
+	return 0;
+}
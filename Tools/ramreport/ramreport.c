@@ -0,0 +1,660 @@
+/*
+ * ramreport.c
+ *
+ * Created: 10/19/2026
+ *
+ * SRAM budget of a firmware build, for sizing new buffers against what is really left. From the files Atmel Studio
+ * leaves in the build directory:
+ *
+ *	the static RAM of every module, .data and .bss, from the linker map (file.map)
+ *	the deepest stack of main() and of every interrupt handler, from the call graph and the stack frames: the frame
+ *	of a function comes from the .su file the compiler writes with -fstack-usage, the calls are read from the code in
+ *	the ELF file
+ *	the worst case, main's deepest path with the deepest interrupt on top, and the RAM left over
+ *
+ * The frames of -fstack-usage include the pushed registers and the return address, an interrupt handler's the whole
+ * context it saves. Calls through a pointer (icall) can go to any function whose address the program takes, in an
+ * ldi pair or in a table in .data, the deepest of those is counted. A function without a .su entry, from avr-libc or
+ * libgcc, counts its return address only and is listed. Recursion is reported and cut off. An interrupt handler that
+ * enables the interrupts again is reported, nested interrupts aren't added up.
+ *
+ * Usage: ramreport [-m device] [-M file.map] [-s dir] file.elf
+ *	-m device		tiny4313, 32u2 or 32u4, by default from the architecture in the ELF file
+ *	-M file.map		the linker map, by default the .map next to the ELF file
+ *	-s dir			where the .su files are, by default the directory of the ELF file and two levels below it
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <dirent.h>
+
+#define EM_AVR			83
+#define SHT_SYMTAB		2
+#define SHT_NOBITS		8
+#define SHF_ALLOC		2
+#define STT_FUNC		2
+#define DATA_OFFSET		0x800000UL	// data addresses in the ELF file, 0x810000 on is the EEPROM
+
+#define FLASH_MAX		0x10000UL
+#define MAX_FUNCS		2048
+#define MAX_MODULES		128
+#define MAX_CALLS		64			// per function
+#define MAX_DEPTH		64			// of a path printed
+
+typedef struct device
+{
+	const char *name;
+	uint8_t arch;				// avr-gcc architecture, in e_flags of the ELF header
+	uint16_t sram;				// first SRAM address
+	uint16_t ramend;
+	const char *const *vectors;	// names by vector number, without _vect
+	int n_vectors;
+} device_t;
+
+static const char *const vectors_tiny4313[] =
+{
+	"RESET", "INT0", "INT1", "TIMER1_CAPT", "TIMER1_COMPA", "TIMER1_OVF", "TIMER0_OVF", "USART0_RX", "USART0_UDRE",
+	"USART0_TX", "ANA_COMP", "PCINT_B", "TIMER1_COMPB", "TIMER0_COMPA", "TIMER0_COMPB", "USI_START", "USI_OVERFLOW",
+	"EE_READY", "WDT_OVERFLOW", "PCINT_A", "PCINT_D"
+};
+
+static const char *const vectors_32u2[] =
+{
+	"RESET", "INT0", "INT1", "INT2", "INT3", "INT4", "INT5", "INT6", "INT7", "PCINT0", "PCINT1", "USB_GEN", "USB_COM",
+	"WDT", "TIMER1_CAPT", "TIMER1_COMPA", "TIMER1_COMPB", "TIMER1_COMPC", "TIMER1_OVF", "TIMER0_COMPA",
+	"TIMER0_COMPB", "TIMER0_OVF", "SPI_STC", "USART1_RX", "USART1_UDRE", "USART1_TX", "ANALOG_COMP", "EE_READY",
+	"SPM_READY"
+};
+
+static const char *const vectors_32u4[] =
+{
+	"RESET", "INT0", "INT1", "INT2", "INT3", "", "", "INT6", "", "PCINT0", "USB_GEN", "USB_COM", "WDT", "", "", "",
+	"TIMER1_CAPT", "TIMER1_COMPA", "TIMER1_COMPB", "TIMER1_COMPC", "TIMER1_OVF", "TIMER0_COMPA", "TIMER0_COMPB",
+	"TIMER0_OVF", "SPI_STC", "USART1_RX", "USART1_UDRE", "USART1_TX", "ANALOG_COMP", "EE_READY", "TIMER3_CAPT",
+	"TIMER3_COMPA", "TIMER3_COMPB", "TIMER3_COMPC", "TIMER3_OVF", "TWI", "SPM_READY", "TIMER4_COMPA",
+	"TIMER4_COMPB", "TIMER4_COMPD", "TIMER4_OVF", "TIMER4_FPF"
+};
+
+#define N_OF(a)	(int)(sizeof(a) / sizeof((a)[0]))
+
+static const device_t devices[] =
+{
+	{ "tiny4313", 25, 0x060, 0x15f, vectors_tiny4313, N_OF(vectors_tiny4313) },
+	{ "32u2", 35, 0x100, 0x4ff, vectors_32u2, N_OF(vectors_32u2) },
+	{ "32u4", 5, 0x100, 0xaff, vectors_32u4, N_OF(vectors_32u4) },
+};
+
+typedef struct func
+{
+	char *name;
+	uint32_t addr, size;		// bytes
+	int frame;					// from the .su file, -1 without
+	bool dynamic;				// the .su file says the frame depends on the run
+	bool indirect;				// has an icall or ijmp
+	bool sei;					// enables the interrupts
+	bool taken;					// its address is used, an indirect call can go there
+	int calls[MAX_CALLS], n_calls;
+	bool tail[MAX_CALLS];		// jumped to, the caller's frame is gone by then
+
+	// depth search
+	int depth;					// bytes, -1 not known yet
+	int next;					// callee on the deepest path, -1 none
+	bool busy, recursive;
+} func_t;
+
+typedef struct module
+{
+	char name[64];
+	uint32_t data, bss;
+} module_t;
+
+static const device_t *dev;
+static uint8_t flash[FLASH_MAX];
+static uint8_t ram_init[0x10000];		// .data as the start-up code copies it
+static uint32_t data_size, bss_size;	// from the section headers
+static func_t funcs[MAX_FUNCS];
+static int n_funcs;
+static module_t modules[MAX_MODULES];
+static int n_modules;
+
+
+static uint32_t
+get32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+
+static uint16_t
+get16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+
+// Flash, the .data image, the RAM sections and the functions of a 32 bit little endian AVR ELF file
+static bool
+load_elf(const char *name, const char *device)
+{
+	FILE *f = fopen(name, "rb");
+	uint8_t *img;
+	long len;
+	uint32_t shoff, i, j;
+	uint16_t shentsize, shnum;
+	int d;
+
+	if (!f)
+	{
+		perror(name);
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	img = malloc(len);
+	if (!img || fread(img, 1, len, f) != (size_t)len)
+	{
+		fprintf(stderr, "%s: can't read\n", name);
+		fclose(f);
+		free(img);
+		return false;
+	}
+	fclose(f);
+	if (len < 52 || memcmp(img, "\177ELF", 4) || img[4] != 1 || img[5] != 1 || get16(img + 18) != EM_AVR)
+	{
+		fprintf(stderr, "%s: not a 32 bit AVR ELF file\n", name);
+		free(img);
+		return false;
+	}
+
+	dev = NULL;
+	for (d = 0; d < N_OF(devices); d++)
+		if (device ? !strcmp(device, devices[d].name) : (get32(img + 36) & 0x7f) == devices[d].arch)
+			dev = &devices[d];
+	if (!dev)
+	{
+		fprintf(stderr, "%s: unknown device, use -m\n", name);
+		free(img);
+		return false;
+	}
+
+	memset(flash, 0xff, sizeof(flash));
+	shoff = get32(img + 32);
+	shentsize = get16(img + 46);
+	shnum = get16(img + 48);
+	for (i = 0; i < shnum && shoff + (i + 1) * shentsize <= (uint32_t)len; i++)
+	{
+		const uint8_t *sh = img + shoff + i * shentsize;
+		uint32_t type = get32(sh + 4), flags = get32(sh + 8), addr = get32(sh + 12);
+		uint32_t off = get32(sh + 16), size = get32(sh + 20);
+
+		if (type != SHT_NOBITS && off + size > (uint32_t)len)
+			continue;
+		if (flags & SHF_ALLOC)
+		{
+			if (addr >= DATA_OFFSET && addr + size <= DATA_OFFSET + 0x10000)		// RAM
+			{
+				if (type == SHT_NOBITS)
+					bss_size += size;				// .bss and .noinit
+				else
+				{
+					data_size += size;
+					memcpy(ram_init + addr - DATA_OFFSET, img + off, size);
+				}
+			}
+			else if (type != SHT_NOBITS && addr + size <= FLASH_MAX)
+				memcpy(flash + addr, img + off, size);
+		}
+		else if (type == SHT_SYMTAB)
+		{
+			const uint8_t *strsh = img + shoff + get32(sh + 24) * shentsize;	// sh_link
+			const char *str = (const char *)img + get32(strsh + 16);
+
+			for (j = 1; j < size / 16 && n_funcs < MAX_FUNCS; j++)
+			{
+				const uint8_t *st = img + off + j * 16;
+				const char *s = str + get32(st);
+
+				if (!*s || get16(st + 14) == 0 || (st[12] & 0x0f) != STT_FUNC || get32(st + 8) == 0)
+					continue;
+				funcs[n_funcs].name = strdup(s);
+				funcs[n_funcs].addr = get32(st + 4);
+				funcs[n_funcs].size = get32(st + 8);
+				funcs[n_funcs].frame = -1;
+				funcs[n_funcs].depth = -1;
+				funcs[n_funcs].next = -1;
+				n_funcs++;
+			}
+		}
+	}
+	free(img);
+	return true;
+}
+
+
+// The function starting at byte address a, -1 if none does
+static int
+func_at(uint32_t a)
+{
+	int i;
+
+	for (i = 0; i < n_funcs; i++)
+		if (funcs[i].addr == a)
+			return i;
+	return -1;
+}
+
+
+static int
+func_named(const char *name)
+{
+	int i;
+
+	for (i = 0; i < n_funcs; i++)
+		if (!strcmp(funcs[i].name, name))
+			return i;
+	return -1;
+}
+
+
+static void
+add_call(func_t *f, int callee, bool tail)
+{
+	int i;
+
+	for (i = 0; i < f->n_calls; i++)
+		if (f->calls[i] == callee)
+		{
+			f->tail[i] &= tail;
+			return;
+		}
+	if (f->n_calls < MAX_CALLS)
+	{
+		f->tail[f->n_calls] = tail;
+		f->calls[f->n_calls++] = callee;
+	}
+}
+
+
+// Calls, jumps to other functions, icall/ijmp and sei in the code of f. Function addresses loaded by an ldi pair
+// into a register pair mark that function as taken
+static void
+scan_code(func_t *f)
+{
+	int16_t ldi[32];				// value of the last ldi per register, -1 none
+	uint32_t w, end = (f->addr + f->size) / 2, target;
+	uint16_t op;
+	int i, g;
+	bool far;
+
+	for (i = 0; i < 32; i++)
+		ldi[i] = -1;
+	for (w = f->addr / 2; w < end; w++)
+	{
+		op = get16(flash + 2 * w);
+		far = (op & 0xfe0c) == 0x940c;			// call or jmp
+		target = UINT32_MAX;
+		if (far)
+			target = ((uint32_t)((op >> 3 & 0x3e) | (op & 1)) << 16 | get16(flash + 2 * (w + 1))) * 2;
+		else if ((op & 0xe000) == 0xc000)		// rcall, rjmp
+			target = (uint32_t)(w + 1 + ((int16_t)(op << 4) >> 4)) * 2 & (FLASH_MAX - 1);
+		else if (op == 0x9509 || op == 0x9519 || op == 0x9409 || op == 0x9419)
+			f->indirect = true;
+		else if (op == 0x9478)
+			f->sei = true;
+		else if ((op & 0xf000) == 0xe000)		// ldi
+		{
+			i = 16 + (op >> 4 & 0x0f);
+			ldi[i] = (op >> 4 & 0xf0) | (op & 0x0f);
+			if ((i & 1) && ldi[i - 1] >= 0 && (g = func_at((ldi[i] << 8 | ldi[i - 1]) * 2)) >= 0)
+				funcs[g].taken = true;
+		}
+
+		if (target != UINT32_MAX && (target < f->addr || target >= f->addr + f->size))	// not a branch inside
+		{
+			if ((g = func_at(target)) >= 0)
+				add_call(f, g, (op & 0xfe0e) == 0x940c || (op & 0xf000) == 0xc000);	// jmp and rjmp are tail calls
+		}
+		if (far || (op & 0xfc0f) == 0x9000)		// two words: call, jmp, lds, sts
+			w++;
+	}
+}
+
+
+// Function pointers in the initial .data, byte by byte, tables of pointers aren't aligned
+static void
+scan_data(void)
+{
+	uint32_t a;
+	int g;
+
+	for (a = dev->sram; a + 1 < dev->sram + data_size; a++)
+		if ((g = func_at(get16(ram_init + a) * 2)) >= 0 && g != func_named("main"))
+			funcs[g].taken = true;
+}
+
+
+// name.c:12:6:name<tab>bytes<tab>static
+static void
+read_su(const char *file)
+{
+	char line[512], *name, *p;
+	unsigned bytes;
+	FILE *f = fopen(file, "r");
+	int i;
+	size_t n;
+
+	if (!f)
+		return;
+	while (fgets(line, sizeof(line), f))
+	{
+		if ((p = strchr(line, '\t')) == NULL)
+			continue;
+		*p++ = 0;
+		bytes = strtoul(p, &p, 10);
+		name = strrchr(line, ':');
+		name = name ? name + 1 : line;
+		n = strlen(name);
+		for (i = 0; i < n_funcs; i++)		// static functions of the same name in two files get the larger frame
+		{
+			if (strncmp(funcs[i].name, name, n) || (funcs[i].name[n] && funcs[i].name[n] != '.'))
+				continue;
+			if ((int)bytes > funcs[i].frame)
+				funcs[i].frame = bytes;
+			if (strstr(p, "dynamic"))
+				funcs[i].dynamic = true;
+		}
+	}
+	fclose(f);
+}
+
+
+static int
+read_su_dir(const char *dir, int levels)
+{
+	char path[1024];
+	struct dirent *e;
+	DIR *d = opendir(dir);
+	size_t n;
+	int found = 0;
+
+	if (!d)
+		return 0;
+	while ((e = readdir(d)) != NULL)
+	{
+		if (e->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+		n = strlen(e->d_name);
+		if (n > 3 && !strcmp(e->d_name + n - 3, ".su"))
+		{
+			read_su(path);
+			found++;
+		}
+		else if (levels)
+			found += read_su_dir(path, levels - 1);
+	}
+	closedir(d);
+	return found;
+}
+
+
+static module_t *
+module(const char *file)
+{
+	const char *base = strrchr(file, '/');
+	const char *b2 = strrchr(file, '\\');
+	int i;
+
+	if (b2 > base)
+		base = b2;
+	base = base ? base + 1 : file;
+	for (i = 0; i < n_modules; i++)
+		if (!strcmp(modules[i].name, base))
+			return &modules[i];
+	if (n_modules == MAX_MODULES)
+		return NULL;
+	snprintf(modules[n_modules].name, sizeof(modules[0].name), "%.63s", base);
+	return &modules[n_modules++];
+}
+
+
+// The input sections in RAM of the memory map: " .bss.name  0x00800104  0x2 main.o", a long section name puts the
+// rest on the next line. The file name may hold blanks, it is what is left of the line
+static bool
+read_map(const char *file)
+{
+	char line[1024], section[256], rest[1024], obj[1024];
+	unsigned long addr, size;
+	bool pending = false;
+	module_t *m;
+	FILE *f = fopen(file, "r");
+
+	if (!f)
+		return false;
+	while (fgets(line, sizeof(line), f))
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if (!pending)
+		{
+			if (line[0] != ' ' || (line[1] != '.' && strncmp(line + 1, "COMMON", 6)))
+				continue;
+			if (sscanf(line, " %255s %1023[^\n]", section, rest) == 1)
+			{
+				pending = true;				// the numbers are on the next line
+				continue;
+			}
+		}
+		else
+			snprintf(rest, sizeof(rest), "%s", line);
+		pending = false;
+
+		if (sscanf(rest, " 0x%lx 0x%lx %1023[^\n]", &addr, &size, obj) != 3 || size == 0)
+			continue;
+		if (addr < DATA_OFFSET || addr >= DATA_OFFSET + 0x10000 || (m = module(obj)) == NULL)
+			continue;
+		if (!strncmp(section, ".bss", 4) || !strncmp(section, ".noinit", 7) || !strcmp(section, "COMMON"))
+			m->bss += size;
+		else
+			m->data += size;
+	}
+	fclose(f);
+	return true;
+}
+
+
+// Deepest stack from entering f on, its return address included
+static int
+depth(int i)
+{
+	func_t *f = &funcs[i];
+	int own = f->frame >= 0 ? f->frame : 2;		// no .su entry, only the return address
+	int c, d, g, k;
+
+	if (f->depth >= 0)
+		return f->depth;
+	if (f->busy)
+	{
+		f->recursive = true;
+		return 0;
+	}
+	f->busy = true;
+	f->depth = own;
+	for (c = 0; c < f->n_calls; c++)
+	{
+		d = depth(f->calls[c]);
+		if (!f->tail[c])
+			d += own;
+		if (d > f->depth)
+		{
+			f->depth = d;
+			f->next = f->calls[c];
+		}
+	}
+	if (f->indirect)
+		for (g = 0; g < n_funcs; g++)
+			if (funcs[g].taken && (k = depth(g) + own) > f->depth)
+			{
+				f->depth = k;
+				f->next = g;
+			}
+	f->busy = false;
+	return f->depth;
+}
+
+
+static const char *
+root_name(const func_t *f)
+{
+	static char buf[64];
+	int v;
+
+	if (strncmp(f->name, "__vector_", 9))
+		return f->name;
+	v = atoi(f->name + 9);
+	if (v > 0 && v < dev->n_vectors && dev->vectors[v][0])
+	{
+		snprintf(buf, sizeof(buf), "%s_vect", dev->vectors[v]);
+		return buf;
+	}
+	return f->name;
+}
+
+
+static void
+print_path(int i)
+{
+	int n = 0;
+
+	printf("%s", root_name(&funcs[i]));
+	for (i = funcs[i].next; i >= 0 && n < MAX_DEPTH; i = funcs[i].next, n++)
+		printf(" > %s%s", funcs[i].name, funcs[i].frame < 0 ? "?" : "");
+	printf("\n");
+}
+
+
+int
+main(int argc, char **argv)
+{
+	const char *device = NULL, *map = NULL, *su_dir = NULL, *elf;
+	char path[1024], *p;
+	int i, n_su, main_i, isr_worst = -1, worst_main, worst_isr = 0, ram, statics;
+	module_t total = { "", 0, 0 };
+	bool notes = false;
+
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+	{
+		if (!strcmp(argv[i], "-m"))
+			device = argv[i + 1];
+		else if (!strcmp(argv[i], "-M"))
+			map = argv[i + 1];
+		else if (!strcmp(argv[i], "-s"))
+			su_dir = argv[i + 1];
+		else
+			break;
+	}
+	if (i != argc - 1)
+	{
+		fprintf(stderr, "usage: %s [-m device] [-M file.map] [-s dir] file.elf\n", argv[0]);
+		return 1;
+	}
+	elf = argv[i];
+	if (!load_elf(elf, device))
+		return 1;
+	ram = dev->ramend - dev->sram + 1;
+
+	snprintf(path, sizeof(path), "%s", elf);
+	if ((p = strrchr(path, '/')) != NULL)
+		*p = 0;
+	else
+		strcpy(path, ".");
+	n_su = read_su_dir(su_dir ? su_dir : path, su_dir ? 0 : 2);
+
+	if (!map)
+	{
+		snprintf(path, sizeof(path), "%s", elf);
+		if ((p = strrchr(path, '.')) != NULL && !strcmp(p, ".elf"))
+			*p = 0;
+		strcat(path, ".map");
+		map = path;
+	}
+
+	printf("%s, %s: %d bytes of RAM\n\n", elf, dev->name, ram);
+	if (read_map(map) && n_modules)
+	{
+		printf("%-32s %6s %6s %6s\n", "static RAM by module", "data", "bss", "total");
+		for (i = 0; i < n_modules; i++)
+		{
+			printf("%-32s %6u %6u %6u\n", modules[i].name, modules[i].data, modules[i].bss,
+				modules[i].data + modules[i].bss);
+			total.data += modules[i].data;
+			total.bss += modules[i].bss;
+		}
+		printf("%-32s %6u %6u %6u\n\n", "all", total.data, total.bss, total.data + total.bss);
+	}
+	else
+		printf("no linker map %s, totals only: data %u, bss %u\n\n", map, data_size, bss_size);
+	statics = data_size + bss_size;
+
+	for (i = 0; i < n_funcs; i++)
+		scan_code(&funcs[i]);
+	scan_data();
+
+	main_i = func_named("main");
+	if (main_i < 0)
+	{
+		fprintf(stderr, "%s: no main\n", elf);
+		return 1;
+	}
+	if (n_su == 0)
+		printf("no .su files, build with -fstack-usage, only return addresses are counted\n\n");
+
+	printf("deepest stack, bytes with return addresses, ? no .su entry\n");
+	worst_main = depth(main_i);
+	printf("%6d  ", worst_main);
+	print_path(main_i);
+	for (i = 0; i < n_funcs; i++)
+	{
+		if (strncmp(funcs[i].name, "__vector_", 9) || !strcmp(funcs[i].name, "__vector_default"))
+			continue;
+		printf("%6d  ", depth(i));
+		print_path(i);
+		if (funcs[i].depth > worst_isr)
+		{
+			worst_isr = funcs[i].depth;
+			isr_worst = i;
+		}
+	}
+
+	printf("\nworst case: main %d", worst_main);
+	if (isr_worst >= 0)
+		printf(" + %s %d", root_name(&funcs[isr_worst]), worst_isr);
+	printf(" = %d bytes of stack\n", worst_main + worst_isr);
+	printf("left: %d RAM - %d static - %d stack = %d bytes\n", ram, statics, worst_main + worst_isr,
+		ram - statics - worst_main - worst_isr);
+
+	for (i = 0; i < n_funcs; i++)
+	{
+		func_t *f = &funcs[i];
+
+		if (f->depth < 0)					// not reached from main or an interrupt
+			continue;
+		if (!notes)
+			printf("\n");
+		notes = true;
+		if (f->recursive)
+			printf("note: %s is recursive, counted once\n", f->name);
+		if (f->dynamic)
+			printf("note: %s has a dynamic stack frame, -fstack-usage can't tell how big\n", f->name);
+		if (f->indirect)
+			printf("note: %s calls through a pointer, counted as the deepest function whose address is taken\n",
+				f->name);
+		if (f->sei && !strncmp(f->name, "__vector_", 9))
+			printf("note: %s enables the interrupts, nested interrupts are not added\n", root_name(f));
+		if (f->frame < 0 && n_su)
+			printf("note: %s has no .su entry, 2 bytes assumed\n", f->name);
+	}
+	return 0;
+}
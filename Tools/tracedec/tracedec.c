@@ -0,0 +1,256 @@
+/*
+ * tracedec.c
+ *
+ * Created: 10/19/2026
+ *
+ * Turns the event trace of a TRACE build (Common/trace.c) into a Chrome trace, the JSON that chrome://tracing and
+ * ui.perfetto.dev open. ISRs and main loop work come out as spans on one track, the CPU's, marks as instant events,
+ * so a late or long ISR shows where it happened. A table of the spans, how often, how long on average and at most and
+ * when the longest was, goes to stderr.
+ *
+ * The dump is the byte stream of the ring, as the USART of the IR switch sends it or the host simulator writes it
+ * (HostSim, -b). Reading starts at the first sync record, it gives the time unit, so a capture may start anywhere.
+ *
+ * Usage: tracedec [-n trace_ids.h] [-o out.json] dump ...
+ *	-n file			event names from the firmware's trace_ids.h, the TR_ defines, ids are numbered otherwise
+ *	-o file			write the JSON to file instead of stdout
+ *	dump			a trace dump, "-" for stdin, each one becomes a process of its own in the trace
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+// The record layout of Common/trace.h, the AVR headers of that can't come along
+#define TRACE_BEGIN_ID	0x00
+#define TRACE_END_ID	0x40
+#define TRACE_MARK_ID	0x80
+#define TRACE_KIND		0xC0
+#define TRACE_LOST		0xFE
+#define TRACE_SYNC		0xFF
+#define N_IDS			64
+
+typedef struct span
+{
+	uint64_t count, sum, max, max_at;	// timer ticks
+	uint64_t begin;
+	bool open;
+} span_t;
+
+static char *names[N_IDS];
+static span_t spans[N_IDS];
+static FILE *out;
+static bool first_event = true;
+
+
+// The TR_ defines of a trace_ids.h
+static void
+read_names(const char *file)
+{
+	char line[256], name[64];
+	unsigned id;
+	FILE *f;
+
+	if ((f = fopen(file, "r")) == NULL)
+	{
+		perror(file);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, " #define TR_%63s %u", name, &id) == 2 && id < N_IDS)
+			names[id] = strdup(name);
+	fclose(f);
+}
+
+
+static const char *
+name_of(uint8_t id)
+{
+	static char buf[16];
+
+	if (names[id])
+		return names[id];
+	sprintf(buf, "event%u", id);
+	return buf;
+}
+
+
+static void
+event(int pid, const char *name, char ph, double us, const char *args)
+{
+	fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":1%s%s}",
+		first_event ? "\n" : ",\n", name, ph, us, pid, args ? "," : "", args ? args : "");
+	first_event = false;
+}
+
+
+// A sync record: F_CPU in Mhz and a prescaler the timer can have
+static bool
+is_sync(const uint8_t *r)
+{
+	uint16_t prescale = r[2] | r[3] << 8;
+
+	return r[0] == TRACE_SYNC && r[1] >= 1 && r[1] <= 32
+		&& (prescale == 1 || prescale == 8 || prescale == 64 || prescale == 256 || prescale == 1024);
+}
+
+
+static void
+decode(FILE *f, const char *file, int pid)
+{
+	uint8_t r[4];
+	char args[64];
+	uint64_t t = 0;						// timer ticks since the first record
+	uint16_t last = 0;
+	double us_per_tick = 0;
+	bool synced = false, timed = false;
+	unsigned long records = 0, skipped = 0, lost = 0;
+	size_t n = 0;
+	span_t *s;
+	uint8_t id;
+	int c;
+
+	fprintf(out, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}",
+		first_event ? "\n" : ",\n", pid, file);
+	fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":1,\"args\":{\"name\":\"CPU\"}}", pid);
+	first_event = false;
+
+	while ((c = getc(f)) != EOF)
+	{
+		r[n++] = c;
+		if (n < sizeof(r))
+			continue;
+		if (!synced)
+		{
+			if (!is_sync(r))			// not on a record boundary yet, move on by a byte
+			{
+				memmove(r, r + 1, --n);
+				skipped++;
+				continue;
+			}
+			synced = true;
+		}
+		n = 0;
+		records++;
+
+		id = r[0];
+		if (id == TRACE_SYNC)
+		{
+			if (!is_sync(r))
+			{
+				synced = false;			// garbled, find the next one
+				continue;
+			}
+			us_per_tick = (double)(r[2] | r[3] << 8) / r[1];
+			continue;
+		}
+		if (id == TRACE_LOST)
+		{
+			lost += r[1];
+			sprintf(args, "\"s\":\"t\",\"args\":{\"n\":%u}", r[1]);
+			event(pid, "lost", 'i', t * us_per_tick, args);
+			continue;
+		}
+		if ((id & TRACE_KIND) == TRACE_KIND)
+		{
+			synced = false;
+			continue;
+		}
+
+		if (timed)
+			t += (uint16_t)((r[2] | r[3] << 8) - last);
+		last = r[2] | r[3] << 8;
+		timed = true;
+
+		s = &spans[id & (N_IDS - 1)];
+		switch (id & TRACE_KIND)
+		{
+			case TRACE_BEGIN_ID:
+				s->begin = t;
+				s->open = true;
+				event(pid, name_of(id & (N_IDS - 1)), 'B', t * us_per_tick, NULL);
+				break;
+
+			case TRACE_END_ID:
+				if (!s->open)			// began before the dump did
+					break;
+				s->open = false;
+				s->count++;
+				s->sum += t - s->begin;
+				if (t - s->begin >= s->max)
+				{
+					s->max = t - s->begin;
+					s->max_at = s->begin;
+				}
+				event(pid, name_of(id & (N_IDS - 1)), 'E', t * us_per_tick, NULL);
+				break;
+
+			case TRACE_MARK_ID:
+				sprintf(args, "\"s\":\"t\",\"args\":{\"v\":%u}", r[1]);
+				event(pid, name_of(id & (N_IDS - 1)), 'i', t * us_per_tick, args);
+				break;
+		}
+	}
+
+	fprintf(stderr, "%s: %lu records over %.3f s, %lu lost, %lu bytes skipped looking for a sync record\n", file,
+		records, t * us_per_tick / 1e6, lost, skipped);
+	fprintf(stderr, "%-20s %10s %10s %10s %12s\n", "span", "count", "avg us", "max us", "max at s");
+	for (id = 0; id < N_IDS; id++)
+	{
+		s = &spans[id];
+		if (s->count)
+			fprintf(stderr, "%-20s %10" PRIu64 " %10.1f %10.1f %12.6f\n", name_of(id), s->count,
+				(double)s->sum / s->count * us_per_tick, s->max * us_per_tick, s->max_at * us_per_tick / 1e6);
+	}
+	memset(spans, 0, sizeof(spans));
+}
+
+
+int
+main(int argc, char **argv)
+{
+	int i, pid = 0;
+	FILE *f;
+
+	out = stdout;
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; i++)
+	{
+		if (argv[i][1] == 'n' && i + 1 < argc)
+			read_names(argv[++i]);
+		else if (argv[i][1] == 'o' && i + 1 < argc)
+		{
+			if ((out = fopen(argv[++i], "w")) == NULL)
+			{
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else
+			break;
+	}
+	if (i == argc || (argv[i][0] == '-' && argv[i][1]))
+	{
+		fprintf(stderr, "usage: %s [-n trace_ids.h] [-o out.json] dump ...\n", argv[0]);
+		return 1;
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-") == 0)
+			f = stdin;
+		else if ((f = fopen(argv[i], "rb")) == NULL)
+		{
+			perror(argv[i]);
+			return 1;
+		}
+		decode(f, argv[i], ++pid);
+		if (f != stdin)
+			fclose(f);
+	}
+	fprintf(out, "\n]}\n");
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
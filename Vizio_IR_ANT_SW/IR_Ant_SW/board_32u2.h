@@ -0,0 +1,36 @@
+/*
+ * board_32u2.h
+ *
+ * Created: 10/19/2026
+ *
+ * ATmega32U2 board: IR receiver on PC7 (ICP1), LED1 on PD6, HWB button on PD7, servo on PB7 (OC0A)
+ *
+ * The receiver and the button pins are also INT4 and INT7, they wake the chip from power down. Only the low level
+ * interrupt works without a clock, both are set up for it in EICRB.
+ */
+
+#ifndef BOARD_32U2_H_
+#define BOARD_32U2_H_
+
+#define BOARD_LED_PORT		PORTD
+#define BOARD_LED_DDR		DDRD
+#define BOARD_LED			_BV(6)
+
+#define BOARD_BUTTON_PIN	PIND		// low while pressed
+#define BOARD_BUTTON_DDR	DDRD
+#define BOARD_BUTTON		_BV(7)
+#define BOARD_WAKE_EICR		EICRB
+
+#define BOARD_BUTTON_WAKE_vect	INT7_vect
+#define BOARD_BUTTON_WAKE		_BV(INT7)
+#define BOARD_BUTTON_WAKE_ISC	(_BV(ISC71) | _BV(ISC70))
+
+#define BOARD_IR_PORT		PORTC		// receiver output, pulled up
+#define BOARD_IR_DDR		DDRC
+#define BOARD_IR_PIN		PINC
+#define BOARD_IR			_BV(7)
+#define BOARD_IR_WAKE_vect	INT4_vect
+#define BOARD_IR_WAKE		_BV(INT4)
+#define BOARD_IR_WAKE_ISC	(_BV(ISC41) | _BV(ISC40))
+
+#endif /* BOARD_32U2_H_ */
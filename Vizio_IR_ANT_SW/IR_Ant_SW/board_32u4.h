@@ -0,0 +1,23 @@
+/*
+ * board_32u4.h
+ *
+ * Created: 10/19/2026
+ *
+ * ATmega32U4 board: IR receiver on PD4 (ICP1, it was on PD0/INT0 before), LED1 on PB0, servo on PB7 (OC0A).
+ * No button. PD4 is no external interrupt pin, the board can only idle and not power down. With IR_TX (ir_send.h)
+ * an IR LED on PC6 (OC3A) through a transistor.
+ */
+
+#ifndef BOARD_32U4_H_
+#define BOARD_32U4_H_
+
+#define BOARD_LED_PORT		PORTB
+#define BOARD_LED_DDR		DDRB
+#define BOARD_LED			_BV(0)
+
+#define BOARD_IR_PORT		PORTD		// receiver output, pulled up
+#define BOARD_IR_DDR		DDRD
+#define BOARD_IR_PIN		PIND
+#define BOARD_IR			_BV(4)
+
+#endif /* BOARD_32U4_H_ */
@@ -0,0 +1,217 @@
+/*
+ * ir_capture.c
+ *
+ * Created: 10/19/2026
+ *
+ * Writes every received IR sequence as one text line to USART1 (57600 8N1 on TXD1, PD3), for looking at unknown
+ * remotes and for recording traces that Tools/irbench replays into the decoder on a PC. The format:
+ *
+ *	L9000 H4500 L560 H560 L560 H1690 ... L560
+ *
+ * L is a low part (carrier on), H a high part, in us. A line ends at the pause after the sequence. Lines starting
+ * with # are notes from the firmware, e.g. "# wake-to-decode 86" in ms.
+ *
+ * The main loop hands over every entry it takes from the capture queue. They are collected until the pause, then the
+ * line goes out one character per main loop pass whenever the USART is free, nothing here ever waits. Sequences that
+ * arrive while a line is still going out are dropped up to the next pause, as are the entries that don't fit into the
+ * buffer.
+ *
+ * The TRACE build sends the event trace instead, the records as Trace_Byte() (Common/trace.c) hands them out, at
+ * 250000 baud. Tools/tracedec reads what a terminal program saved.
+ */
+#include "ir_capture.h"
+
+#ifdef IR_USART
+
+#include <avr/io.h>
+#include "ir_decode.h"
+#include "trace_ids.h"
+
+#ifndef F_CPU
+#define F_CPU			16000000UL
+#endif
+
+static bool capture_tx;				// a character may still be shifting out
+
+
+static void
+IR_CapturePut(char c)
+{
+	UCSR1A = _BV(U2X1) | _BV(TXC1);		// clears TXC1
+	UDR1 = c;
+	capture_tx = true;
+}
+
+#endif // IR_USART
+
+
+#ifdef IR_CAPTURE
+#define N_CAPTURES		140			// entries, 2 whole NEC frames
+#define UBRR_VALUE		((F_CPU / 8 + IR_CAPTURE_BAUD / 2) / IR_CAPTURE_BAUD - 1)	// double speed
+
+static uint16_t capture_data[N_CAPTURES];
+static uint8_t capture_length;		// entries collected
+static uint8_t capture_index;		// next entry to send
+#define CAP_COLLECT		0
+#define CAP_SEND		1
+#define CAP_SKIP		2			// sent, the rest of the sequence that came meanwhile is dropped
+
+static uint8_t capture_state;
+static char capture_text[8];		// the entry going out, from the end
+static uint8_t capture_text_ndx;
+static char capture_note[32];
+static uint8_t capture_note_len, capture_note_ndx;
+
+
+void
+IR_CaptureInit(void)
+{
+	UBRR1 = UBRR_VALUE;
+	UCSR1A = _BV(U2X1);
+	UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);		// 8N1
+	UCSR1B = _BV(TXEN1);
+}
+
+
+void
+IR_CaptureEdge(uint16_t e)
+{
+	if ((e & IR_TIME) == IR_TIME)			// the pause, the line is complete
+	{
+		if (capture_state == CAP_SKIP)
+			capture_state = CAP_COLLECT;
+		else if (capture_state == CAP_COLLECT && capture_length)
+		{
+			capture_index = 0;
+			capture_text_ndx = 0;
+			capture_state = CAP_SEND;
+		}
+	}
+	else if (capture_state == CAP_COLLECT && capture_length < N_CAPTURES)
+		capture_data[capture_length++] = e;
+}
+
+
+// Formats the next entry backwards into capture_text, false when the line is done
+static bool
+IR_CaptureNext(void)
+{
+	uint16_t e, us;
+	uint8_t n = 0;
+
+	if (capture_index == capture_length)
+		return false;
+	e = capture_data[capture_index++];
+	us = (e & IR_TIME) / IR_TICKS_PER_US;
+
+	capture_text[n++] = capture_index == capture_length ? '\n' : ' ';
+	do
+	{
+		capture_text[n++] = '0' + us % 10;
+		us /= 10;
+	} while (us);
+	capture_text[n++] = (e & IR_HIGH) ? 'H' : 'L';
+	capture_text_ndx = n;
+	return true;
+}
+
+
+// A "# label value" line, sent between two sequence lines. Dropped while the one before is still waiting
+void
+IR_CaptureNote(const char *label, uint16_t value)
+{
+	uint8_t n = 0, i;
+	char digits[5];
+
+	if (capture_note_len)
+		return;
+	capture_note[n++] = '#';
+	capture_note[n++] = ' ';
+	while (*label && n < sizeof(capture_note) - 8)
+		capture_note[n++] = *label++;
+	capture_note[n++] = ' ';
+	i = 0;
+	do
+	{
+		digits[i++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	while (i)
+		capture_note[n++] = digits[--i];
+	capture_note[n++] = '\n';
+	capture_note_ndx = 0;
+	capture_note_len = n;
+}
+
+
+// Something still to send or going out, the USART stops in power down
+bool
+IR_CaptureBusy(void)
+{
+	if (capture_tx && (UCSR1A & _BV(TXC1)))
+		capture_tx = false;
+	return capture_state == CAP_SEND || capture_note_len || capture_tx;
+}
+
+
+// One character if the USART can take it
+void
+IR_CapturePoll(void)
+{
+	if (!(UCSR1A & _BV(UDRE1)))
+		return;
+	if (capture_note_ndx < capture_note_len && (capture_note_ndx || capture_state != CAP_SEND))
+	{
+		IR_CapturePut(capture_note[capture_note_ndx++]);	// a note goes between two lines
+		if (capture_note_ndx == capture_note_len)
+			capture_note_len = capture_note_ndx = 0;
+		return;
+	}
+	if (capture_state != CAP_SEND)
+		return;
+	if (capture_text_ndx == 0 && !IR_CaptureNext())
+	{
+		capture_length = 0;
+		capture_state = CAP_SKIP;
+		return;
+	}
+	IR_CapturePut(capture_text[--capture_text_ndx]);
+}
+
+#elif defined(TRACE)
+
+#define UBRR_VALUE		((F_CPU / 8 + TRACE_BAUD / 2) / TRACE_BAUD - 1)	// double speed
+
+
+void
+IR_CaptureInit(void)
+{
+	UBRR1 = UBRR_VALUE;
+	UCSR1A = _BV(U2X1);
+	UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);		// 8N1
+	UCSR1B = _BV(TXEN1);
+	TRACE_INIT();
+}
+
+
+// Records still to send or a byte going out, the USART stops in power down
+bool
+IR_CaptureBusy(void)
+{
+	if (capture_tx && (UCSR1A & _BV(TXC1)))
+		capture_tx = false;
+	return Trace_Busy() || capture_tx;
+}
+
+
+// One byte of the trace if the USART can take it
+void
+IR_CapturePoll(void)
+{
+	uint8_t c;
+
+	if ((UCSR1A & _BV(UDRE1)) && Trace_Byte(&c))
+		IR_CapturePut(c);
+}
+
+#endif // IR_CAPTURE
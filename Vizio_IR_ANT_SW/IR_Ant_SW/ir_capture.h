@@ -0,0 +1,38 @@
+/*
+ * ir_capture.h
+ *
+ * Created: 10/19/2026
+ *
+ * Debug dump of the received IR sequences on the USART1 TXD1 pin (PD3), or of the event trace, see ir_capture.c
+ */
+
+#ifndef IR_CAPTURE_H_
+#define IR_CAPTURE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// Uncomment here or define it in the project's compiler symbols. Costs about 300 bytes of RAM
+//#define IR_CAPTURE
+
+#define IR_CAPTURE_BAUD		57600
+
+// The event trace on the USART instead, see trace_ids.h. Costs about 140 bytes of RAM
+//#define TRACE
+
+#define TRACE_BAUD			250000		// exact at 16Mhz
+
+#if defined(IR_CAPTURE) && defined(TRACE)
+#error "IR_CAPTURE and TRACE both send on USART1, pick one"
+#endif
+#if defined(IR_CAPTURE) || defined(TRACE)
+#define IR_USART					// IR_CaptureInit(), IR_CapturePoll() and IR_CaptureBusy() drive USART1
+#endif
+
+void IR_CaptureInit(void);
+void IR_CaptureEdge(uint16_t e);
+void IR_CapturePoll(void);
+void IR_CaptureNote(const char *label, uint16_t value);
+bool IR_CaptureBusy(void);
+
+#endif /* IR_CAPTURE_H_ */
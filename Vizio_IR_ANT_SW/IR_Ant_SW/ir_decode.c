@@ -0,0 +1,388 @@
+/*
+ * ir_decode.c
+ *
+ * Created: 10/19/2026
+ *
+ * Table driven IR remote decoder, all protocols decode in parallel from the same stream of low and high times.
+ *
+ * Every timing any protocol uses is a window in ir_windows[], its nominal length with the tolerance of that protocol.
+ * The length of each low or high part is matched against all windows once, that gives a bit mask, and the protocols
+ * only test bits of it. ir_protocols[] describes each protocol by the windows of its header and of its 0 and 1 bits,
+ * how the bits are encoded and how many there are. A protocol that is waiting for its header costs one bit test per
+ * edge, so adding one to the table adds next to nothing to the work per edge.
+ *
+ * Encodings:
+ *	pulse distance (NEC)	the high part after each low tells the bit
+ *	pulse width (SIRC)		the low part tells the bit
+ *	Manchester (RC5)		every bit is two half bits, high low == 1 and low high == 0. No header, the first start bit
+ *							is a 1, its high half is lost in the pause before it
+ * A frame is complete at the pause after it (IR_TIME or a high of IR_GAP or more) with exactly the right number of
+ * bits, so SIRC12/15/20 can share their timings and only the one with the right length takes the frame.
+ *
+ * NEC sends each byte followed by its inverse. Every 16 bits the last pair is checked and the frame is dropped right
+ * there when it doesn't match, it never reaches the caller. A held NEC button sends a short repeat frame every 108 ms
+ * instead of the code, it repeats the last good frame, see IR_HOLD_REPEAT for when that is reported.
+ *
+ * Plain C without AVR headers so it also builds for a host. The tables are const, they end up in RAM on the AVR for
+ * the faster loads, about 100 bytes.
+ */
+#include "ir_decode.h"
+
+#define W_NEC_HDR_MARK		0
+#define W_NEC_HDR_SPACE		1
+#define W_NEC_BIT			2	// low of every bit, high of a 0
+#define W_NEC_ONE			3	// high of a 1
+#define W_SIRC_HDR			4
+#define W_SIRC_T			5	// high of every bit, low of a 0
+#define W_SIRC_2T			6	// low of a 1
+#define W_RC5_T				7	// one half bit
+#define W_RC5_2T			8	// two half bits of the same level
+#define W_NEC_REPEAT		9	// high of the repeat frame header
+#define IR_N_WINDOWS		10
+#define W_NONE				0xff
+
+#define NEC_TOL		25			// percent
+#define SIRC_TOL	20
+#define RC5_TOL		25
+
+#define IR_WINDOW(us, tol)	{ (uint16_t)((us) * IR_TICKS_PER_US * (100UL - (tol)) / 100), \
+							  (uint16_t)((us) * IR_TICKS_PER_US * (100UL + (tol)) / 100) }
+
+typedef struct ir_window
+{
+	uint16_t min, max;			// ticks
+} ir_window_t;
+
+static const ir_window_t ir_windows[IR_N_WINDOWS] =
+{
+	[W_NEC_HDR_MARK]	= IR_WINDOW(9000, NEC_TOL),
+	[W_NEC_HDR_SPACE]	= IR_WINDOW(4500, NEC_TOL),
+	[W_NEC_BIT]			= IR_WINDOW(560, NEC_TOL),
+	[W_NEC_ONE]			= IR_WINDOW(1690, NEC_TOL),
+	[W_SIRC_HDR]		= IR_WINDOW(2400, SIRC_TOL),
+	[W_SIRC_T]			= IR_WINDOW(600, SIRC_TOL),
+	[W_SIRC_2T]			= IR_WINDOW(1200, SIRC_TOL),
+	[W_RC5_T]			= IR_WINDOW(889, RC5_TOL),
+	[W_RC5_2T]			= IR_WINDOW(1778, RC5_TOL),
+	[W_NEC_REPEAT]		= IR_WINDOW(2250, NEC_TOL),
+};
+
+#define PULSE_DISTANCE	0
+#define PULSE_WIDTH		1
+#define MANCHESTER		2
+
+typedef struct ir_protocol
+{
+	uint8_t encoding;
+	uint8_t hdr_mark, hdr_space;	// windows of the header, W_NONE for none
+	uint8_t hdr_repeat;				// header high of a repeat frame, W_NONE for none
+	uint8_t mark0, space0;			// windows of a 0 bit, Manchester: the half bit
+	uint8_t mark1, space1;			// windows of a 1 bit, Manchester: two half bits
+	uint8_t bits;
+	bool msb_first;
+	uint8_t inverse;				// bit n set: bits 16n..16n+15 are a byte and its inverse, LSB first only
+} ir_protocol_t;
+
+#ifdef IR_NEC_EXTENDED
+#define NEC_INVERSE		0x02		// 16 bit address, only the command has its inverse
+#else
+#define NEC_INVERSE		0x03
+#endif
+
+static const ir_protocol_t ir_protocols[IR_N_PROTOCOLS] =
+{
+	[IR_NEC]	= { PULSE_DISTANCE, W_NEC_HDR_MARK, W_NEC_HDR_SPACE, W_NEC_REPEAT,
+					W_NEC_BIT, W_NEC_BIT, W_NEC_BIT, W_NEC_ONE, 32, false, NEC_INVERSE },
+	[IR_SIRC12]	= { PULSE_WIDTH, W_SIRC_HDR, W_SIRC_T, W_NONE,
+					W_SIRC_T, W_SIRC_T, W_SIRC_2T, W_SIRC_T, 12, false, 0 },
+	[IR_SIRC15]	= { PULSE_WIDTH, W_SIRC_HDR, W_SIRC_T, W_NONE,
+					W_SIRC_T, W_SIRC_T, W_SIRC_2T, W_SIRC_T, 15, false, 0 },
+	[IR_SIRC20]	= { PULSE_WIDTH, W_SIRC_HDR, W_SIRC_T, W_NONE,
+					W_SIRC_T, W_SIRC_T, W_SIRC_2T, W_SIRC_T, 20, false, 0 },
+	[IR_RC5]	= { MANCHESTER, W_NONE, W_NONE, W_NONE,
+					W_RC5_T, W_RC5_T, W_RC5_2T, W_RC5_2T, 14, true, 0 },
+};
+
+#define ST_IDLE		0		// waiting for the header
+#define ST_HEADER	1		// header low seen
+#define ST_BITS		2
+#define ST_DONE		3		// all bits there, waiting for the pause
+
+#define HALF_NONE	0		// Manchester: no half bit pending
+#define HALF_LOW	1
+#define HALF_HIGH	2
+
+#define SEQ_NONE		0		// what the sequence since the last pause was so far: nothing yet
+#define SEQ_STARTED		1		// some protocol got past its header
+#define SEQ_REJECTED	2		// counted as rejected already
+#define SEQ_REPEAT		3		// a repeat frame header
+
+typedef struct ir_state
+{
+	uint8_t state;
+	uint8_t bits;
+	uint8_t half;
+	bool repeat;				// ST_DONE for a repeat frame
+	uint8_t hold;				// repeat frames to the next report, 0: no good frame to repeat
+	uint32_t code;
+	uint32_t last;				// the last good frame
+} ir_state_t;
+
+static ir_state_t ir_states[IR_N_PROTOCOLS];
+static bool ir_after_gap = true;		// the last entry was a pause
+static uint8_t ir_seq;
+uint16_t IR_malformed;
+uint16_t IR_accepted;
+uint16_t IR_rejected;
+uint16_t IR_repeats;
+
+
+#define W(n)	((uint16_t)1 << (n))
+
+
+static void
+ir_bit(const ir_protocol_t *p, ir_state_t *s, bool one)
+{
+	if (p->msb_first)
+		s->code = (s->code << 1) | one;
+	else
+	{
+		s->code >>= 1;					// right aligned once the frame is complete
+		if (one)
+			s->code |= 0x80000000UL;
+	}
+	if (++s->bits == p->bits)
+		s->state = ST_DONE;
+}
+
+
+// After every 16 bits: are the last two bytes a byte and its inverse, if the protocol wants them to be
+static bool
+ir_inverse_ok(const ir_protocol_t *p, const ir_state_t *s)
+{
+	uint16_t pair = s->code >> 16;			// LSB first, the last 16 bits are the top ones
+
+	if ((s->bits & 15) || !(p->inverse & (1 << ((s->bits - 1) >> 4))))
+		return true;
+	return (uint8_t)pair == (uint8_t)~(pair >> 8);
+}
+
+
+// n half bits of one level, false if that breaks the Manchester code
+static bool
+ir_halves(const ir_protocol_t *p, ir_state_t *s, uint8_t level, uint8_t n)
+{
+	while (n--)
+	{
+		if (s->state == ST_DONE)
+			return false;
+		if (s->half == HALF_NONE)
+			s->half = level;
+		else if (s->half == level)
+			return false;
+		else
+		{
+			ir_bit(p, s, s->half == HALF_HIGH);
+			s->half = HALF_NONE;
+		}
+	}
+	return true;
+}
+
+
+// One low or high time for one protocol. false when the protocol drops out
+static bool
+ir_step(const ir_protocol_t *p, ir_state_t *s, uint16_t m, bool high)
+{
+	uint8_t w0, w1;
+
+	switch (s->state)
+	{
+		case ST_IDLE:
+			if (high)
+				return true;
+			if (p->encoding == MANCHESTER)
+			{
+				if (!ir_after_gap || !(m & (W(p->mark0) | W(p->mark1))))
+					return true;
+				s->bits = 0;
+				s->code = 0;
+				s->half = HALF_HIGH;			// the first half of the first start bit
+				s->state = ST_BITS;
+				return ir_halves(p, s, HALF_LOW, (m & W(p->mark1)) ? 2 : 1);
+			}
+			if (m & W(p->hdr_mark))
+				s->state = ST_HEADER;
+			return true;
+
+		case ST_HEADER:
+			if (!high)
+				return false;
+			if (m & W(p->hdr_space))
+			{
+				s->bits = 0;
+				s->code = 0;
+				s->repeat = false;
+				s->state = ST_BITS;
+				return true;
+			}
+			if (p->hdr_repeat != W_NONE && (m & W(p->hdr_repeat)))
+			{
+				s->repeat = true;				// only the final low follows
+				s->state = ST_DONE;
+				ir_seq = SEQ_REPEAT;
+				return true;
+			}
+			return false;
+
+		case ST_BITS:
+			if (p->encoding == MANCHESTER)
+			{
+				if (m & W(p->mark1))
+					return ir_halves(p, s, high ? HALF_HIGH : HALF_LOW, 2);
+				if (m & W(p->mark0))
+					return ir_halves(p, s, high ? HALF_HIGH : HALF_LOW, 1);
+				return false;
+			}
+			w0 = high ? p->space0 : p->mark0;
+			w1 = high ? p->space1 : p->mark1;
+			if (w0 == w1)						// the part that carries no data
+				return (m & W(w0)) != 0;
+			if (m & W(w0))
+				ir_bit(p, s, false);
+			else if (m & W(w1))
+				ir_bit(p, s, true);
+			else
+				return false;
+			if (!ir_inverse_ok(p, s))
+			{
+				IR_rejected++;						// no need to wait for the rest of it
+				ir_seq = SEQ_REJECTED;
+				return false;
+			}
+			return true;
+
+		default:								// ST_DONE, pulse distance ends with one more low
+			return !high && p->encoding == PULSE_DISTANCE && (m & W(p->mark0));
+	}
+}
+
+
+// At the pause after a sequence: the frame of a protocol that has all its bits, or a repeat of the last one
+static bool
+ir_end(const ir_protocol_t *p, ir_state_t *s, ir_frame_t *frame)
+{
+	if (s->state == ST_BITS && p->encoding == MANCHESTER && s->half == HALF_LOW)
+		ir_bit(p, s, false);				// the high half of a last 0 is in the pause
+	if (s->state != ST_DONE)
+		return false;
+
+	if (s->repeat)
+	{
+		if (s->hold == 0)					// nothing to repeat, the first frame was lost or rejected
+			return false;
+		IR_repeats++;
+		if (!IR_HOLD_REPEAT || --s->hold)
+			return false;
+		s->hold = IR_HOLD_EVERY;
+	}
+	else
+	{
+		s->last = s->code;
+		if (!p->msb_first)
+			s->last >>= 32 - p->bits;
+		s->hold = IR_HOLD_DELAY;
+		IR_accepted++;
+	}
+	frame->bits = p->bits;
+	frame->code = s->last;
+	frame->repeat = s->repeat;
+	return true;
+}
+
+
+void
+IR_DecodeReset(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < IR_N_PROTOCOLS; i++)
+	{
+		ir_states[i].state = ST_IDLE;
+		ir_states[i].hold = 0;
+	}
+	ir_after_gap = false;			// somewhere inside a sequence, wait for the next pause
+	ir_seq = SEQ_NONE;
+}
+
+
+// The entry is a pause, frames end there
+static bool
+ir_pause(uint16_t e)
+{
+	uint16_t t = e & IR_TIME;
+
+	return (e & IR_HIGH) && (t == IR_TIME || t >= IR_GAP);
+}
+
+
+// An entry of the capture queue the caller doesn't want decoded, e.g. the switch's own IR LED. The sequence it is in
+// is dropped without counting it malformed, and the last good frame stays there for the repeats that follow
+void
+IR_DecodeDrop(uint16_t e)
+{
+	uint8_t i;
+
+	for (i = 0; i < IR_N_PROTOCOLS; i++)
+		ir_states[i].state = ST_IDLE;
+	ir_seq = SEQ_NONE;
+	ir_after_gap = ir_pause(e);		// the next sequence decodes after a pause, otherwise wait for one
+}
+
+
+// Feeds one entry of the capture queue, true when frame holds a complete frame
+bool
+IR_Decode(uint16_t e, ir_frame_t *frame)
+{
+	uint16_t t = e & IR_TIME;
+	bool high = (e & IR_HIGH) != 0;
+	uint16_t m = 0;
+	bool found = false;
+	uint8_t i;
+
+	if (ir_pause(e))		// pause, frames end here
+	{
+		for (i = 0; i < IR_N_PROTOCOLS; i++)
+		{
+			if (!found && ir_states[i].state != ST_IDLE && ir_end(&ir_protocols[i], &ir_states[i], frame))
+			{
+				frame->protocol = i;
+				found = true;
+			}
+			ir_states[i].state = ST_IDLE;
+		}
+		if (ir_seq == SEQ_STARTED && !found)
+			IR_malformed++;
+		if (ir_seq == SEQ_STARTED || ir_seq == SEQ_REJECTED)	// something else came between a frame and its repeats
+			for (i = 0; i < IR_N_PROTOCOLS; i++)
+				if (!found || i != frame->protocol)
+					ir_states[i].hold = 0;
+		ir_seq = SEQ_NONE;
+		ir_after_gap = true;
+		return found;
+	}
+
+	for (i = 0; i < IR_N_WINDOWS; i++)			// the timing is classified once for all protocols
+		if (t >= ir_windows[i].min && t <= ir_windows[i].max)
+			m |= W(i);
+
+	for (i = 0; i < IR_N_PROTOCOLS; i++)
+	{
+		if (!ir_step(&ir_protocols[i], &ir_states[i], m, high))
+			ir_states[i].state = ST_IDLE;
+		else if (ir_states[i].state >= ST_BITS && ir_seq == SEQ_NONE)
+			ir_seq = SEQ_STARTED;
+	}
+	ir_after_gap = false;
+	return false;
+}
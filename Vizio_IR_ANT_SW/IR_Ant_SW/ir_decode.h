@@ -0,0 +1,58 @@
+/*
+ * ir_decode.h
+ *
+ * Created: 10/19/2026
+ *
+ * Table driven IR remote decoder for NEC, Sony SIRC and Philips RC5. See ir_decode.c
+ */
+
+#ifndef IR_DECODE_H_
+#define IR_DECODE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// The decoder is fed the length of every low (carrier on) and high (carrier off) part of the receiver output
+#define IR_TICKS_PER_US	2					// Timer1 at clk/8
+#define IR_TICKS_US(us)	((us) * IR_TICKS_PER_US)
+#define IR_HIGH			0x8000				// the entry is a high part
+#define IR_TIME			0x7fff				// length in ticks, IR_TIME itself == end of a sequence, no edge since
+#define IR_GAP			IR_TICKS_US(8000U)	// a high part this long ends the sequence as well
+#define IR_TIMEOUT		IR_TICKS_US(16000U)	// no edge for this long, the receiver queues IR_TIME, less than IR_TIME
+
+// protocols, the index into the protocol table
+#define IR_NEC			0		// 32 bits, address, ~address, command, ~command LSB first
+#define IR_SIRC12		1		// 7 bit command, 5 bit address LSB first
+#define IR_SIRC15		2		// 7 bit command, 8 bit address
+#define IR_SIRC20		3		// 7 bit command, 5 bit address, 8 bit extension
+#define IR_RC5			4		// 14 bits MSB first: 2 start bits, toggle, 5 bit address, 6 bit command
+#define IR_N_PROTOCOLS	5
+
+//#define IR_NEC_EXTENDED		// NEC remotes with a 16 bit address, only the command byte is checked against its inverse
+
+// A held NEC button: 0 reports the press once, 1 reports it again as a frame with repeat set. Repeat frames come every
+// 108 ms, the first report is after IR_HOLD_DELAY of them, then after every IR_HOLD_EVERY. Both at least 1
+#ifndef IR_HOLD_REPEAT
+#define IR_HOLD_REPEAT	0
+#endif
+#define IR_HOLD_DELAY	5		// about half a second
+#define IR_HOLD_EVERY	2
+
+typedef struct ir_frame
+{
+	uint8_t protocol;
+	uint8_t bits;
+	bool repeat;				// a held button, code is the frame before
+	uint32_t code;				// first bit received in bit 0 for LSB first protocols, in bit (bits-1) otherwise
+} ir_frame_t;
+
+extern uint16_t IR_malformed;	// sequences that started like a frame but none of the protocols took
+extern uint16_t IR_accepted;	// complete frames, repeats not included
+extern uint16_t IR_rejected;	// NEC frames dropped for a byte that doesn't match its inverse
+extern uint16_t IR_repeats;		// repeat frames of a good frame, reported or not
+
+void IR_DecodeReset(void);
+bool IR_Decode(uint16_t e, ir_frame_t *frame);
+void IR_DecodeDrop(uint16_t e);
+
+#endif /* IR_DECODE_H_ */
@@ -0,0 +1,74 @@
+/*
+ * ir_ring.h
+ *
+ * Created: 10/19/2026
+ *
+ * Queue of IR edge timings from the capture interrupt to the decoder in the main loop.
+ * One producer, the interrupt, and one consumer, the main loop. Each side only ever writes its own single byte index,
+ * so neither has to turn the interrupts off. An entry is the length of one mark (receiver output low) or space (high)
+ * in Timer1 ticks, IR_HIGH set for a space, see ir_decode.h.
+ *
+ * The queue lives in the header, it is only included by the file with the capture interrupt.
+ */
+
+#ifndef IR_RING_H_
+#define IR_RING_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "ir_decode.h"				// IR_HIGH, IR_TIME
+
+#define IR_RING_SIZE	64			// entries, a power of 2. A whole NEC frame is 67
+
+static volatile uint16_t ir_ring[IR_RING_SIZE];
+static volatile uint8_t ir_ring_head;		// written by the interrupt only
+static volatile uint8_t ir_ring_tail;		// written by the main loop only
+volatile uint8_t IR_overruns;				// edges dropped for a full queue
+
+
+// Interrupt side
+static inline void
+IR_Push(uint16_t e)
+{
+	uint8_t head = ir_ring_head;
+
+	if ((uint8_t)(head - ir_ring_tail) >= IR_RING_SIZE)
+	{
+		IR_overruns++;
+		return;
+	}
+	ir_ring[head & (IR_RING_SIZE-1)] = e;
+	ir_ring_head = head + 1;		// after the entry, the main loop may take it from here on
+}
+
+
+// Main loop side, false if empty
+static inline bool
+IR_Pop(uint16_t *e)
+{
+	uint8_t tail = ir_ring_tail;
+
+	if (tail == ir_ring_head)
+		return false;
+	*e = ir_ring[tail & (IR_RING_SIZE-1)];
+	ir_ring_tail = tail + 1;		// after the entry was read, the interrupt may reuse the slot
+	return true;
+}
+
+
+// Main loop side, nothing queued
+static inline bool
+IR_Empty(void)
+{
+	return ir_ring_tail == ir_ring_head;
+}
+
+
+// Main loop side, drops everything queued
+static inline void
+IR_Flush(void)
+{
+	ir_ring_tail = ir_ring_head;
+}
+
+#endif /* IR_RING_H_ */
@@ -0,0 +1,154 @@
+/*
+ * ir_send.c
+ *
+ * Created: 10/19/2026
+ *
+ * IR_TX (ir_send.h): NEC frames out on an IR LED at PC6 (OC3A) of the 32U4 board, with a driver transistor.
+ *
+ * Two timers and no bit-banging. Timer3 makes the 38kHz carrier as fast PWM from the CPU clock, a 3rd of each period
+ * on, the pin only gets it while COM3A connects it. The marks and spaces come from OCR1B of Timer1, the same free
+ * running 0.5us timer the receiver captures its edges with. IR_SendNEC() works out the whole frame as a list of
+ * durations, then the compare B interrupt runs once per mark or space: carrier on or off, OCR1B on by the next
+ * duration. OCR1B moves on from where it was, not from when the interrupt ran, so the latency of the interrupt only
+ * shifts an edge and never adds up. A mark starts with Timer3 at TOP, its first carrier pulse is a whole one.
+ *
+ * Receiving goes on meanwhile, the capture and the timeout on OCR1A don't change and the compare B interrupt is a few
+ * us. The receiver sees the LED as well, IR_SendEcho() tells main.c to drop what it captures while a frame goes out and
+ * until the receiver timed out on its end: one more compare B interrupt, IR_TX_ECHO after the last mark, ends that.
+ * A NEC remote's repeat frames come every 108ms, a relayed one and its echo are over 60ms after the remote's started.
+ * A relayed full frame goes out over the remote's first repeat, that one is lost, the ones after it come through.
+ * Timer3 only runs while a frame goes out.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "ir_decode.h"
+#include "ir_send.h"
+#include "trace_ids.h"
+
+#ifdef IR_TX
+
+#ifndef F_CPU
+#define F_CPU			16000000UL
+#endif
+#define IR_TX_TOP		(F_CPU / IR_TX_HZ - 1)		// ICR3, 420 == 37.9kHz
+#define IR_TX_LEAD		IR_TICKS_US(20)				// from IR_SendNEC() to the first mark
+#define TX_CARRIER_ON	(_BV(COM3A1) | _BV(WGM31))	// fast PWM, TOP == ICR3, OC3A set at BOTTOM
+#define TX_CARRIER_OFF	_BV(WGM31)					// OC3A disconnected, the PORT bit keeps the LED off
+
+// NEC in Timer1 ticks
+#define NEC_HDR_MARK	IR_TICKS_US(9000U)
+#define NEC_HDR_SPACE	IR_TICKS_US(4500U)
+#define NEC_RPT_SPACE	IR_TICKS_US(2250U)
+#define NEC_BIT_MARK	(IR_TICKS_US(1125U) / 2)		// 562.5us
+#define NEC_ZERO_SPACE	(IR_TICKS_US(1125U) / 2)
+#define NEC_ONE_SPACE	(IR_TICKS_US(3375U) / 2)
+
+static uint16_t tx_list[IR_TX_MAX];		// marks at even, spaces at odd indices
+static uint8_t tx_n;
+static volatile uint8_t tx_i;			// next entry the interrupt starts
+static volatile bool tx_busy;
+static volatile bool tx_echo;			// tx_busy, and IR_TX_ECHO after it
+
+
+void
+IR_SendInit(void)
+{
+	PORTC &= ~_BV(6);
+	DDRC |= _BV(6);				// OC3A
+	TCCR3A = TX_CARRIER_OFF;
+	TCCR3B = _BV(WGM33) | _BV(WGM32);	// stopped
+	ICR3 = IR_TX_TOP;
+	OCR3A = (IR_TX_TOP + 1) / IR_TX_DUTY;
+}
+
+
+// A frame going out, a new one has to wait
+bool
+IR_SendBusy(void)
+{
+	return tx_busy;
+}
+
+
+// A frame went out a moment ago or still goes out, the receiver hears it
+bool
+IR_SendEcho(void)
+{
+	return tx_echo;
+}
+
+
+// Sends a NEC frame, code as IR_Decode() has it, the first bit in bit 0. repeat sends the short frame of a held
+// button instead. false while the last frame is still going out
+bool
+IR_SendNEC(uint32_t code, bool repeat)
+{
+	uint8_t n = 0, i, sreg;
+
+	if (tx_busy)
+		return false;
+
+	tx_list[n++] = NEC_HDR_MARK;
+	if (repeat)
+		tx_list[n++] = NEC_RPT_SPACE;
+	else
+	{
+		tx_list[n++] = NEC_HDR_SPACE;
+		for (i = 0; i < 32; i++, code >>= 1)
+		{
+			tx_list[n++] = NEC_BIT_MARK;
+			tx_list[n++] = (code & 1) ? NEC_ONE_SPACE : NEC_ZERO_SPACE;
+		}
+	}
+	tx_list[n++] = NEC_BIT_MARK;	// stop
+
+	TCCR3B = _BV(WGM33) | _BV(WGM32) | 1;	// carrier from the CPU clock
+	sreg = SREG;
+	cli();							// the end of the last echo may be due
+	tx_n = n;
+	tx_i = 0;
+	tx_busy = true;
+	tx_echo = true;
+	OCR1B = TCNT1 + IR_TX_LEAD;
+	TIFR1 = _BV(OCF1B);
+	TIMSK1 |= _BV(OCIE1B);		// shared with the receiver's OCR1A timeout
+	SREG = sreg;
+	return true;
+}
+
+
+// Start of the next mark or space, the end of the frame, or the end of its echo
+ISR(TIMER1_COMPB_vect, ISR_BLOCK)
+{
+	uint8_t i = tx_i;
+
+	TRACE_BEGIN(TR_TIMER1_COMPB);
+	if (i > tx_n)
+	{
+		TIMSK1 &= ~_BV(OCIE1B);
+		tx_echo = false;
+	}
+	else if (i == tx_n)
+	{
+		TCCR3A = TX_CARRIER_OFF;
+		TCCR3B = _BV(WGM33) | _BV(WGM32);	// stopped
+		OCR1B += IR_TX_ECHO;
+		tx_i = i + 1;
+		tx_busy = false;
+	}
+	else
+	{
+		if (i & 1)
+			TCCR3A = TX_CARRIER_OFF;
+		else
+		{
+			TCNT3 = IR_TX_TOP;		// BOTTOM with the next clock, the pulse starts
+			TCCR3A = TX_CARRIER_ON;
+		}
+		OCR1B += tx_list[i];
+		tx_i = i + 1;
+	}
+	TRACE_END(TR_TIMER1_COMPB);
+}
+
+#endif // IR_TX
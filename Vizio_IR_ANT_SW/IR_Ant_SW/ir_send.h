@@ -0,0 +1,43 @@
+/*
+ * ir_send.h
+ *
+ * Created: 10/19/2026
+ *
+ * NEC transmitter on an IR LED, the switch as a repeater or blaster. See ir_send.c
+ */
+
+#ifndef IR_SEND_H_
+#define IR_SEND_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// Uncomment here or define them in the project's compiler symbols. IR_RELAY sends every NEC frame received on again,
+// and the repeat frames of a held button, for equipment behind the cabinet that can't see the remote
+//#define IR_TX
+//#define IR_RELAY
+
+#if defined(IR_RELAY) && !defined(IR_TX)
+#define IR_TX
+#endif
+#if defined(IR_TX) && !defined(__AVR_ATmega32U4__)
+#error "IR_TX makes the carrier with Timer3, only the 32U4 board has it. Timer0 is the servo's, Timer1 the receiver's"
+#endif
+
+#define IR_TX_HZ		38000UL
+#define IR_TX_DUTY		3			// carrier on for a 3rd of its period
+#define IR_TX_MAX		67			// marks and spaces of a NEC frame: header, 32 bits, stop mark
+#define IR_TX_ECHO		(IR_TIMEOUT + IR_TICKS_US(4000U))	// from the end of a frame until it is no echo: the receiver
+									// times out on it, 4ms for its delay and the main loop to decode what it queued
+
+void IR_SendInit(void);
+bool IR_SendNEC(uint32_t code, bool repeat);
+bool IR_SendBusy(void);
+bool IR_SendEcho(void);
+
+// The 32 bit code of a NEC frame, address and command each followed by its inverse
+#define IR_NEC_CODE(address, command)	\
+	((uint32_t)(uint8_t)(address) | (uint32_t)(uint8_t)~(address) << 8 | (uint32_t)(uint8_t)(command) << 16 | \
+	 (uint32_t)(uint8_t)~(command) << 24)
+
+#endif /* IR_SEND_H_ */
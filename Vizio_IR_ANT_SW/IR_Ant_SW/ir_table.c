@@ -0,0 +1,201 @@
+/*
+ * ir_table.c
+ *
+ * Created: 10/19/2026
+ *
+ * The codes the switch reacts to, each with its action. The table lives in the EEPROM so a unit can learn the remote
+ * it is used with, see the learning mode in main.c. Without a valid table in the EEPROM it starts with the two Vizio
+ * buttons the firmware always knew.
+ *
+ * At start up the table is copied to RAM and a hash index is built over it: open addressing with linear probing in
+ * IR_HASH_SIZE byte slots, never more than 3/8 full. A lookup hashes the code once and mostly hits on the first slot,
+ * however many entries the table has. Learning a code writes its entry to the EEPROM and rebuilds the index, an
+ * existing entry for the code is overwritten. With the table full the oldest learned entry goes, in the order they were
+ * learned from entry IR_TABLE_FIXED on: the two Vizio buttons in entries 0 and 1 are never evicted, only relearning
+ * their own code changes them.
+ */
+#include <avr/eeprom.h>
+#include <string.h>
+#include "ir_table.h"
+
+#define IR_HASH_SIZE	64			// slots, a power of 2
+#define IR_TABLE_MAGIC	0xA5
+#define IR_TABLE_FIXED	2			// entries the defaults put in first, learning doesn't evict them
+
+#define VIZIO_GREEN_BTN		0xaa55fb04
+#define VIZIO_RED_BTN		0xad52fb04
+
+typedef struct ir_entry
+{
+	uint32_t code;
+	uint8_t protocol;
+	uint8_t action;
+	uint8_t spare;					// EEPROM only, the RAM copy leaves it out
+} ir_entry_t;
+
+typedef struct ir_table_ee
+{
+	uint8_t magic;
+	uint8_t count;
+	uint8_t next;					// entry learning overwrites once the table is full
+	ir_entry_t entries[IR_TABLE_SIZE];
+} ir_table_ee_t;
+
+static ir_table_ee_t EEMEM ir_table_ee;
+
+static uint32_t ir_codes[IR_TABLE_SIZE];
+static uint8_t ir_protocols[IR_TABLE_SIZE];
+static uint8_t ir_actions[IR_TABLE_SIZE];
+static uint8_t ir_count, ir_next;
+static uint8_t ir_hash[IR_HASH_SIZE];	// entry + 1, 0 for an empty slot
+
+
+static uint8_t
+IR_Hash(uint32_t code, uint8_t protocol)
+{
+	uint16_t h = (uint16_t)code ^ (uint16_t)(code >> 16);
+
+	h ^= h >> 8;
+	return ((uint8_t)h + protocol * 37) & (IR_HASH_SIZE-1);
+}
+
+
+static void
+IR_BuildIndex(void)
+{
+	uint8_t i, h;
+
+	memset(ir_hash, 0, sizeof(ir_hash));
+	for (i = 0; i < ir_count; i++)
+	{
+		h = IR_Hash(ir_codes[i], ir_protocols[i]);
+		while (ir_hash[h])
+			h = (h + 1) & (IR_HASH_SIZE-1);
+		ir_hash[h] = i + 1;
+	}
+}
+
+
+// Slot of the code in ir_hash, an empty one if it isn't known
+static uint8_t
+IR_Find(uint32_t code, uint8_t protocol)
+{
+	uint8_t h = IR_Hash(code, protocol);
+	uint8_t e;
+
+	while ((e = ir_hash[h]) != 0)
+	{
+		if (ir_codes[e - 1] == code && ir_protocols[e - 1] == protocol)
+			break;
+		h = (h + 1) & (IR_HASH_SIZE-1);
+	}
+	return h;
+}
+
+
+static void
+IR_StoreEntry(uint8_t i)
+{
+	ir_entry_t e;
+
+	e.code = ir_codes[i];
+	e.protocol = ir_protocols[i];
+	e.action = ir_actions[i];
+	e.spare = 0xff;
+	eeprom_update_block(&e, &ir_table_ee.entries[i], sizeof(e));
+}
+
+
+static void
+IR_StoreHeader(void)
+{
+	eeprom_update_byte(&ir_table_ee.count, ir_count);
+	eeprom_update_byte(&ir_table_ee.next, ir_next);
+	eeprom_update_byte(&ir_table_ee.magic, IR_TABLE_MAGIC);
+}
+
+
+// Back to the two Vizio buttons only
+void
+IR_TableDefaults(void)
+{
+	ir_codes[0] = VIZIO_GREEN_BTN;
+	ir_protocols[0] = IR_NEC;
+	ir_actions[0] = IR_ACTION(0, IR_ACT_POS_A);
+	ir_codes[1] = VIZIO_RED_BTN;
+	ir_protocols[1] = IR_NEC;
+	ir_actions[1] = IR_ACTION(0, IR_ACT_POS_B);
+	ir_count = IR_TABLE_FIXED;
+	ir_next = IR_TABLE_FIXED;
+	IR_StoreEntry(0);
+	IR_StoreEntry(1);
+	IR_StoreHeader();
+	IR_BuildIndex();
+}
+
+
+void
+IR_TableInit(void)
+{
+	ir_entry_t e;
+	uint8_t i;
+
+	ir_count = eeprom_read_byte(&ir_table_ee.count);
+	ir_next = eeprom_read_byte(&ir_table_ee.next);
+	if (eeprom_read_byte(&ir_table_ee.magic) != IR_TABLE_MAGIC || ir_count > IR_TABLE_SIZE || ir_next >= IR_TABLE_SIZE)
+	{
+		IR_TableDefaults();				// erased or from another firmware
+		return;
+	}
+	if (ir_next < IR_TABLE_FIXED)		// written when eviction started at entry 0
+		ir_next = IR_TABLE_FIXED;
+	for (i = 0; i < ir_count; i++)
+	{
+		eeprom_read_block(&e, &ir_table_ee.entries[i], sizeof(e));
+		ir_codes[i] = e.code;
+		ir_protocols[i] = e.protocol;
+		ir_actions[i] = IR_ACT_WHAT(e.action) < IR_N_ACTIONS ? e.action : IR_ACT_NONE;
+	}
+	IR_BuildIndex();
+}
+
+
+// What the code is for, IR_ACT_NONE if it isn't in the table
+uint8_t
+IR_TableLookup(const ir_frame_t *frame)
+{
+	uint8_t e = ir_hash[IR_Find(frame->code, frame->protocol)];
+
+	return e ? ir_actions[e - 1] : IR_ACT_NONE;
+}
+
+
+// Adds the code or changes what it does, false if it already does that. Writes the EEPROM, 3.4ms for each byte that changes
+bool
+IR_TableLearn(const ir_frame_t *frame, uint8_t action)
+{
+	uint8_t e = ir_hash[IR_Find(frame->code, frame->protocol)];
+	uint8_t i;
+
+	if (e)
+	{
+		i = e - 1;
+		if (ir_actions[i] == action)
+			return false;
+	}
+	else if (ir_count < IR_TABLE_SIZE)
+		i = ir_count++;
+	else
+	{
+		i = ir_next;					// full, the oldest learned entry goes
+		if (++ir_next == IR_TABLE_SIZE)
+			ir_next = IR_TABLE_FIXED;
+	}
+	ir_codes[i] = frame->code;
+	ir_protocols[i] = frame->protocol;
+	ir_actions[i] = action;
+	IR_StoreEntry(i);
+	IR_StoreHeader();
+	IR_BuildIndex();
+	return true;
+}
@@ -0,0 +1,34 @@
+/*
+ * ir_table.h
+ *
+ * Created: 10/19/2026
+ *
+ * Learned IR codes and what they do, kept in the EEPROM. See ir_table.c
+ */
+
+#ifndef IR_TABLE_H_
+#define IR_TABLE_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "ir_decode.h"
+
+#define IR_TABLE_SIZE	24		// entries, 7 bytes of EEPROM and 6 of RAM each, plus the 64 byte index
+
+// An action is the output in the high nibble and what to do with it in the low one, see outputs.h
+#define IR_ACTION(out, what)	(((out) << 4) | (what))
+#define IR_ACT_OUTPUT(a)		((a) >> 4)
+#define IR_ACT_WHAT(a)			((a) & 0x0f)
+
+#define IR_ACT_NONE		0
+#define IR_ACT_POS_A	1		// output 0: servo left, LED1 on
+#define IR_ACT_POS_B	2		// output 0: servo right, LED1 off
+#define IR_ACT_TOGGLE	3		// the other position
+#define IR_N_ACTIONS	4
+
+void IR_TableInit(void);
+void IR_TableDefaults(void);
+uint8_t IR_TableLookup(const ir_frame_t *frame);
+bool IR_TableLearn(const ir_frame_t *frame, uint8_t action);
+
+#endif /* IR_TABLE_H_ */
@@ -1,270 +1,584 @@
-/*
- * GccApplication1.c
- *
- * Created: 7/12/2012 2:42:13 PM
- *  Author: gary
- */ 
-
-#define F_CPU        16000000 
-#include <avr/io.h>		// include I/O definitions (port names, pin names, etc)
-#include <avr/wdt.h>
-#include <avr/power.h>
-#include <avr/interrupt.h>	// include interrupt support
-#include <stdbool.h>
-#include <util/delay.h>
-
-#define BUTTONS_BUTTON1    0x80
-#define LEDS_LED1        (1 << 6)
-#define SERVO_POS_MIDDLE (0x400-105)
-#define SERVO_POS_LEFT  (SERVO_POS_MIDDLE + 35)
-#define SERVO_POS_RIGHT (SERVO_POS_MIDDLE - 35)
-
-// VIZIO IR remote control signal:
-// No signal/end of sequence  == high on data in pin PC7
-// initial start sequence 8ms low, then 13.4ms high
-// followed by 32 bits of Pulse width data sequenced by 0.6ms SPACE. Mark for logic_0 = 0.6ms, MARK for logic_1 = 1.68ms
-
-#define VIZIO_GREEN_BTN  0xaa55fb04		
-#define VIZIO_RED_BTN 0xad52fb04
- static  void 
-LEDs_Init(void)
-{
-	DDRD  |=  LEDS_LED1;
-	PORTD &= ~LEDS_LED1;
-}
-
-static  void 
-LEDs_TurnOnLEDs(const uint8_t LEDMask)
-{
-	PORTD |= LEDMask;
-}
-
-static  void 
-LEDs_TurnOffLEDs(const uint8_t LEDMask)
-{
-	PORTD &= ~LEDMask;
-}
-
-static  void 
-Buttons_Init(void)
-{
-	DDRD  &= ~BUTTONS_BUTTON1;
-//	PORTD |=  BUTTONS_BUTTON1;
-}
-
-static bool 
-IsButtonPressed( unsigned char bt )
-{
-	return ((PIND & bt) == 0);
-}
-
-volatile uint8_t Signal_captured = 0;
-
-/* for debugging of IR code sequence
-#define N_CAPTURES 60
-volatile uint8_t capture_lenght = 0;
-volatile uint8_t capture_data[N_CAPTURES] = {0};
-volatile uint8_t capture_index = 0;
-*/
-volatile long unsigned IR_code;
-volatile unsigned char IR_code_ndx; 
-
-// Todo: should run timer 0 continuously and use it to generate a timeout of about 1 second after a signal 
-// is captured and the servo was commanded. This timeout is then used to turn the servo pulse off in case the 
-// servo is loaded by the switch and prevents it from jittering.   
-
-
-int main(void)
-{
-	unsigned char tmp;
-	
-	wdt_disable();		/* Disable watchdog if enabled by bootloader/fuses */
-	 
-	Buttons_Init();
-	LEDs_Init();
-	clock_prescale_set(clock_div_1);
-
-	// Timer 0 setup for simple count mode, used as timebase for IR-Signal capture
-	TCCR0A = 0;		// simple count more 		
-	TCCR0B = 5;		// system Clock 16Mhz/1024 = 64us per counter tick 
-	TIMSK0 = 0x1;	// Enable overflow interrupt enable 
-	TIFR0 = 0;		// clear Overflow interrupt flag before enabling interrupts
-	EIFR =0 ;
-	DDRC = 0;		// all inputs
-	PORTC = 0x80;	// pull-up on PC7
-	MCUSR =0;
-	
-	// Timer 1 setup for  fast PWM mode for servo pulse generation 1 to 2ms 
-	DDRB = 0x80;	// PB7 = output OC1_C
-	TIMSK1 = 0;		// timer 1 running with no interrupts
-	TCCR1A = 0x0F;	// use OC1_C pin for servo pulse
-	TCCR1B = 0x0C;	// Fast PWM 10bit, clock/256
-	OCR1C = SERVO_POS_RIGHT;
-	
-
-	sei();
-	
-	// set initial state 
-	Signal_captured = 1;
-	IR_code = VIZIO_GREEN_BTN;
-	
-    while(1)
-    {
-		// for manual toggling via HWB button
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-		if (IsButtonPressed(BUTTONS_BUTTON1) )
-		{
-
-			// de-bounce -- 5 consecutive reads of switch open 
-			for (tmp =0; tmp<=5; tmp++)
-			{
-				_delay_ms(1);
-				if (IsButtonPressed(BUTTONS_BUTTON1))
-					tmp = 0;
-			}
-			
-			if (IR_code == VIZIO_GREEN_BTN )
-				IR_code = VIZIO_RED_BTN;
-			else
-				IR_code = VIZIO_GREEN_BTN;
-			Signal_captured = 1;	
-				
-		}			
-				
-		if ( Signal_captured )
-		{
-			 switch (IR_code)
-			 {
-				 case VIZIO_GREEN_BTN:		// Vizio Code Green button
-					 LEDs_TurnOnLEDs(LEDS_LED1);
-					 OCR1C = SERVO_POS_LEFT;
-					 break;
-					 
-				 case VIZIO_RED_BTN:		// Vizio Code Red button
-					 LEDs_TurnOffLEDs(LEDS_LED1);
-					 OCR1C = SERVO_POS_RIGHT;
-					 break;
-			 }
-			 Signal_captured = 0;
-		}				
-    }
-}
-
-ISR( INT4_vect,ISR_BLOCK )
-{	
-	uint8_t cnt;
-	
-	if ( PINC & (1<<PINC7) )
-	{
-		Signal_captured = 0;		
-		// trigged  by raising edge of signal
-		TCNT0 = 0;
-		TCCR0B = 5;  // system Clock 16Mhz/1024 = 64us per counter tick 
-		// change interrupt edge to falling
-		EICRB = 0x2;
-	}
-	else //	read_counter0()
-	{		// trigged  by falling edge of signal
-		
-		if ((cnt = TCNT0) > 40 )	 // the initial start pulse
-		{
-			IR_code = 0;
-			IR_code_ndx = 0;
-		}
-		else
-		{
-			if (cnt > 16)
-				IR_code += 1L<<IR_code_ndx;  
-			IR_code_ndx++;
-		}
-		/* for signal analysis only
-		if (capture_index < N_CAPTURES-1)
-		{
-			capture_data[capture_index++]=cnt;
-		} */			
-		TCCR0B = 0; // stop clocking
-		// set interrupt to raising edge trigger
-		EICRB = 0x3;
-	}
-		
-}
-
-
-
-
-ISR(TIMER0_OVF_vect, ISR_BLOCK)
-{
-	Signal_captured = 1; 
-	/*
-	capture_lenght = capture_index; 
-	capture_index = 0;
-	*/
-	TCCR0B = 0;		// stop counter from  clocking
-	EIFR = 0 ;		// clear external interrupt flag 
-	EICRB = 0x3;	// set interrupt to raising edge trigger
-	EIMSK = 0x10;	// enable INT4 (pin PC7 alternate function)
-}	
\ No newline at end of file
+/*
+ * GccApplication1.c
+ *
+ * Created: 7/12/2012 2:42:13 PM
+ *  Author: gary
+ */ 
+
+#define F_CPU        16000000 
+#include <avr/io.h>		// include I/O definitions (port names, pin names, etc)
+#include <avr/wdt.h>
+#include <avr/power.h>
+#include <avr/interrupt.h>	// include interrupt support
+#include <avr/sleep.h>
+#include <stdbool.h>
+#include "ir_ring.h"
+#include "ir_decode.h"
+#include "servo.h"
+#include "ir_capture.h"
+#include "ir_send.h"
+#include "ir_table.h"
+#include "outputs.h"
+#include "../../Common/timer_wheel.h"
+#include "../../Common/stack_check.h"
+#include "trace_ids.h"
+
+// The board is picked by the device of the project, its header binds the pins. Both have the receiver on ICP1 and
+// the servo on OC0A, only the ports differ, so everything is resolved by the compiler.
+#if defined(__AVR_ATmega32U4__)
+#include "board_32u4.h"
+#else
+#include "board_32u2.h"
+#endif
+
+#define LEDS_LED1        BOARD_LED
+
+// VIZIO IR remote control signal:
+// No signal/end of sequence  == high on data in pin ICP1
+// initial start sequence 8ms low, then 13.4ms high
+// followed by 32 bits of Pulse width data sequenced by 0.6ms SPACE. Mark for logic_0 = 0.6ms, MARK for logic_1 = 1.68ms
+//
+// Timer1 runs free from clk/8 (0.5us per tick) and its input capture timestamps the edges of the receiver in
+// hardware. The capture interrupt only queues how long the signal was low or high (ir_ring.h), IR_Decode() in the main
+// loop makes the code from that (ir_decode.c, it knows NEC, Sony and RC5 remotes). OCR1A follows the last edge by
+// IR_TIMEOUT and queues the end of the sequence. The servo pulse comes from Timer0 on OC0A, the same PB7 pin that
+// was OC1C, servo.c ramps it to a new position and switches it off after the move.
+//
+// The codes and what they do come from a table in the EEPROM (ir_table.c). Learning mode: hold the button for 2s, or
+// any button of a NEC remote for 10s, LED1 starts blinking. The next code received moves the switch left, the one
+// after right, a third toggles. A short press of the button or 10s without a code end it. Holding the button for
+// 10s brings back the two Vizio buttons alone.
+//
+// The Timer1 overflow is the tick of the software timers (Common/timer_wheel.c): the same press window, the learning
+// timeout and blink, and the button scan. With nothing to do, no servo move, no IR sequence, no timer running and
+// nothing left to send, the chip sleeps. On a board where the
+// receiver pin is also an external interrupt it powers down, all clocks stop, and the low level at the start of a
+// sequence wakes it. The falling edge that woke it can't be captured then, Timer1 only runs again after the crystal
+// started, INT4 puts it in the place it must have been and captures the end of the header low. The other board idles,
+// the capture interrupt wakes it. While a timer runs it idles as well, the next tick wakes it.
+//
+// IR_TX (ir_send.h, 32U4 board): NEC frames go out on an IR LED, the carrier from Timer3 and the marks and spaces from
+// OCR1B, see ir_send.c. IR_RELAY sends every NEC frame received on again, and every repeat frame of a held button as it
+// comes, whatever IR_HOLD_REPEAT reports. An OUTPUT_IR (outputs.h) sends a code of its own. The receiver sees the LED
+// too, what it captures while a frame goes out and until it timed out on its end is dropped before the decoder.
+
+#define TICK_MS				33			// Timer1 overflow, 32.8ms
+#define LEARN_BUTTON_TICKS	(2000 / TICK_MS)
+#define DEFAULTS_BUTTON_TICKS	(10000 / TICK_MS)
+#define BUTTON_OPEN_TICKS	2			// de-bounce, open for this many scans in a row is released
+#define LEARN_HOLD_REPEATS	92			// NEC repeat frames, 108ms each
+#define LEARN_TIMEOUT		(10000 / TICK_MS)
+#define LEARN_BLINK_TICKS	4
+#define SAME_PRESS_TICKS	6			// the same code within 200ms is still the same press, Sony sends it 3 times
+#define IR_WAKE_TICKS		IR_TICKS_US(1100U)	// from the falling edge to INT4, crystal start up of 16K clocks
+
+static  void 
+LEDs_Init(void)
+{
+	BOARD_LED_DDR  |=  LEDS_LED1;
+	BOARD_LED_PORT &= ~LEDS_LED1;
+}
+
+static  void 
+LEDs_TurnOnLEDs(const uint8_t LEDMask)
+{
+	BOARD_LED_PORT |= LEDMask;
+}
+
+static  void 
+LEDs_TurnOffLEDs(const uint8_t LEDMask)
+{
+	BOARD_LED_PORT &= ~LEDMask;
+}
+
+#ifdef BOARD_BUTTON
+static  void 
+Buttons_Init(void)
+{
+	BOARD_BUTTON_DDR  &= ~BOARD_BUTTON;
+}
+
+static bool 
+IsButtonPressed(void)
+{
+	return ((BOARD_BUTTON_PIN & BOARD_BUTTON) == 0);
+}
+#endif
+
+static uint8_t Action;				// IR_ACTION() to carry out
+
+static uint8_t Learn_step;			// action the next code gets, IR_ACT_NONE when not learning
+static tw_timer_t Learn_timer;		// no code for LEARN_TIMEOUT ends learning
+static tw_timer_t Blink_timer;
+
+static ir_frame_t Last_frame;
+static tw_timer_t Same_timer;		// running while the last code still counts as the same press
+static uint16_t Last_repeats;		// IR_repeats at the last frame
+
+#ifdef BOARD_BUTTON
+static tw_timer_t Button_timer;		// scans the button while it is pressed
+static uint16_t Button_held;		// ticks
+static uint8_t Button_open;			// scans in a row
+#endif
+
+static uint8_t IR_overruns_seen;
+static uint16_t IR_last;			// Timer1 count at the last edge
+
+#ifdef BOARD_IR_WAKE_vect
+static volatile bool Woke;			// by the receiver, the wake-to-decode time is measured
+static volatile uint16_t Wake_tcnt;	// Timer1 when it did
+static volatile uint8_t Wake_overflows;
+uint16_t Wake_latency_ms;			// falling edge that woke the chip to the frame decoded
+uint16_t Wake_latency_max_ms;
+#endif
+
+
+// LED1 on for output 0 at position A
+static void
+Show_Output(void)
+{
+	if (Outputs_AtA(0))
+		LEDs_TurnOnLEDs(LEDS_LED1);
+	else
+		LEDs_TurnOffLEDs(LEDS_LED1);
+}
+
+
+static void
+Learn_Blink(void)
+{
+	BOARD_LED_PORT ^= LEDS_LED1;
+}
+
+
+static void
+Learn_End(void)
+{
+	Learn_step = IR_ACT_NONE;
+	TW_Stop(&Learn_timer);
+	TW_Stop(&Blink_timer);
+	Show_Output();					// the LED shows the position again
+}
+
+
+static void
+Learn_Start(void)
+{
+	Learn_step = IR_ACTION(0, IR_ACT_POS_A);
+	TW_Start(&Learn_timer, LEARN_TIMEOUT, 0, Learn_End);
+	TW_Start(&Blink_timer, LEARN_BLINK_TICKS, LEARN_BLINK_TICKS, Learn_Blink);
+	Last_repeats = IR_repeats;
+}
+
+
+// Codes are learned for position A, B and toggle of every output in turn
+static void
+Learn_Next(void)
+{
+	uint8_t out = IR_ACT_OUTPUT(Learn_step);
+
+	TW_Start(&Learn_timer, LEARN_TIMEOUT, 0, Learn_End);
+	if (IR_ACT_WHAT(++Learn_step) < IR_N_ACTIONS)
+		return;
+	if (++out < Outputs_Count())
+		Learn_step = IR_ACTION(out, IR_ACT_POS_A);
+	else
+		Learn_End();
+}
+
+
+#ifdef BOARD_BUTTON
+// Every tick while the button is pressed, the press counts when it was released
+static void
+Button_Scan(void)
+{
+	if (IsButtonPressed())
+	{
+		Button_open = 0;
+		if (Button_held != 0xffff)
+			Button_held++;
+		return;
+	}
+	if (++Button_open < BUTTON_OPEN_TICKS)
+		return;
+	TW_Stop(&Button_timer);
+
+	if (Button_held >= DEFAULTS_BUTTON_TICKS)
+	{
+		IR_TableDefaults();
+		Learn_End();
+	}
+	else if (Button_held >= LEARN_BUTTON_TICKS)
+		Learn_Start();
+	else if (Learn_step)
+		Learn_End();
+	else
+		Action = IR_ACT_TOGGLE;
+}
+#endif
+
+
+#ifdef BOARD_IR_WAKE_vect
+static void
+Wake_Report(void)
+{
+	uint8_t sreg = SREG;
+	uint16_t tcnt;
+	uint8_t overflows;
+	uint32_t ticks;
+
+	cli();
+	tcnt = TCNT1;
+	overflows = Wake_overflows;
+	if ((TIFR1 & _BV(TOV1)) && tcnt < 0x8000 && overflows != 0xff)
+		overflows++;				// wrapped, the interrupt hasn't counted it yet
+	SREG = sreg;
+
+	ticks = ((uint32_t)overflows << 16) + tcnt - Wake_tcnt + IR_WAKE_TICKS;
+	Woke = false;
+	Wake_latency_ms = ticks / IR_TICKS_US(1000UL);
+	if (Wake_latency_ms > Wake_latency_max_ms)
+		Wake_latency_max_ms = Wake_latency_ms;
+#ifdef IR_CAPTURE
+	IR_CaptureNote("wake-to-decode", Wake_latency_ms);
+#endif
+}
+#endif
+
+#ifdef IR_CAPTURE
+static uint16_t Stack_low = UINT16_MAX;
+
+// Into the capture dump whenever the stack went deeper than before, see Common/stack_check.c
+static void
+Stack_Report(void)
+{
+	uint16_t n = Stack_Unused();
+
+	if (n < Stack_low)
+	{
+		Stack_low = n;
+		IR_CaptureNote("stack-free", n);
+	}
+}
+#endif
+
+
+static void
+IR_Frame(const ir_frame_t *frame)
+{
+	bool same = TW_Running(&Same_timer) && frame->code == Last_frame.code && frame->protocol == Last_frame.protocol;
+
+	TRACE_MARK(TR_IR_FRAME, frame->code);
+#ifdef IR_RELAY
+	if (frame->protocol == IR_NEC && !frame->repeat && !Learn_step)
+		IR_SendNEC(frame->code, false);		// the repeats go from IR_Repeat()
+#endif
+	Last_frame = *frame;
+	TW_Start(&Same_timer, SAME_PRESS_TICKS, 0, 0);
+	Last_repeats = IR_repeats;
+#ifdef BOARD_IR_WAKE_vect
+	if (Woke)
+		Wake_Report();
+#endif
+#ifdef IR_CAPTURE
+	Stack_Report();
+#endif
+	if (same)
+		return;
+
+	if (Learn_step)
+	{
+		IR_TableLearn(frame, Learn_step);
+		Learn_Next();
+	}
+	else
+		Action = IR_TableLookup(frame);
+}
+
+
+#ifdef IR_RELAY
+// The decoder counted a NEC repeat frame, reported or not
+static void
+IR_Repeat(void)
+{
+	if (Last_frame.protocol == IR_NEC && !Learn_step)
+		IR_SendNEC(0, true);
+}
+#endif
+
+
+// Nothing going on the main loop is needed for, it may power down
+static bool
+Is_Idle(void)
+{
+	if (Action || TW_Armed() || Servo_IsActive() || (TIMSK1 & _BV(OCIE1A)) || !IR_Empty())
+		return false;
+#ifdef IR_TX
+	if (IR_SendEcho())				// Timer1 and Timer3 stop in power down, the end of the echo is on OCR1B
+		return false;
+#endif
+#ifdef IR_USART
+	if (IR_CaptureBusy())
+		return false;
+#endif
+#ifdef BOARD_BUTTON
+	if (IsButtonPressed())
+		return false;
+#endif
+	return true;
+}
+
+
+// Idle until the next interrupt, the Timer1 overflow at the latest
+static void
+Nap(void)
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+	if (TW_Pending())
+	{
+		sei();
+		return;
+	}
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+}
+
+
+static void
+Sleep(void)
+{
+#ifdef BOARD_IR_WAKE_vect
+	Woke = false;
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	cli();
+	if ((TIMSK1 & _BV(OCIE1A)) || !(BOARD_IR_PIN & BOARD_IR))
+	{
+		sei();						// a sequence started meanwhile
+		return;
+	}
+	BOARD_WAKE_EICR &= ~BOARD_IR_WAKE_ISC;		// low level
+	EIMSK |= BOARD_IR_WAKE;
+#ifdef BOARD_BUTTON_WAKE_vect
+	BOARD_WAKE_EICR &= ~BOARD_BUTTON_WAKE_ISC;
+	EIMSK |= BOARD_BUTTON_WAKE;
+#endif
+#else
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+#endif
+	sleep_enable();
+	sei();
+	sleep_cpu();					// the instruction after sei still runs, no interrupt gets in before it
+	sleep_disable();
+}
+
+
+int main(void)
+{
+	uint16_t edge;
+	ir_frame_t frame;
+#ifdef IR_RELAY
+	uint16_t repeats;
+#endif
+	
+	wdt_disable();		/* Disable watchdog if enabled by bootloader/fuses */
+	 
+#ifdef BOARD_BUTTON
+	Buttons_Init();
+#endif
+	LEDs_Init();
+	clock_prescale_set(clock_div_1);
+	IR_TableInit();
+
+	// Servos on Timer 0 fast PWM, pulse 1 to 2ms, see servo.c, and the relays
+	Outputs_Init();
+	BOARD_IR_DDR &= ~BOARD_IR;
+	BOARD_IR_PORT |= BOARD_IR;	// pull-up on the receiver output
+	MCUSR =0;
+	power_usb_disable();
+	power_spi_disable();
+#ifndef IR_USART
+	power_usart1_disable();
+#endif
+	ACSR = _BV(ACD);	// analog comparator off
+	
+	// Timer 1 free running for IR-Signal capture 
+	TCCR1A = 0;		// normal mode
+	TCCR1B = _BV(ICNC1) | 2;	// noise canceler, falling edge, 16Mhz/8 = 0.5us per counter tick
+	TIFR1 = _BV(ICF1) | _BV(TOV1);
+	TIMSK1 = _BV(ICIE1) | _BV(TOIE1);	// input capture interrupt on ICP1 (receiver output), overflow for the timer tick
+#ifdef IR_USART
+	IR_CaptureInit();		// for debugging of IR code sequences, or the trace
+#endif
+#ifdef IR_TX
+	IR_SendInit();
+#endif
+	
+
+	sei();
+	
+	// set initial state 
+	Action = IR_ACTION(0, IR_ACT_POS_A);
+	
+    while(1)
+    {
+#ifdef BOARD_BUTTON
+		// for manual toggling via the button, Button_Scan() takes it from here
+		if (IsButtonPressed() && !TW_Running(&Button_timer))
+		{
+			Button_held = 0;
+			Button_open = 0;
+			TW_Start(&Button_timer, 1, 1, Button_Scan);
+		}
+#endif
+		TW_Poll();
+				
+		if (IR_overruns != IR_overruns_seen)	// edges got lost, drop the rest and wait for the next start
+		{
+			IR_overruns_seen = IR_overruns;
+			IR_Flush();
+			IR_DecodeReset();
+		}
+		if (!IR_Empty())
+		{
+			TRACE_BEGIN(TR_IR_DECODE);
+			while (IR_Pop(&edge))
+			{
+#ifdef IR_CAPTURE
+				IR_CaptureEdge(edge);
+#endif
+#ifdef IR_TX
+				if (IR_SendEcho())			// the switch's own LED, and a remote's frame under it
+				{
+					IR_DecodeDrop(edge);	// without losing the frame a held button repeats
+					continue;
+				}
+#endif
+#ifdef IR_RELAY
+				repeats = IR_repeats;
+#endif
+				if (IR_Decode(edge, &frame))
+					IR_Frame(&frame);
+#ifdef IR_RELAY
+				if (IR_repeats != repeats)
+					IR_Repeat();
+#endif
+			}
+			TRACE_END(TR_IR_DECODE);
+		}
+		if (!Learn_step && (uint16_t)(IR_repeats - Last_repeats) >= LEARN_HOLD_REPEATS)
+			Learn_Start();			// a NEC button held down
+#ifdef IR_USART
+		IR_CapturePoll();
+#endif
+		
+		if (Action)
+		{
+			TRACE_MARK(TR_OUTPUT, Action);
+			Outputs_Do(Action);
+			Show_Output();
+			Action = IR_ACT_NONE;
+		}
+		
+		if (Is_Idle())
+			Sleep();
+		else if (!Action && IR_Empty()
+#ifdef IR_USART
+			&& !IR_CaptureBusy()	// polled out of the USART
+#endif
+			)
+			Nap();
+    }
+}
+
+// Edge of the IR signal, ICR1 holds the time it happened. Queues how long the signal was low or high before it
+ISR(TIMER1_CAPT_vect, ISR_BLOCK)
+{	
+	uint16_t icr = ICR1;
+	uint16_t len = icr - IR_last;
+	
+	TRACE_BEGIN(TR_TIMER1_CAPT);
+	IR_last = icr;
+	if (TCCR1B & _BV(ICES1))
+	{
+		TCCR1B &= ~_BV(ICES1);		// raising edge, falling edge next
+		IR_Push(len);
+	}
+	else
+	{
+		TCCR1B |= _BV(ICES1);		// falling edge, raising edge next
+		if (TIMSK1 & _BV(OCIE1A))	// not the first edge after a pause, that was queued by the timeout
+			IR_Push(len | IR_HIGH);
+	}
+	
+	OCR1A = icr + IR_TIMEOUT;
+	TIFR1 = _BV(OCF1A) | _BV(ICF1);	// changing ICES1 can raise ICF1
+	TIMSK1 |= _BV(OCIE1A);
+	TRACE_END(TR_TIMER1_CAPT);
+}
+
+
+ISR(TIMER1_COMPA_vect, ISR_BLOCK)	// no edge for IR_TIMEOUT, the signal is idle high
+{
+	TRACE_BEGIN(TR_TIMER1_COMPA);
+	IR_Push(IR_TIME | IR_HIGH);
+	TIMSK1 &= ~_BV(OCIE1A);
+	TCCR1B &= ~_BV(ICES1);		// a sequence starts with a falling edge
+	TIFR1 = _BV(ICF1);
+	TRACE_END(TR_TIMER1_COMPA);
+}
+
+
+// Tick of the software timers, 32.8ms
+ISR(TIMER1_OVF_vect, ISR_BLOCK)
+{
+	TRACE_BEGIN(TR_TIMER1_OVF);
+	TW_Tick();
+#ifdef BOARD_IR_WAKE_vect
+	if (Woke && Wake_overflows != 0xff)
+		Wake_overflows++;
+#endif
+	TRACE_END(TR_TIMER1_OVF);
+}
+
+
+#ifdef BOARD_IR_WAKE_vect
+// The receiver woke the chip from power down. The falling edge was before Timer1 ran again, its time is estimated
+ISR(BOARD_IR_WAKE_vect, ISR_BLOCK)
+{
+	uint16_t tcnt = TCNT1;
+
+	TRACE_MARK(TR_IR_WAKE, 0);
+	EIMSK &= ~BOARD_IR_WAKE;		// level interrupt, only for waking up
+#ifdef BOARD_BUTTON_WAKE_vect
+	EIMSK &= ~BOARD_BUTTON_WAKE;
+#endif
+	if ((TIFR1 & _BV(ICF1)) || (BOARD_IR_PIN & BOARD_IR))
+		return;						// no real power down, the edge was captured, or a glitch that's gone again
+	
+	IR_last = tcnt - IR_WAKE_TICKS;
+	TCCR1B |= _BV(ICES1);			// the end of the header low is next
+	OCR1A = tcnt + IR_TIMEOUT;
+	TIFR1 = _BV(OCF1A) | _BV(ICF1);
+	TIMSK1 |= _BV(OCIE1A);
+	if ((TIFR1 & _BV(TOV1)) && tcnt < 0x8000)
+	{
+		TIFR1 = _BV(TOV1);			// the overflow was before tcnt, it mustn't count for the wake up
+		TW_Tick();
+	}
+	Wake_tcnt = tcnt;
+	Wake_overflows = 0;
+	Woke = true;
+}
+#endif
+
+
+#ifdef BOARD_BUTTON_WAKE_vect
+ISR(BOARD_BUTTON_WAKE_vect, ISR_BLOCK)	// the button woke the chip, the main loop sees it pressed
+{
+	EIMSK &= ~(BOARD_IR_WAKE | BOARD_BUTTON_WAKE);
+}
+#endif
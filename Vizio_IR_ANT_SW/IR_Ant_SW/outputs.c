@@ -0,0 +1,115 @@
+/*
+ * outputs.c
+ *
+ * Created: 10/19/2026
+ *
+ * Routes the actions of the code table (ir_table.c) to the outputs listed in OUTPUTS (outputs.h). An action names the
+ * output and what to do with it, so carrying one out is an index into the output table whatever number of outputs
+ * there are. Servo moves are ramped and staggered by servo.c, relays switch right away, IR outputs send the command
+ * of the position to equipment that has its own remote (ir_send.c), a frame at a time.
+ */
+#include <avr/io.h>
+#include <stddef.h>
+#include "outputs.h"
+#include "ir_table.h"
+#include "ir_send.h"
+
+typedef struct output
+{
+	uint8_t kind;
+	uint8_t channel;				// servo, or the address of an IR output
+	volatile uint8_t *port;			// relay, the DDR register is the one below
+	uint8_t mask;
+	uint8_t pos[2];					// A, B
+} output_t;
+
+static const output_t outputs[] = OUTPUTS;
+
+#define N_OUTPUTS	(sizeof(outputs) / sizeof(outputs[0]))
+
+static uint16_t at_b;				// bit n: output n is at position B
+
+
+static void
+Outputs_Set(uint8_t n, uint8_t b)
+{
+	const output_t *o = &outputs[n];
+
+	if (o->kind == OUT_SERVO)
+		Servo_MoveTo(o->channel, o->pos[b]);
+	else if (o->kind == OUT_IR)
+	{
+#ifdef IR_TX
+		IR_SendNEC(IR_NEC_CODE(o->channel, o->pos[b]), false);
+#endif
+	}
+	else if (o->pos[b])
+		*o->port |= o->mask;
+	else
+		*o->port &= ~o->mask;
+
+	if (b)
+		at_b |= 1U << n;
+	else
+		at_b &= ~(1U << n);
+}
+
+
+// Every output to position B
+void
+Outputs_Init(void)
+{
+	uint8_t n;
+
+	for (n = 0; n < N_OUTPUTS; n++)
+	{
+		if (outputs[n].kind == OUT_IR)
+		{
+			at_b |= 1U << n;			// nothing sent at power up
+			continue;
+		}
+		if (outputs[n].kind == OUT_SERVO)
+			Servo_Init(outputs[n].channel, outputs[n].pos[1]);
+		else
+			*(outputs[n].port - 1) |= outputs[n].mask;
+		Outputs_Set(n, 1);
+	}
+}
+
+
+void
+Outputs_Do(uint8_t action)
+{
+	uint8_t n = IR_ACT_OUTPUT(action);
+
+	if (n >= N_OUTPUTS)
+		return;
+	switch (IR_ACT_WHAT(action))
+	{
+		case IR_ACT_POS_A:
+			Outputs_Set(n, 0);
+			break;
+
+		case IR_ACT_POS_B:
+			Outputs_Set(n, 1);
+			break;
+
+		case IR_ACT_TOGGLE:
+			Outputs_Set(n, !(at_b & (1U << n)));
+			break;
+	}
+}
+
+
+bool
+Outputs_AtA(uint8_t output)
+{
+	return !(at_b & (1U << output));
+}
+
+
+uint8_t
+Outputs_Count(void)
+{
+	return N_OUTPUTS;
+}
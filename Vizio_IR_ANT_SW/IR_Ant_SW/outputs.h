@@ -0,0 +1,40 @@
+/*
+ * outputs.h
+ *
+ * Created: 10/19/2026
+ *
+ * What the switch drives: servos and relays, each with two positions A and B. See outputs.c
+ */
+
+#ifndef OUTPUTS_H_
+#define OUTPUTS_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "servo.h"
+
+#define OUT_SERVO		0		// channel: 0 == OC0A (PB7), 1 == OC0B (PD0), positions are OCR0A/B values
+#define OUT_RELAY		1		// any port pin, positions are the pin level
+#define OUT_IR			2		// IR_TX, a NEC command to an address, positions are the commands
+
+// The outputs of this unit, output 0 is the one LED1 shows and the button toggles. Add more like:
+//	OUTPUT_SERVO(1, SERVO_POS_LEFT, SERVO_POS_RIGHT),
+//	OUTPUT_RELAY(PORTB, 4, 1, 0),
+//	OUTPUT_IR(0x04, 0x02, 0x03),
+#define OUTPUTS												\
+{															\
+	OUTPUT_SERVO(0, SERVO_POS_LEFT, SERVO_POS_RIGHT),		\
+}
+
+#define OUTPUT_SERVO(ch, a, b)			{ OUT_SERVO, (ch), NULL, 0, { (a), (b) } }
+#define OUTPUT_RELAY(port, bit, a, b)	{ OUT_RELAY, 0, &(port), _BV(bit), { (a), (b) } }
+#define OUTPUT_IR(address, a, b)		{ OUT_IR, (address), NULL, 0, { (a), (b) } }
+
+#define N_OUTPUTS_MAX	16		// the action byte has 4 bits for it
+
+void Outputs_Init(void);
+void Outputs_Do(uint8_t action);
+bool Outputs_AtA(uint8_t output);
+uint8_t Outputs_Count(void);
+
+#endif /* OUTPUTS_H_ */
@@ -0,0 +1,161 @@
+/*
+ * servo.c
+ *
+ * Created: 10/19/2026
+ *
+ * Servo pulses from Timer0 fast PWM, channel 0 on OC0A (PB7) and channel 1 on OC0B (PD0). The 4.096ms PWM period is
+ * too short for a servo, the outputs are only connected for every 4th period, one pulse each 16.4ms frame.
+ * Disconnected the pins are PORT bits, low. Both channels come from the same interrupt at no extra cost.
+ *
+ * A move doesn't jump to the new pulse width, the overflow interrupt ramps it once per frame: accelerate by
+ * SERVO_ACCEL up to SERVO_VMAX and brake in time to stop at the target, a trapezoid over time. That keeps the current
+ * the servo draws at the start of a move down. A servo only starts while no other one is accelerating, so moves
+ * ordered together run staggered and their current peaks don't add up. SERVO_SETTLE_MS after it arrived the pulses
+ * stop, a servo without pulses doesn't hunt against the load of the switch and draws next to nothing. Timer0 and its
+ * interrupt stop as well until the next move, main.c puts the chip to sleep only then.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "servo.h"
+#include "trace_ids.h"
+
+#define SERVO_FRAME_US		16384UL
+#define SERVO_SETTLE		((SERVO_SETTLE_MS * 1000UL + SERVO_FRAME_US - 1) / SERVO_FRAME_US)	// frames
+
+static volatile uint8_t servo_target[SERVO_CHANNELS];	// OCR0A/B
+static int16_t servo_pos[SERVO_CHANNELS];				// OCR0A/B * 16
+static int16_t servo_speed[SERVO_CHANNELS];				// per frame, signed
+static volatile uint8_t servo_settle[SERVO_CHANNELS];	// frames left with pulses after arriving, 0: output off
+static bool servo_accelerating;							// some servo did in the last frame
+
+
+// Channel 0 on OC0A (PB7), channel 1 on OC0B (PD0), sends pulses for pos right away
+void
+Servo_Init(uint8_t ch, uint8_t pos)
+{
+	servo_target[ch] = pos;
+	servo_pos[ch] = (int16_t)pos << 4;
+	if (ch == 0)
+	{
+		OCR0A = pos;
+		DDRB |= 0x80;	// PB7 = output OC0A
+	}
+	else
+	{
+		OCR0B = pos;
+		DDRD |= 0x01;	// PD0 = output OC0B
+	}
+	TCCR0A = 0x03;		// fast PWM, OC0A/B disconnected until the interrupt connects them
+	TCCR0B = 4;			// system Clock 16Mhz/256 = 16us per counter tick, 4.096ms period
+	servo_settle[ch] = SERVO_SETTLE;
+	TIMSK0 = _BV(TOIE0);
+}
+
+
+// Starts a move from wherever the servo is now, also in the middle of another move
+void
+Servo_MoveTo(uint8_t ch, uint8_t pos)
+{
+	uint8_t sreg = SREG;
+
+	cli();
+	servo_target[ch] = pos;
+	servo_settle[ch] = SERVO_SETTLE;
+	TCCR0B = 4;
+	TIMSK0 = _BV(TOIE0);
+	SREG = sreg;
+}
+
+
+// Pulses still going out on any channel
+bool
+Servo_IsActive(void)
+{
+	return (TIMSK0 & _BV(TOIE0)) != 0;
+}
+
+
+// One step of the profile of one channel, once per frame. false when the servo has been at the target for
+// SERVO_SETTLE frames. It doesn't start while busy, another servo is accelerating. Sets *accel if it accelerates
+static bool
+Servo_Frame(uint8_t ch, bool busy, bool *accel)
+{
+	int16_t dist = ((int16_t)servo_target[ch] << 4) - servo_pos[ch];
+	int16_t speed = servo_speed[ch];
+	bool down = dist < 0;
+
+	if (dist == 0 && speed == 0)
+		return --servo_settle[ch] != 0;
+	if (speed == 0 && busy)
+		return true;					// waits, the pulse stays where it is
+
+	if (down)							// work with the target above, towards it is positive
+	{
+		dist = -dist;
+		speed = -speed;
+	}
+	if (speed > 0 && (uint16_t)speed * speed > 2 * SERVO_ACCEL * (uint16_t)dist)
+		speed -= SERVO_ACCEL;			// it wouldn't stop in time otherwise
+	else if (speed < SERVO_VMAX)
+	{
+		speed += SERVO_ACCEL;			// also slows down a move away from the target
+		if (speed > 0)
+			*accel = true;
+	}
+	if (speed >= dist)					// arrives in this frame
+	{
+		servo_pos[ch] = (int16_t)servo_target[ch] << 4;
+		servo_speed[ch] = 0;
+	}
+	else
+	{
+		servo_pos[ch] += down ? -speed : speed;
+		servo_speed[ch] = down ? -speed : speed;
+	}
+	return true;
+}
+
+
+ISR(TIMER0_OVF_vect, ISR_BLOCK)
+{
+	static uint8_t period;
+	bool accel;
+
+	TRACE_BEGIN(TR_TIMER0_OVF);
+	switch (++period & 3)
+	{
+		case 0:					// this period ends with pulses, OC0A/B set on compare match, cleared at BOTTOM
+			TCCR0A = 0x03 | (servo_settle[0] ? 0xC0 : 0)
+#if SERVO_CHANNELS > 1
+				| (servo_settle[1] ? 0x30 : 0)
+#endif
+				;
+			break;
+
+		case 3:					// OCR0A/B are double buffered, what is written now is used by the next pulse
+			TCCR0A = 0x03;
+			accel = false;
+			if (servo_settle[0] && Servo_Frame(0, servo_accelerating, &accel))
+				OCR0A = (servo_pos[0] + 8) >> 4;
+#if SERVO_CHANNELS > 1
+			if (servo_settle[1] && Servo_Frame(1, servo_accelerating || accel, &accel))
+				OCR0B = (servo_pos[1] + 8) >> 4;
+#endif
+			servo_accelerating = accel;
+			if (!servo_settle[0]
+#if SERVO_CHANNELS > 1
+				&& !servo_settle[1]
+#endif
+				)
+			{
+				TIMSK0 = 0;		// all settled, no more pulses and no more interrupts
+				TCCR0B = 0;		// timer stopped
+			}
+			break;
+
+		default:
+			TCCR0A = 0x03;
+			break;
+	}
+	TRACE_END(TR_TIMER0_OVF);
+}
@@ -0,0 +1,33 @@
+/*
+ * servo.h
+ *
+ * Created: 10/19/2026
+ *
+ * Servo pulses on OC0A (PB7) and OC0B (PD0) with ramped moves, a pulse is switched off once its servo had time to
+ * settle.
+ */
+
+#ifndef SERVO_H_
+#define SERVO_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define SERVO_POS_MIDDLE (0x100-105)	// Timer0 OCR0A, the pulse is (256 - OCR0A) * 16us
+#define SERVO_POS_LEFT  (SERVO_POS_MIDDLE + 35)
+#define SERVO_POS_RIGHT (SERVO_POS_MIDDLE - 35)
+
+#ifndef SERVO_CHANNELS
+#define SERVO_CHANNELS	2		// OC0A, OC0B
+#endif
+
+// Motion profile, in 1/16 of an OCR0A step (16us of pulse width) per 16.4ms servo frame
+#define SERVO_VMAX		48		// 3 steps per frame, the full 70 steps swing takes about half a second
+#define SERVO_ACCEL		4		// to full speed in 12 frames, 200ms
+#define SERVO_SETTLE_MS	600		// pulses kept up after the move, then the output is off until the next move
+
+void Servo_Init(uint8_t ch, uint8_t pos);
+void Servo_MoveTo(uint8_t ch, uint8_t pos);
+bool Servo_IsActive(void);
+
+#endif /* SERVO_H_ */
@@ -0,0 +1,38 @@
+/*
+ * trace_ids.h
+ *
+ * Created: 10/19/2026
+ *
+ * Event ids and timestamp of the TRACE build of the antenna switch, see Common/trace.c. The ring goes out on USART1
+ * in place of the IR_CAPTURE dump (ir_capture.c). Tools/tracedec -n reads the names from here.
+ */
+
+#ifndef TRACE_IDS_H_
+#define TRACE_IDS_H_
+
+#include "ir_capture.h"				// the TRACE option
+
+#define TR_TIMER1_CAPT		0		// ISRs
+#define TR_TIMER1_COMPA		1		// end of a sequence
+#define TR_TIMER1_OVF		2		// timer tick
+#define TR_TIMER0_OVF		3		// servo frame
+#define TR_IR_WAKE			4		// mark: the receiver woke the chip
+#define TR_TIMER1_COMPB		5		// IR transmitter, a mark or space
+#define TR_IR_DECODE		16		// main loop
+#define TR_IR_FRAME			17		// mark: low byte of the code
+#define TR_OUTPUT			18		// mark: the action
+
+#ifdef TRACE
+
+#include <avr/io.h>
+
+#define TRACE_PRESCALE		8		// Timer1, 0.5us, wraps every 32.8ms with TIMER1_OVF_vect traced
+
+// Timer1 stops in power down, the time of the trace does too
+#define TRACE_CLOCK()		TCNT1
+
+#endif
+
+#include "../../Common/trace.h"
+
+#endif /* TRACE_IDS_H_ */